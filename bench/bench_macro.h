@@ -0,0 +1,151 @@
+#ifndef CGRAD_BENCH_MACRO
+#define CGRAD_BENCH_MACRO
+
+#include "harness.h"
+
+/* ================================================================
+ *  Macro-benchmarks: whole graphs, recorded and differentiated
+ * ================================================================ */
+
+/* y = x; 10000 times: y = y * w + b */
+size_t bench_deep_chain(Bench *b) {
+    Tape *t = tape_get_instance();
+    bench_start(b);
+    ValueData *w = value_create(0.999f, "w", 1);
+    ValueData *c = value_create(0.001f, "b", 1);
+    ValueData *y = value_create(1.0f, "x", 1);
+    for (int i = 0; i < 10000; i++)
+        y = value_add(value_mul(y, w), c);
+    value_backward(y);
+    bench_stop(b);
+    return tape_num_nodes(t);
+}
+
+/* sum of 10000 products x_i * w_i */
+size_t bench_wide_sum(Bench *b) {
+    Tape *t = tape_get_instance();
+    bench_start(b);
+    ValueData *sum = value_create(0.0f, NULL, 0);
+    for (int i = 0; i < 10000; i++) {
+        ValueData *x = value_create((scalar_t)i * 1e-4f, NULL, 0);
+        ValueData *w = value_create(0.5f, "w", 1);
+        sum = value_add(sum, value_mul(x, w));
+    }
+    value_backward(sum);
+    bench_stop(b);
+    return tape_num_nodes(t);
+}
+
+/* ================================================================
+ *  MLP training step
+ * ================================================================ */
+
+#define MLP_IN 8
+#define MLP_HIDDEN 16
+#define MLP_BATCH 16
+
+static ParamStore *g_mlp_params = NULL;
+
+/* Rational activation x / (1 + x^2): only the four arithmetic ops are available */
+static ValueData *activation(ValueData *x) {
+    return value_div(x, scalar_add_value(1.0f, value_mul(x, x)));
+}
+
+/* Dense layer over parameters of s starting at *next (weights then biases) */
+static void dense(ParamStore *s, ValueData **in, size_t n_in, ValueData **out, size_t n_out,
+                  size_t *next, int act) {
+    for (size_t o = 0; o < n_out; o++) {
+        ValueData *acc = param_bind(s, *next + n_in * n_out + o);
+        for (size_t i = 0; i < n_in; i++)
+            acc = value_add(acc, value_mul(in[i], param_bind(s, *next + o * n_in + i)));
+        out[o] = act ? activation(acc) : acc;
+    }
+    *next += n_in * n_out + n_out;
+}
+
+static ParamStore *mlp_params(void) {
+    if (!g_mlp_params) {
+        size_t n = MLP_IN * MLP_HIDDEN + MLP_HIDDEN + MLP_HIDDEN * MLP_HIDDEN + MLP_HIDDEN +
+                   MLP_HIDDEN + 1;
+        g_mlp_params = param_store_create(n);
+        for (size_t i = 0; i < n; i++)
+            param_store_add(g_mlp_params, (scalar_t)((i * 7919) % 101) * 0.002f - 0.1f);
+    }
+    return g_mlp_params;
+}
+
+/* Forward pass over one batch with an MSE loss, on the current tape */
+static ValueData *mlp_forward(ParamStore *params, size_t batch, void *user) {
+    (void)user;
+    ValueData *loss = value_create(0.0f, NULL, 0);
+    for (int s = 0; s < MLP_BATCH; s++) {
+        ValueData *x[MLP_IN], *h1[MLP_HIDDEN], *h2[MLP_HIDDEN], *y;
+        for (int i = 0; i < MLP_IN; i++)
+            x[i] = value_create((scalar_t)((batch + s * MLP_IN + i) % 13) * 0.1f, NULL, 0);
+        size_t next = 0;
+        dense(params, x, MLP_IN, h1, MLP_HIDDEN, &next, 1);
+        dense(params, h1, MLP_HIDDEN, h2, MLP_HIDDEN, &next, 1);
+        dense(params, h2, MLP_HIDDEN, &y, 1, &next, 0);
+        ValueData *err = scalar_sub_value((scalar_t)(s % 3) - 1.0f, y);
+        loss = value_add(loss, value_mul(err, err));
+    }
+    return loss;
+}
+
+/* One step: forward over a batch, backward, Adam update */
+size_t bench_mlp_step(Bench *b) {
+    Tape *t = tape_get_instance();
+    ParamStore *params = mlp_params();
+    Optimizer opt = optimizer_adam(1e-3f);
+
+    bench_start(b);
+    ValueData *loss = mlp_forward(params, 0, NULL);
+    param_store_zero_grad(params);
+    value_backward(loss);
+    param_store_step(params, &opt);
+    bench_stop(b);
+    return tape_num_nodes(t);
+}
+
+/* ================================================================
+ *  Pipelined training: the same steps, with and without overlap
+ * ================================================================ */
+
+#define PIPELINE_STEPS 16
+
+static size_t run_mlp_pipeline(Bench *b, int staleness) {
+    Optimizer opt = optimizer_adam(1e-3f);
+    PipelineConfig config = {staleness, 1};
+    Pipeline *p = pipeline_create(mlp_params(), &opt, mlp_forward, NULL, config);
+
+    bench_start(b);
+    pipeline_run(p, PIPELINE_STEPS, NULL);
+    bench_stop(b);
+    pipeline_destroy(p);
+    return PIPELINE_STEPS;
+}
+
+size_t bench_mlp_sequential(Bench *b) {
+    return run_mlp_pipeline(b, 0);
+}
+
+size_t bench_mlp_pipelined(Bench *b) {
+    return run_mlp_pipeline(b, 1);
+}
+
+/* ================================================================
+ *  Suite runner
+ * ================================================================ */
+
+void run_macro_benchmarks(void) {
+    BENCH_SUITE("Macro");
+    BENCH_RUN(bench_deep_chain, "nodes", NULL);
+    BENCH_RUN(bench_wide_sum, "nodes", NULL);
+    BENCH_RUN(bench_mlp_step, "nodes", NULL);
+    BENCH_RUN(bench_mlp_sequential, "steps", NULL);
+    BENCH_RUN(bench_mlp_pipelined, "steps", NULL);
+    param_store_destroy(g_mlp_params);
+    g_mlp_params = NULL;
+}
+
+#endif /* CGRAD_BENCH_MACRO */
@@ -0,0 +1,92 @@
+#ifndef CGRAD_BENCH_MICRO
+#define CGRAD_BENCH_MICRO
+
+#include "harness.h"
+
+/* Nodes per micro-benchmark repetition */
+#define MICRO_NODES 100000
+
+/* ================================================================
+ *  Micro-benchmarks: the tape hot paths in isolation
+ * ================================================================ */
+
+size_t bench_tape_allocate(Bench *b) {
+    Tape *t = tape_get_instance();
+    bench_start(b);
+    for (size_t i = 0; i < MICRO_NODES; i++)
+        tape_allocate(t, 64);
+    bench_stop(b);
+    return MICRO_NODES;
+}
+
+size_t bench_value_create(Bench *b) {
+    Tape *t = tape_get_instance();
+    bench_start(b);
+    for (size_t i = 0; i < MICRO_NODES; i++)
+        value_create((scalar_t)i, NULL, 1);
+    bench_stop(b);
+    b->metric = (double)tape_mem_used(t) / (double)tape_num_nodes(t);
+    return MICRO_NODES;
+}
+
+/* Records MICRO_NODES binary ops on top of two leaves */
+static ValueData *record_ops(void) {
+    ValueData *x = value_create(1.0f, "x", 1);
+    ValueData *w = value_create(0.999f, "w", 1);
+    ValueData *y = x;
+    for (size_t i = 0; i < MICRO_NODES / 2; i++)
+        y = value_add(value_mul(y, w), x);
+    return y;
+}
+
+size_t bench_record_ops(Bench *b) {
+    Tape *t = tape_get_instance();
+    bench_start(b);
+    record_ops();
+    bench_stop(b);
+    b->metric = (double)tape_mem_used(t) / (double)tape_num_nodes(t);
+    return tape_num_nodes(t);
+}
+
+size_t bench_backward(Bench *b) {
+    ValueData *y = record_ops();
+    bench_start(b);
+    value_backward(y);
+    bench_stop(b);
+    return tape_num_nodes(tape_get_instance());
+}
+
+size_t bench_zero_grad(Bench *b) {
+    Tape *t = tape_get_instance();
+    record_ops();
+    bench_start(b);
+    tape_zero_grad(t);
+    bench_stop(b);
+    return tape_num_nodes(t);
+}
+
+size_t bench_tape_clear(Bench *b) {
+    Tape *t = tape_get_instance();
+    record_ops();
+    size_t n = tape_num_nodes(t);
+    bench_start(b);
+    tape_clear(t);
+    bench_stop(b);
+    return n;
+}
+
+/* ================================================================
+ *  Suite runner
+ * ================================================================ */
+
+void run_micro_benchmarks(void) {
+    BENCH_SUITE("Micro");
+    BENCH_RUN(bench_tape_allocate, "allocs", NULL);
+    BENCH_RUN(bench_value_create, "nodes", "bytes_per_node");
+    BENCH_RUN(bench_record_ops, "nodes", "bytes_per_node");
+    BENCH_RUN(bench_backward, "nodes", NULL);
+    BENCH_RUN(bench_zero_grad, "nodes", NULL);
+    BENCH_RUN(bench_tape_clear, "nodes", NULL);
+}
+
+#endif /* CGRAD_BENCH_MICRO */
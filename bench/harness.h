@@ -0,0 +1,196 @@
+#ifndef CGRAD_BENCH_HARNESS
+#define CGRAD_BENCH_HARNESS
+
+#include "../cgrad/cgrad.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Color codes for terminal output */
+#define CLR_GREEN "\033[32m"
+#define CLR_RED "\033[31m"
+#define CLR_YELLOW "\033[33m"
+#define CLR_RESET "\033[0m"
+
+/* Default repetitions: warm-up runs are discarded, measured runs are kept */
+#define BENCH_WARMUP 3
+#define BENCH_REPS 31
+#define BENCH_MAX_RESULTS 64
+
+/*
+ * State handed to a benchmark for one repetition. The benchmark brackets the
+ * measured region with bench_start/bench_stop, so that setup and teardown
+ * (recording a tape to differentiate, clearing it) stay out of the timing.
+ */
+typedef struct Bench {
+    struct timespec start;
+    double elapsed_ns;
+    double metric; // Optional extra figure, e.g. bytes per node
+} Bench;
+
+/* One repetition; returns the number of items (nodes, allocations...) processed */
+typedef size_t (*BenchFn)(Bench *b);
+
+typedef struct BenchResult {
+    const char *name;
+    const char *unit;   // What an item is
+    size_t items;       // Items per repetition
+    double median_ns;   // Per repetition
+    double p99_ns;      // Per repetition
+    double items_per_s; // At the median
+    double metric;      // Benchmark-specific extra figure, 0 if none
+    const char *metric_name;
+} BenchResult;
+
+static BenchResult g_results[BENCH_MAX_RESULTS];
+static size_t g_num_results = 0;
+static const char *g_filter = NULL;
+
+static inline void bench_start(Bench *b) {
+    clock_gettime(CLOCK_MONOTONIC, &b->start);
+}
+
+static inline void bench_stop(Bench *b) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    b->elapsed_ns += (double)(end.tv_sec - b->start.tv_sec) * 1e9 +
+                     (double)(end.tv_nsec - b->start.tv_nsec);
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Warm up, run BENCH_REPS repetitions and record the median and p99 of the
+ * measured regions. The global tape is cleared after every repetition.
+ */
+static void bench_run(const char *name, BenchFn fn, const char *unit, const char *metric_name) {
+    if (g_filter && !strstr(name, g_filter))
+        return;
+    if (g_num_results == BENCH_MAX_RESULTS)
+        return;
+
+    double samples[BENCH_REPS];
+    size_t items = 0;
+    double metric = 0.0;
+    for (int i = 0; i < BENCH_WARMUP + BENCH_REPS; i++) {
+        Bench b = {{0, 0}, 0.0, 0.0};
+        items = fn(&b);
+        tape_clear(tape_get_instance());
+        if (i >= BENCH_WARMUP)
+            samples[i - BENCH_WARMUP] = b.elapsed_ns;
+        metric = b.metric;
+    }
+    qsort(samples, BENCH_REPS, sizeof(double), compare_double);
+
+    BenchResult *r = &g_results[g_num_results++];
+    r->name = name;
+    r->unit = unit;
+    r->items = items;
+    r->median_ns = samples[BENCH_REPS / 2];
+    r->p99_ns = samples[(BENCH_REPS * 99 + 99) / 100 - 1];
+    r->items_per_s = r->median_ns > 0.0 ? (double)items / (r->median_ns * 1e-9) : 0.0;
+    r->metric = metric;
+    r->metric_name = metric_name;
+
+    printf("  %-28s %10.3f ms  p99 %10.3f ms  %12.3e %s/s", name, r->median_ns * 1e-6,
+           r->p99_ns * 1e-6, r->items_per_s, unit);
+    if (metric_name)
+        printf("  %s %.1f", metric_name, metric);
+    printf("\n");
+}
+
+/*
+ * BENCH_RUN(fn, unit, metric_name) - runs a benchmark function under its own name.
+ */
+#define BENCH_RUN(fn, unit, metric_name) bench_run(#fn, fn, unit, metric_name)
+
+/*
+ * BENCH_SUITE(name) - prints a header for a group of benchmarks.
+ */
+#define BENCH_SUITE(name) printf("\n" CLR_YELLOW "── %s ──" CLR_RESET "\n", name)
+
+/* ================================================================
+ *  JSON output and baseline comparison
+ * ================================================================ */
+
+static int bench_write_json(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "Error: Could not open file %s for writing\n", path);
+        return -1;
+    }
+
+    fprintf(f, "{\n  \"version\": 1,\n  \"scalar_size\": %zu,\n  \"reps\": %d,\n",
+            sizeof(scalar_t), BENCH_REPS);
+    fprintf(f, "  \"results\": [\n");
+    for (size_t i = 0; i < g_num_results; i++) {
+        const BenchResult *r = &g_results[i];
+        fprintf(f,
+                "    {\"name\": \"%s\", \"unit\": \"%s\", \"items\": %zu, \"median_ns\": %.1f, "
+                "\"p99_ns\": %.1f, \"items_per_s\": %.6e",
+                r->name, r->unit, r->items, r->median_ns, r->p99_ns, r->items_per_s);
+        if (r->metric_name)
+            fprintf(f, ", \"%s\": %.3f", r->metric_name, r->metric);
+        fprintf(f, "}%s\n", i + 1 < g_num_results ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+/* Median of a named benchmark in a JSON file written by bench_write_json, or -1 */
+static double baseline_median(const char *json, const char *name) {
+    char key[128];
+    snprintf(key, sizeof(key), "\"name\": \"%s\"", name);
+    const char *p = strstr(json, key);
+    if (!p)
+        return -1.0;
+    p = strstr(p, "\"median_ns\": ");
+    return p ? strtod(p + strlen("\"median_ns\": "), NULL) : -1.0;
+}
+
+/*
+ * Compare against a baseline file. Returns the number of benchmarks that got
+ * slower by more than max_regression percent.
+ */
+static int bench_compare(const char *path, double max_regression) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        printf("\nNo baseline at %s (save one with: make bench-baseline)\n", path);
+        return 0;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *json = (char *)malloc((size_t)size + 1);
+    size_t len = json ? fread(json, 1, (size_t)size, f) : 0;
+    fclose(f);
+    if (!json)
+        return 0;
+    json[len] = '\0';
+
+    int regressions = 0;
+    printf("\n" CLR_YELLOW "── Baseline: %s ──" CLR_RESET "\n", path);
+    for (size_t i = 0; i < g_num_results; i++) {
+        const BenchResult *r = &g_results[i];
+        double base = baseline_median(json, r->name);
+        if (base <= 0.0) {
+            printf("  %-28s %10s\n", r->name, "new");
+            continue;
+        }
+        double change = (r->median_ns / base - 1.0) * 100.0;
+        int slower = change > max_regression;
+        regressions += slower;
+        printf("  %-28s %+9.1f%%  %s\n", r->name, change,
+               slower ? CLR_RED "REGRESSION" CLR_RESET
+                      : (change < -max_regression ? CLR_GREEN "faster" CLR_RESET : ""));
+    }
+    free(json);
+    return regressions;
+}
+
+#endif /* CGRAD_BENCH_HARNESS */
@@ -0,0 +1,45 @@
+/*
+ * Benchmark runner
+ *
+ * Usage: bench_runner [--filter SUBSTRING] [--json OUT] [--baseline FILE]
+ *                     [--max-regression PERCENT]
+ *
+ * Exits with status 1 when a benchmark is slower than the baseline by more
+ * than the allowed regression (default 10%).
+ */
+
+#include "bench_macro.h"
+#include "bench_micro.h"
+
+int main(int argc, char **argv) {
+    const char *json = NULL;
+    const char *baseline = NULL;
+    double max_regression = 10.0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--filter") && i + 1 < argc)
+            g_filter = argv[++i];
+        else if (!strcmp(argv[i], "--json") && i + 1 < argc)
+            json = argv[++i];
+        else if (!strcmp(argv[i], "--baseline") && i + 1 < argc)
+            baseline = argv[++i];
+        else if (!strcmp(argv[i], "--max-regression") && i + 1 < argc)
+            max_regression = strtod(argv[++i], NULL);
+        else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    printf("cgrad benchmarks (scalar_t: %zu bytes, %d reps after %d warm-up)\n",
+           sizeof(scalar_t), BENCH_REPS, BENCH_WARMUP);
+    run_micro_benchmarks();
+    run_macro_benchmarks();
+    tape_destroy_instance();
+
+    if (json && bench_write_json(json) != 0)
+        return 2;
+    if (baseline && bench_compare(baseline, max_regression) > 0)
+        return 1;
+    return 0;
+}
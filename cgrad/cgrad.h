@@ -30,6 +30,23 @@
  *    tape_clear(tape);
  */
 
+#include "checkpoint.h"
+#include "codegen.h"
+#include "dataset.h"
+#include "distrib.h"
+#include "dual.h"
+#include "fusion.h"
+#include "graph.h"
+#include "jacobian.h"
+#include "memplan.h"
+#include "params.h"
+#include "passes.h"
+#include "pipeline.h"
+#include "plancache.h"
+#include "precision.h"
+#include "profile.h"
+#include "serialize.h"
+#include "subgraph.h"
 #include "tape.h"
 #include "value.h"
 
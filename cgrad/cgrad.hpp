@@ -0,0 +1,292 @@
+#ifndef CGRAD_HPP
+#define CGRAD_HPP
+
+/*
+ * cgrad.hpp: header-only C++17 front end over cgrad.h
+ *
+ * Arithmetic on cgrad::Var builds an expression template instead of recording
+ * one node per operator. Assigning the expression to a Var records it as a
+ * single OP_FUSED node: the value is computed by code compiled for that
+ * expression, and so is the backward pass, so no op is dispatched at run time.
+ *
+ *    cgrad::Var a(2.0f, "a", true), b(3.0f, "b", true), c(1.0f, "c", true);
+ *    cgrad::Var f = (a * b + c) * 0.5f; // one node
+ *    f.backward();
+ *    a.grad(); // 1.5
+ *
+ * The node carries the usual FusedKernel, so tape_forward, tape_fuse, codegen
+ * and the other passes treat it like any fused node. Expressions longer than
+ * FUSED_MAX_STEPS operators are split at the root into several nodes; a single
+ * operator is recorded as the plain binary op.
+ */
+
+#include "cgrad.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace cgrad {
+
+class Var;
+
+namespace detail {
+
+/*
+ * Expression trees. Leaves are numbered left to right and every static member
+ * takes the number of its first leaf as template parameter I, so the layout of
+ * the kernel inputs is fixed by the type alone.
+ */
+
+/* A node or a constant, read from kernel input I */
+struct Leaf {
+    static constexpr std::size_t leaves = 1;
+    static constexpr std::size_t steps = 0;
+
+    ValueData *node; // NULL for a constant
+    scalar_t value;
+
+    template <std::size_t I> static scalar_t eval(const scalar_t *in) {
+        return in[I];
+    }
+
+    template <std::size_t I>
+    static void grad(const scalar_t *, scalar_t g, ValueData *const *inputs) {
+        inputs[I]->grad += g;
+    }
+
+    template <std::size_t I> static std::uint8_t emit(FusedKernel &) {
+        return (std::uint8_t)I;
+    }
+
+    /* Constants become unnamed leaves, as with the scalar_*_value helpers */
+    void collect(Tape *t, ValueData **out) const {
+        *out = node ? node : value_create_with_tape(t, value, NULL, 0);
+    }
+};
+
+template <ValueOp Op, class L, class R> struct Binary {
+    static_assert(Op == OP_ADD || Op == OP_SUB || Op == OP_MUL || Op == OP_DIV,
+                  "only elementwise binary ops can be fused");
+    static constexpr std::size_t leaves = L::leaves + R::leaves;
+    static constexpr std::size_t steps = L::steps + R::steps + 1;
+
+    L lhs;
+    R rhs;
+
+    static scalar_t apply(scalar_t a, scalar_t b) {
+        if constexpr (Op == OP_ADD)
+            return a + b;
+        else if constexpr (Op == OP_SUB)
+            return a - b;
+        else if constexpr (Op == OP_MUL)
+            return a * b;
+        else
+            return a / b;
+    }
+
+    template <std::size_t I> static scalar_t eval(const scalar_t *in) {
+        return apply(L::template eval<I>(in), R::template eval<I + L::leaves>(in));
+    }
+
+    /* Reverse sweep: intermediates are recomputed, like fused_backward does */
+    template <std::size_t I>
+    static void grad(const scalar_t *in, scalar_t g, ValueData *const *inputs) {
+        scalar_t a = L::template eval<I>(in);
+        scalar_t b = R::template eval<I + L::leaves>(in);
+        scalar_t ga, gb;
+        if constexpr (Op == OP_ADD) {
+            ga = g, gb = g;
+        } else if constexpr (Op == OP_SUB) {
+            ga = g, gb = -g;
+        } else if constexpr (Op == OP_MUL) {
+            ga = b * g, gb = a * g;
+        } else {
+            ga = g / b, gb = -(a / (b * b)) * g;
+        }
+        L::template grad<I>(in, ga, inputs);
+        R::template grad<I + L::leaves>(in, gb, inputs);
+    }
+
+    /* Append the program of this subtree and return the operand holding its result */
+    template <std::size_t I> static std::uint8_t emit(FusedKernel &k) {
+        std::uint8_t a = L::template emit<I>(k);
+        std::uint8_t b = R::template emit<I + L::leaves>(k);
+        FusedStep &st = k.steps[k.num_steps];
+        st.op = Op;
+        st.lhs = a;
+        st.rhs = b;
+        return (std::uint8_t)(FUSED_REG | k.num_steps++);
+    }
+
+    void collect(Tape *t, ValueData **out) const {
+        lhs.collect(t, out);
+        rhs.collect(t, out + L::leaves);
+    }
+};
+
+template <class T> struct is_binary : std::false_type {};
+template <ValueOp Op, class L, class R> struct is_binary<Binary<Op, L, R>> : std::true_type {};
+
+/* Operands of the overloaded operators: at least one side must not be a plain number */
+template <class T> using bare = std::remove_cv_t<std::remove_reference_t<T>>;
+template <class T>
+constexpr bool is_expr = std::is_same_v<bare<T>, Var> || is_binary<bare<T>>::value;
+template <class A, class B>
+constexpr bool operands = (is_expr<A> || std::is_arithmetic_v<bare<A>>) &&
+                          (is_expr<B> || std::is_arithmetic_v<bare<B>>) &&
+                          (is_expr<A> || is_expr<B>);
+
+/* The program of an expression type, built once */
+template <class E> const FusedKernel &program() {
+    static const FusedKernel k = [] {
+        FusedKernel p{};
+        p.num_inputs = E::leaves;
+        E::template emit<0>(p);
+        return p;
+    }();
+    return k;
+}
+
+/* BackwardFn of a node recorded from expression type E */
+template <class E> void backward(ValueData *out) {
+    const FusedKernel *k = (const FusedKernel *)out->ctx;
+    scalar_t in[E::leaves];
+    for (std::size_t i = 0; i < E::leaves; i++)
+        in[i] = k->inputs[i]->data;
+    E::template grad<0>(in, out->grad, k->inputs);
+}
+
+template <ValueOp Op> ValueData *binary_op(ValueData *a, ValueData *b) {
+    if constexpr (Op == OP_ADD)
+        return value_add(a, b);
+    else if constexpr (Op == OP_SUB)
+        return value_sub(a, b);
+    else if constexpr (Op == OP_MUL)
+        return value_mul(a, b);
+    else
+        return value_div(a, b);
+}
+
+inline ValueData *record(const Leaf &e) {
+    ValueData *v;
+    e.collect(tape_get_instance(), &v);
+    return v;
+}
+
+/* Record an expression on the current tape; NULL if an operand is NULL */
+template <ValueOp Op, class L, class R> ValueData *record(const Binary<Op, L, R> &e) {
+    using E = Binary<Op, L, R>;
+    if constexpr (E::steps > FUSED_MAX_STEPS) {
+        /* Too long for one kernel: the operands become nodes of their own */
+        return binary_op<Op>(record(e.lhs), record(e.rhs));
+    } else {
+        ValueData *inputs[E::leaves];
+        e.collect(tape_get_instance(), inputs);
+        scalar_t in[E::leaves];
+        for (std::size_t i = 0; i < E::leaves; i++) {
+            if (!inputs[i])
+                return NULL;
+            in[i] = inputs[i]->data;
+        }
+        if constexpr (E::steps == 1)
+            return binary_op<Op>(inputs[0], inputs[1]);
+        else
+            return value_fused_compiled(tape_get_instance(), &program<E>(), inputs,
+                                        E::template eval<0>(in), &backward<E>);
+    }
+}
+
+} // namespace detail
+
+/* A node on the current tape. Copies refer to the same node. */
+class Var {
+  public:
+    Var() : node_(NULL) {}
+    Var(ValueData *node) : node_(node) {}
+    explicit Var(scalar_t data, const char *name = NULL, bool requires_grad = false)
+        : node_(value_create(data, name, requires_grad)) {}
+    template <ValueOp Op, class L, class R>
+    Var(const detail::Binary<Op, L, R> &e) : node_(detail::record(e)) {}
+
+    ValueData *node() const {
+        return node_;
+    }
+
+    scalar_t data() const {
+        return value_get_data(node_);
+    }
+    scalar_t grad() const {
+        return value_get_grad(node_);
+    }
+    void backward() const {
+        value_backward(node_);
+    }
+
+    template <class E> Var &operator+=(const E &e) {
+        return *this = *this + e;
+    }
+    template <class E> Var &operator-=(const E &e) {
+        return *this = *this - e;
+    }
+    template <class E> Var &operator*=(const E &e) {
+        return *this = *this * e;
+    }
+    template <class E> Var &operator/=(const E &e) {
+        return *this = *this / e;
+    }
+
+  private:
+    ValueData *node_;
+};
+
+namespace detail {
+
+inline Leaf operand(const Var &v) {
+    return Leaf{v.node(), 0};
+}
+template <ValueOp Op, class L, class R>
+const Binary<Op, L, R> &operand(const Binary<Op, L, R> &e) {
+    return e;
+}
+template <class T, class = std::enable_if_t<std::is_arithmetic_v<T>>> Leaf operand(T s) {
+    return Leaf{NULL, (scalar_t)s};
+}
+
+template <ValueOp Op, class A, class B> auto combine(const A &a, const B &b) {
+    using L = bare<decltype(operand(a))>;
+    using R = bare<decltype(operand(b))>;
+    return Binary<Op, L, R>{operand(a), operand(b)};
+}
+
+template <class A, class B, class = std::enable_if_t<operands<A, B>>>
+auto operator+(const A &a, const B &b) {
+    return combine<OP_ADD>(a, b);
+}
+template <class A, class B, class = std::enable_if_t<operands<A, B>>>
+auto operator-(const A &a, const B &b) {
+    return combine<OP_SUB>(a, b);
+}
+template <class A, class B, class = std::enable_if_t<operands<A, B>>>
+auto operator*(const A &a, const B &b) {
+    return combine<OP_MUL>(a, b);
+}
+template <class A, class B, class = std::enable_if_t<operands<A, B>>>
+auto operator/(const A &a, const B &b) {
+    return combine<OP_DIV>(a, b);
+}
+template <class A, class = std::enable_if_t<is_expr<A>>> auto operator-(const A &a) {
+    return combine<OP_SUB>(0, a);
+}
+
+} // namespace detail
+
+/* Found by argument-dependent lookup from Var as well as from the expression types */
+using detail::operator+;
+using detail::operator-;
+using detail::operator*;
+using detail::operator/;
+
+} // namespace cgrad
+
+#endif // CGRAD_HPP
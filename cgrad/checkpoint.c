@@ -0,0 +1,170 @@
+/* checkpoint.c - Gradient checkpointing */
+
+#include "checkpoint.h"
+
+#include "tape.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+/*
+ * Record the segment on a fresh scratch tape made current for the duration of
+ * the steps. Returns the segment output; *input receives the scratch copy of
+ * the segment input so that its gradient can be read back.
+ */
+static ValueData *segment_record(Tape *scratch, const CheckpointSegment *seg, scalar_t x,
+                                 int requires_grad, ValueData **input) {
+    Tape *prev = tape_set_instance(scratch);
+    ValueData *y = value_create(x, "", requires_grad);
+    *input = y;
+    for (size_t i = 0; y && i < seg->count; i++)
+        y = seg->fn(y, seg->first + i, seg->ctx);
+    tape_set_instance(prev);
+    return y;
+}
+
+static int by_id(const void *a, const void *b) {
+    size_t x = (*(ValueData *const *)a)->id, y = (*(ValueData *const *)b)->id;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Record on t the segment input followed by the nodes of t that the recorded
+ * segment reads, deduplicated and in tape order. Returns 0 on failure.
+ */
+static int segment_inputs(Tape *t, const Tape *scratch, CheckpointSegment *seg,
+                          ValueData *input) {
+    size_t num = 0, cap = 0;
+    ValueData **outer = NULL;
+    for (size_t i = 0; i < scratch->num_nodes; i++) {
+        size_t count;
+        ValueData **in = value_inputs(scratch->nodes[i], &count);
+        for (size_t j = 0; j < count; j++) {
+            if (tape_contains(scratch, in[j]) || !tape_contains(t, in[j]))
+                continue;
+            if (num == cap) {
+                cap = cap ? 2 * cap : 8;
+                ValueData **grown = (ValueData **)realloc(outer, cap * sizeof(ValueData *));
+                if (!grown) {
+                    free(outer);
+                    return 0;
+                }
+                outer = grown;
+            }
+            outer[num++] = in[j];
+        }
+    }
+
+    size_t unique = 0;
+    if (num > 0) {
+        qsort(outer, num, sizeof(ValueData *), by_id);
+        for (size_t i = 0; i < num; i++) {
+            if (unique == 0 || outer[unique - 1] != outer[i])
+                outer[unique++] = outer[i];
+        }
+    }
+
+    seg->inputs = (ValueData **)tape_allocate(t, (1 + unique) * sizeof(ValueData *));
+    if (seg->inputs) {
+        seg->inputs[0] = input;
+        for (size_t i = 0; i < unique; i++)
+            seg->inputs[1 + i] = outer[i];
+        seg->num_inputs = 1 + unique;
+    }
+    free(outer);
+    return seg->inputs != NULL;
+}
+
+ValueData *value_checkpoint(ValueData *input, CheckpointStepFn fn, size_t first, size_t count,
+                            void *ctx) {
+    if (!input || !fn || count == 0)
+        return NULL;
+
+    Tape *t = tape_get_instance();
+    CheckpointSegment *seg = (CheckpointSegment *)tape_allocate(t, sizeof(CheckpointSegment));
+    Tape *scratch = tape_create();
+    if (!seg || !scratch) {
+        tape_destroy(scratch);
+        return NULL;
+    }
+    seg->fn = fn;
+    seg->ctx = ctx;
+    seg->first = first;
+    seg->count = count;
+
+    /* Forward without retention: only the boundary value survives */
+    ValueData *x;
+    ValueData *y = segment_record(scratch, seg, input->data, input->requires_grad, &x);
+    scalar_t data = y ? y->data : 0.0;
+    int requires_grad = y ? y->requires_grad : 0;
+    int ok = y && segment_inputs(t, scratch, seg, input);
+    tape_destroy(scratch);
+    if (!ok)
+        return NULL;
+
+    ValueData *out = value_create_with_tape(t, data, "", requires_grad);
+    if (!out)
+        return NULL;
+    out->opcode = OP_CHECKPOINT;
+    snprintf(out->op, sizeof(out->op), "%s", value_op_symbol(OP_CHECKPOINT));
+    out->children[0] = input;
+    out->num_children = 1;
+    out->ctx = seg;
+    out->backward_fn = requires_grad ? checkpoint_backward : NULL;
+    return out;
+}
+
+ValueData *value_checkpoint_sequential(ValueData *input, CheckpointStepFn fn, size_t num_steps,
+                                       size_t segment_len, void *ctx) {
+    if (segment_len == CHECKPOINT_AUTO)
+        segment_len = checkpoint_segment_len(num_steps);
+
+    ValueData *y = input;
+    for (size_t first = 0; y && first < num_steps; first += segment_len) {
+        size_t count = num_steps - first < segment_len ? num_steps - first : segment_len;
+        y = value_checkpoint(y, fn, first, count, ctx);
+    }
+    return y;
+}
+
+size_t checkpoint_segment_len(size_t num_steps) {
+    size_t len = (size_t)ceil(sqrt((double)num_steps));
+    return len > 0 ? len : 1;
+}
+
+ValueData **checkpoint_inputs(const ValueData *v, size_t *count) {
+    const CheckpointSegment *seg = (const CheckpointSegment *)v->ctx;
+    *count = seg->num_inputs;
+    return seg->inputs;
+}
+
+void checkpoint_forward(ValueData *v) {
+    const CheckpointSegment *seg = (const CheckpointSegment *)v->ctx;
+    Tape *scratch = tape_create();
+    if (!scratch)
+        return;
+
+    ValueData *x;
+    ValueData *y = segment_record(scratch, seg, seg->inputs[0]->data, 0, &x);
+    if (y)
+        v->data = y->data;
+    tape_destroy(scratch);
+}
+
+void checkpoint_backward(ValueData *v) {
+    const CheckpointSegment *seg = (const CheckpointSegment *)v->ctx;
+    ValueData *input = seg->inputs[0];
+    Tape *scratch = tape_create();
+    if (!scratch)
+        return;
+
+    /* Rematerialize the segment, then back-propagate through it */
+    ValueData *x;
+    ValueData *y = segment_record(scratch, seg, input->data, 1, &x);
+    if (y) {
+        y->grad = v->grad;
+        tape_backward(scratch);
+        input->grad += x->grad;
+    }
+    tape_destroy(scratch);
+}
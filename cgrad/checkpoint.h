@@ -0,0 +1,70 @@
+/*
+Gradient checkpointing (rematerialization) for long sequential graphs.
+*/
+
+#ifndef CGRAD_CHECKPOINT_H
+#define CGRAD_CHECKPOINT_H
+
+#include "value.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * One step of a sequential model: records the state after step `index` on the
+ * current tape. Steps must be deterministic, since they are run again during
+ * the backward pass; they may read leaves recorded on the caller's tape.
+ */
+typedef ValueData *(*CheckpointStepFn)(ValueData *state, size_t index, void *ctx);
+
+/* Segment length chosen by the sqrt(n) policy */
+#define CHECKPOINT_AUTO 0
+
+/*
+ * State of an OP_CHECKPOINT node: steps [first, first + count) of fn.
+ * inputs[0] is the segment input; the rest are the nodes of the caller's tape
+ * the steps read, in tape order, so that the passes see every dependency.
+ */
+typedef struct CheckpointSegment {
+    CheckpointStepFn fn;
+    void *ctx;
+    size_t first;
+    size_t count;
+    ValueData **inputs;
+    size_t num_inputs;
+} CheckpointSegment;
+
+/*
+ * Run steps [first, first + count) on a scratch tape and record a single
+ * OP_CHECKPOINT node holding the result. Only the segment boundary is kept on
+ * the current tape; the segment is re-recorded and back-propagated on a scratch
+ * tape when the backward pass reaches the node. Nodes of the current tape read
+ * by the steps are found while recording and reported by value_inputs.
+ */
+ValueData *value_checkpoint(ValueData *input, CheckpointStepFn fn, size_t first, size_t count,
+                            void *ctx);
+
+/*
+ * Run num_steps steps as a chain of checkpointed segments of segment_len steps
+ * (CHECKPOINT_AUTO: ceil(sqrt(num_steps))), so that at most O(sqrt(n)) nodes
+ * are alive at any time.
+ */
+ValueData *value_checkpoint_sequential(ValueData *input, CheckpointStepFn fn, size_t num_steps,
+                                       size_t segment_len, void *ctx);
+
+/* Segment length of the sqrt(n) policy */
+size_t checkpoint_segment_len(size_t num_steps);
+
+/* Input nodes of an OP_CHECKPOINT node (see value_inputs) */
+ValueData **checkpoint_inputs(const ValueData *v, size_t *count);
+
+/* Forward replay and backward pass of an OP_CHECKPOINT node */
+void checkpoint_forward(ValueData *v);
+void checkpoint_backward(ValueData *v);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CGRAD_CHECKPOINT_H
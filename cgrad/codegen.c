@@ -0,0 +1,401 @@
+/* codegen.c - Tape-to-C code generation */
+
+#include "codegen.h"
+
+#include "fusion.h"
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* Flags passed to the system compiler for generated code */
+static const char *const codegen_cflags[] = {"-O3",    "-march=native", "-ffast-math",
+                                             "-shared", "-fPIC"};
+#define CODEGEN_NUM_CFLAGS (sizeof(codegen_cflags) / sizeof(codegen_cflags[0]))
+
+/* Words of $CC at most (e.g. "ccache gcc") */
+#define CODEGEN_MAX_CC_WORDS 8
+
+/*
+ * Non-finite constants have no C literal. Tested on the bits, since
+ * -ffast-math lets the compiler assume isnan() and isinf() are false.
+ */
+static const char *nonfinite_literal(double d) {
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    if (((bits >> 52) & 0x7FF) != 0x7FF)
+        return NULL;
+    if (bits & ((1ull << 52) - 1))
+        return "NAN";
+    return (bits >> 63) ? "-INFINITY" : "INFINITY";
+}
+
+/* Source expression of a node value: a baked literal or a slot of v[] */
+static void operand(char *buf, size_t size, const ValueData *x) {
+    if (!value_is_constant(x)) {
+        snprintf(buf, size, "v[%zu]", x->id);
+        return;
+    }
+    const char *special = nonfinite_literal((double)x->data);
+    if (special)
+        snprintf(buf, size, "((scalar_t)%s)", special);
+    else
+        snprintf(buf, size, "((scalar_t)%.17g)", (double)x->data);
+}
+
+/* Operand of a fused step: a local register or a kernel input */
+static void fused_operand(char *buf, size_t size, const FusedKernel *k, uint8_t o) {
+    if (FUSED_IS_REG(o))
+        snprintf(buf, size, "r%u", (unsigned)FUSED_INDEX(o));
+    else
+        operand(buf, size, k->inputs[o]);
+}
+
+static const char *op_token(ValueOp op) {
+    switch (op) {
+    case OP_ADD:
+        return "+";
+    case OP_SUB:
+        return "-";
+    case OP_MUL:
+        return "*";
+    case OP_DIV:
+        return "/";
+    default:
+        return NULL;
+    }
+}
+
+static void emit_fused_registers(FILE *out, const FusedKernel *k) {
+    char a[64], b[64];
+    for (size_t s = 0; s < k->num_steps; s++) {
+        const FusedStep *st = &k->steps[s];
+        fused_operand(a, sizeof(a), k, st->lhs);
+        fused_operand(b, sizeof(b), k, st->rhs);
+        fprintf(out, "        const scalar_t r%zu = %s %s %s;\n", s, a, op_token(st->op), b);
+    }
+}
+
+static void emit_forward(FILE *out, const ValueData *v) {
+    char a[64], b[64];
+
+    if (v->opcode == OP_FUSED) {
+        const FusedKernel *k = (const FusedKernel *)v->ctx;
+        fprintf(out, "    {\n");
+        emit_fused_registers(out, k);
+        fprintf(out, "        v[%zu] = r%zu;\n    }\n", v->id, k->num_steps - 1);
+        return;
+    }
+
+    operand(a, sizeof(a), v->children[0]);
+    operand(b, sizeof(b), v->children[1]);
+    fprintf(out, "    v[%zu] = %s %s %s;\n", v->id, a, op_token(v->opcode), b);
+}
+
+/* Accumulate "expr" into the adjoint of x, unless x is a baked constant */
+static void emit_accumulate(FILE *out, const char *indent, const char *target, const char *sign,
+                            const char *expr) {
+    if (target)
+        fprintf(out, "%s%s %s= %s;\n", indent, target, sign, expr);
+}
+
+static const char *grad_target(char *buf, size_t size, const ValueData *x) {
+    if (value_is_constant(x))
+        return NULL;
+    snprintf(buf, size, "g[%zu]", x->id);
+    return buf;
+}
+
+static const char *fused_grad_target(char *buf, size_t size, const FusedKernel *k, uint8_t o) {
+    if (FUSED_IS_REG(o)) {
+        snprintf(buf, size, "a%u", (unsigned)FUSED_INDEX(o));
+        return buf;
+    }
+    return grad_target(buf, size, k->inputs[o]);
+}
+
+/* Local derivative rules shared by binary and fused nodes */
+static void emit_rule(FILE *out, const char *indent, ValueOp op, const char *a, const char *b,
+                      const char *ga, const char *gb, const char *g) {
+    char expr[256];
+    switch (op) {
+    case OP_ADD:
+        emit_accumulate(out, indent, ga, "+", g);
+        emit_accumulate(out, indent, gb, "+", g);
+        break;
+    case OP_SUB:
+        emit_accumulate(out, indent, ga, "+", g);
+        emit_accumulate(out, indent, gb, "-", g);
+        break;
+    case OP_MUL:
+        snprintf(expr, sizeof(expr), "%s * %s", b, g);
+        emit_accumulate(out, indent, ga, "+", expr);
+        snprintf(expr, sizeof(expr), "%s * %s", a, g);
+        emit_accumulate(out, indent, gb, "+", expr);
+        break;
+    case OP_DIV:
+        snprintf(expr, sizeof(expr), "%s / %s", g, b);
+        emit_accumulate(out, indent, ga, "+", expr);
+        snprintf(expr, sizeof(expr), "%s / (%s * %s) * %s", a, b, b, g);
+        emit_accumulate(out, indent, gb, "-", expr);
+        break;
+    default:
+        break;
+    }
+}
+
+static void emit_backward(FILE *out, const ValueData *v) {
+    char a[64], b[64], ga[64], gb[64], g[64];
+
+    if (v->opcode == OP_FUSED) {
+        const FusedKernel *k = (const FusedKernel *)v->ctx;
+        size_t last = k->num_steps - 1;
+        fprintf(out, "    {\n");
+        emit_fused_registers(out, k);
+        for (size_t s = 0; s < last; s++)
+            fprintf(out, "        scalar_t a%zu = 0;\n", s);
+        fprintf(out, "        const scalar_t a%zu = g[%zu];\n", last, v->id);
+        for (size_t s = k->num_steps; s > 0; s--) {
+            const FusedStep *st = &k->steps[s - 1];
+            fused_operand(a, sizeof(a), k, st->lhs);
+            fused_operand(b, sizeof(b), k, st->rhs);
+            snprintf(g, sizeof(g), "a%zu", s - 1);
+            emit_rule(out, "        ", st->op, a, b, fused_grad_target(ga, sizeof(ga), k, st->lhs),
+                      fused_grad_target(gb, sizeof(gb), k, st->rhs), g);
+        }
+        fprintf(out, "    }\n");
+        return;
+    }
+
+    operand(a, sizeof(a), v->children[0]);
+    operand(b, sizeof(b), v->children[1]);
+    snprintf(g, sizeof(g), "g[%zu]", v->id);
+    emit_rule(out, "    ", v->opcode, a, b, grad_target(ga, sizeof(ga), v->children[0]),
+              grad_target(gb, sizeof(gb), v->children[1]), g);
+}
+
+/* Every input must live on the tape, or be a constant that gets baked in */
+static int check_inputs(const Tape *t, const ValueData *v) {
+    size_t count;
+    ValueData **in = value_inputs(v, &count);
+    for (size_t j = 0; j < count; j++) {
+        if (!value_is_constant(in[j]) && !tape_contains(t, in[j]))
+            return 0;
+    }
+    return 1;
+}
+
+int tape_codegen(const Tape *t, FILE *out) {
+    if (!t || !out)
+        return -1;
+
+    for (size_t i = 0; i < t->num_nodes; i++) {
+        const ValueData *v = t->nodes[i];
+        if (v->opcode != OP_NONE && (!op_token(v->opcode) && v->opcode != OP_FUSED))
+            return -1;
+        if (!check_inputs(t, v))
+            return -1;
+    }
+
+    fprintf(out, "/* Generated by cgrad from a tape of %zu nodes */\n\n", t->num_nodes);
+    fprintf(out, "#include <math.h>\n\n");
+    fprintf(out, "typedef %s scalar_t;\n\n",
+            sizeof(scalar_t) == sizeof(double) ? "double" : "float");
+
+    fprintf(out, "void cgrad_forward(scalar_t *v) {\n");
+    for (size_t i = 0; i < t->num_nodes; i++) {
+        const ValueData *v = t->nodes[i];
+        if (v->opcode != OP_NONE)
+            emit_forward(out, v);
+    }
+    fprintf(out, "}\n\n");
+
+    fprintf(out, "void cgrad_backward(const scalar_t *v, scalar_t *g) {\n");
+    for (size_t i = t->num_nodes; i > 0; i--) {
+        const ValueData *v = t->nodes[i - 1];
+        if (v->opcode != OP_NONE && v->requires_grad)
+            emit_backward(out, v);
+    }
+    fprintf(out, "}\n");
+
+    return ferror(out) ? -1 : 0;
+}
+
+int tape_codegen_file(const Tape *t, const char *filename) {
+    FILE *file = fopen(filename, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Error: Could not open file %s for writing\n", filename);
+        return -1;
+    }
+    int ret = tape_codegen(t, file);
+    if (fclose(file) != 0)
+        ret = -1;
+    return ret;
+}
+
+/* ================================================================
+ *  Compile and load
+ * ================================================================ */
+
+/* Run $CC on src without a shell, so that neither $CC nor the paths are interpreted */
+static int run_compiler(const char *lib, const char *src) {
+    const char *env = getenv("CC");
+    char cc[256];
+    snprintf(cc, sizeof(cc), "%s", (env && env[0]) ? env : "cc");
+
+    const char *argv[CODEGEN_MAX_CC_WORDS + CODEGEN_NUM_CFLAGS + 4];
+    size_t argc = 0;
+    for (char *word = strtok(cc, " \t"); word && argc < CODEGEN_MAX_CC_WORDS;
+         word = strtok(NULL, " \t"))
+        argv[argc++] = word;
+    if (argc == 0)
+        return -1;
+    for (size_t i = 0; i < CODEGEN_NUM_CFLAGS; i++)
+        argv[argc++] = codegen_cflags[i];
+    argv[argc++] = "-o";
+    argv[argc++] = lib;
+    argv[argc++] = src;
+    argv[argc] = NULL;
+
+    pid_t pid = fork();
+    if (pid < 0)
+        return -1;
+    if (pid == 0) {
+        execvp(argv[0], (char *const *)argv);
+        _exit(127);
+    }
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR)
+            return -1;
+    }
+    return (WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : -1;
+}
+
+/* Private build directory: nobody else can plant or swap the shared object */
+typedef struct JitDir {
+    char dir[4096];
+    char src[4096 + 8];
+    char lib[4096 + 8];
+} JitDir;
+
+static int jit_dir_create(JitDir *d) {
+    const char *tmp = getenv("TMPDIR");
+    if (!tmp || !*tmp)
+        tmp = "/tmp";
+    if (snprintf(d->dir, sizeof(d->dir), "%s/cgrad-jit-XXXXXX", tmp) >= (int)sizeof(d->dir))
+        return -1;
+    if (!mkdtemp(d->dir)) // Mode 0700
+        return -1;
+    snprintf(d->src, sizeof(d->src), "%s/tape.c", d->dir);
+    snprintf(d->lib, sizeof(d->lib), "%s/tape.so", d->dir);
+    return 0;
+}
+
+static void jit_dir_remove(const JitDir *d) {
+    unlink(d->src);
+    unlink(d->lib);
+    rmdir(d->dir);
+}
+
+CompiledTape *tape_compile(const Tape *t) {
+    if (!t)
+        return NULL;
+
+    JitDir d;
+    if (jit_dir_create(&d) != 0) {
+        fprintf(stderr, "Error: Could not create a temporary build directory\n");
+        return NULL;
+    }
+
+    int fd = open(d.src, O_WRONLY | O_CREAT | O_EXCL, 0600);
+    FILE *file = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (!file) {
+        if (fd >= 0)
+            close(fd);
+        jit_dir_remove(&d);
+        return NULL;
+    }
+    int ret = tape_codegen(t, file);
+    if (fclose(file) != 0 || ret != 0) {
+        jit_dir_remove(&d);
+        return NULL;
+    }
+
+    void *handle = NULL;
+    if (run_compiler(d.lib, d.src) == 0) {
+        handle = dlopen(d.lib, RTLD_NOW | RTLD_LOCAL);
+        if (!handle)
+            fprintf(stderr, "Error: dlopen failed: %s\n", dlerror());
+    }
+    jit_dir_remove(&d); // The loaded object stays mapped
+    if (!handle)
+        return NULL;
+
+    CompiledTape *c = (CompiledTape *)calloc(1, sizeof(CompiledTape));
+    if (!c) {
+        dlclose(handle);
+        return NULL;
+    }
+    c->handle = handle;
+    c->forward = (CompiledForwardFn)dlsym(handle, "cgrad_forward");
+    c->backward = (CompiledBackwardFn)dlsym(handle, "cgrad_backward");
+    c->num_nodes = t->num_nodes;
+    c->values = (scalar_t *)calloc(t->num_nodes + 1, sizeof(scalar_t));
+    c->grads = (scalar_t *)calloc(t->num_nodes + 1, sizeof(scalar_t));
+    c->leaf_ids = (size_t *)malloc(sizeof(size_t) * (t->num_nodes + 1));
+    if (!c->forward || !c->backward || !c->values || !c->grads || !c->leaf_ids) {
+        compiled_tape_destroy(c);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < t->num_nodes; i++) {
+        const ValueData *v = t->nodes[i];
+        if (v->opcode == OP_NONE && !value_is_constant(v))
+            c->leaf_ids[c->num_leaves++] = i;
+    }
+    return c;
+}
+
+void compiled_tape_destroy(CompiledTape *c) {
+    if (!c)
+        return;
+    if (c->handle)
+        dlclose(c->handle);
+    free(c->values);
+    free(c->grads);
+    free(c->leaf_ids);
+    free(c);
+}
+
+void compiled_tape_forward(CompiledTape *c, const Tape *t) {
+    if (!c || !t || t->num_nodes != c->num_nodes)
+        return;
+
+    for (size_t i = 0; i < c->num_leaves; i++) {
+        size_t id = c->leaf_ids[i];
+        c->values[id] = t->nodes[id]->data;
+    }
+    c->forward(c->values);
+}
+
+void compiled_tape_backward(CompiledTape *c, const ValueData *output) {
+    if (!c || !output || output->id >= c->num_nodes)
+        return;
+
+    memset(c->grads, 0, sizeof(scalar_t) * c->num_nodes);
+    c->grads[output->id] = 1.0;
+    c->backward(c->values, c->grads);
+}
+
+scalar_t compiled_tape_data(const CompiledTape *c, const ValueData *v) {
+    return (c && v && v->id < c->num_nodes) ? c->values[v->id] : 0.0;
+}
+
+scalar_t compiled_tape_grad(const CompiledTape *c, const ValueData *v) {
+    return (c && v && v->id < c->num_nodes) ? c->grads[v->id] : 0.0;
+}
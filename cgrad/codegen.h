@@ -0,0 +1,70 @@
+/*
+Tape-to-C code generation and local compile-and-load.
+*/
+
+#ifndef CGRAD_CODEGEN_H
+#define CGRAD_CODEGEN_H
+
+#include "tape.h"
+#include "value.h"
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Entry points of the generated code; arrays are indexed by node id */
+typedef void (*CompiledForwardFn)(scalar_t *values);
+typedef void (*CompiledBackwardFn)(const scalar_t *values, scalar_t *grads);
+
+/* A tape compiled to native code and loaded with dlopen */
+typedef struct CompiledTape {
+    void *handle;
+    CompiledForwardFn forward;
+    CompiledBackwardFn backward;
+
+    size_t num_nodes;
+    scalar_t *values; // Node values, indexed by node id
+    scalar_t *grads;  // Node gradients, indexed by node id
+
+    size_t *leaf_ids; // Non-constant leaves loaded before each forward
+    size_t num_leaves;
+} CompiledTape;
+
+/*
+ * Emit the tape as straight-line C: cgrad_forward() and cgrad_backward(),
+ * one statement per node, constants (see value_is_constant) baked in.
+ * Returns 0 on success, -1 on error: a node codegen does not support
+ * (checkpoints, subgraphs), an input from another tape or a write error.
+ * Nothing is printed.
+ */
+int tape_codegen(const Tape *t, FILE *out);
+int tape_codegen_file(const Tape *t, const char *filename);
+
+/*
+ * Generate, compile with the system C compiler ($CC, default "cc") and load
+ * the tape. $CC is split on whitespace and run directly, without a shell.
+ * The source and the shared object are written to a private directory made
+ * under $TMPDIR (default /tmp) and removed once the object is loaded. The
+ * compiled code is bound to the tape structure at this point: leaf values
+ * may change, but the graph must not.
+ */
+CompiledTape *tape_compile(const Tape *t);
+void compiled_tape_destroy(CompiledTape *c);
+
+/* Load leaf values from the tape and run the forward pass */
+void compiled_tape_forward(CompiledTape *c, const Tape *t);
+
+/* Seed d(output)/d(output) = 1 and run the backward pass */
+void compiled_tape_backward(CompiledTape *c, const ValueData *output);
+
+/* Results of the last run */
+scalar_t compiled_tape_data(const CompiledTape *c, const ValueData *v);
+scalar_t compiled_tape_grad(const CompiledTape *c, const ValueData *v);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CGRAD_CODEGEN_H
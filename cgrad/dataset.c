@@ -0,0 +1,549 @@
+/* dataset.c - Streaming datasets */
+
+#include "dataset.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Map a whole file read-only; returns MAP_FAILED on error */
+static void *map_file(const char *path, size_t *size) {
+    int fd = path ? open(path, O_RDONLY) : -1;
+    if (fd < 0)
+        return MAP_FAILED;
+
+    struct stat st;
+    void *base = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        *size = (size_t)st.st_size;
+        base = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    return base;
+}
+
+static Dataset *dataset_alloc(size_t num_rows, size_t num_cols) {
+    Dataset *ds = (Dataset *)calloc(1, sizeof(Dataset));
+    if (!ds)
+        return NULL;
+    ds->num_rows = num_rows;
+    ds->num_cols = num_cols;
+    ds->order = (size_t *)malloc(sizeof(size_t) * (num_rows + 1));
+    if (!ds->order) {
+        free(ds);
+        return NULL;
+    }
+    for (size_t i = 0; i < num_rows; i++)
+        ds->order[i] = i;
+    return ds;
+}
+
+/* ================================================================
+ *  Binary files
+ * ================================================================ */
+
+static void header_init(DatasetHeader *h, size_t num_rows, size_t num_cols) {
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, DATASET_MAGIC, sizeof(h->magic));
+    h->version = DATASET_VERSION;
+    h->scalar_size = (uint32_t)sizeof(scalar_t);
+    h->num_rows = num_rows;
+    h->num_cols = num_cols;
+    h->data_offset = 64;
+}
+
+int dataset_write_binary(const char *path, const scalar_t *data, size_t num_rows,
+                         size_t num_cols) {
+    FILE *file = path ? fopen(path, "wb") : NULL;
+    if (!file)
+        return -1;
+
+    DatasetHeader h;
+    header_init(&h, num_rows, num_cols);
+    uint8_t pad[64] = {0};
+    size_t count = num_rows * num_cols;
+    int ret = 0;
+    if (fwrite(&h, sizeof(h), 1, file) != 1 ||
+        fwrite(pad, 1, h.data_offset - sizeof(h), file) != h.data_offset - sizeof(h) ||
+        (count && fwrite(data, sizeof(scalar_t), count, file) != count))
+        ret = -1;
+    if (fclose(file) != 0)
+        ret = -1;
+    return ret;
+}
+
+Dataset *dataset_open(const char *path) {
+    size_t size = 0;
+    void *base = map_file(path, &size);
+    if (base == MAP_FAILED)
+        return NULL;
+
+    const DatasetHeader *h = (const DatasetHeader *)base;
+    int ok = size >= sizeof(DatasetHeader) &&
+             memcmp(h->magic, DATASET_MAGIC, sizeof(h->magic)) == 0 &&
+             h->version == DATASET_VERSION && h->scalar_size == sizeof(scalar_t) &&
+             h->data_offset % sizeof(scalar_t) == 0 && h->data_offset <= size && h->num_cols > 0 &&
+             h->num_rows <= (size - h->data_offset) / sizeof(scalar_t) / h->num_cols;
+    Dataset *ds = ok ? dataset_alloc((size_t)h->num_rows, (size_t)h->num_cols) : NULL;
+    if (!ds) {
+        if (!ok)
+            fprintf(stderr, "Error: %s is not a valid dataset for this build\n", path);
+        munmap(base, size);
+        return NULL;
+    }
+
+    ds->map = base;
+    ds->map_size = size;
+    ds->data = (const scalar_t *)((const uint8_t *)base + h->data_offset);
+    madvise(base, size, MADV_SEQUENTIAL);
+    return ds;
+}
+
+/* ================================================================
+ *  CSV
+ * ================================================================ */
+
+/*
+ * Parse a decimal number at *p (no locale, no allocation). Returns 0 and
+ * advances *p on success.
+ */
+static int parse_number(const char **p, const char *end, double *out) {
+    static const double pow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                   1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                   1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char *s = *p;
+    int neg = 0, digits = 0, exp = 0;
+    uint64_t mant = 0;
+
+    if (s < end && (*s == '-' || *s == '+'))
+        neg = *s++ == '-';
+    for (; s < end && *s >= '0' && *s <= '9'; s++, digits++) {
+        if (mant < UINT64_MAX / 10 - 9)
+            mant = mant * 10 + (uint64_t)(*s - '0');
+        else
+            exp++;
+    }
+    if (s < end && *s == '.') {
+        for (s++; s < end && *s >= '0' && *s <= '9'; s++, digits++) {
+            if (mant < UINT64_MAX / 10 - 9) {
+                mant = mant * 10 + (uint64_t)(*s - '0');
+                exp--;
+            }
+        }
+    }
+    if (digits == 0)
+        return -1;
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        int eneg = 0, e = 0;
+        s++;
+        if (s < end && (*s == '-' || *s == '+'))
+            eneg = *s++ == '-';
+        if (s >= end || *s < '0' || *s > '9')
+            return -1;
+        for (; s < end && *s >= '0' && *s <= '9'; s++)
+            e = e < 10000 ? e * 10 + (*s - '0') : e;
+        exp += eneg ? -e : e;
+    }
+
+    double v = (double)mant;
+    while (exp > 22) {
+        v *= 1e22;
+        exp -= 22;
+    }
+    while (exp < -22) {
+        v /= 1e22;
+        exp += 22;
+    }
+    v = exp >= 0 ? v * pow10[exp] : v / pow10[-exp];
+    *out = neg ? -v : v;
+    *p = s;
+    return 0;
+}
+
+/* Called once per parsed row */
+typedef int (*CsvRowFn)(const scalar_t *row, size_t num_cols, void *ctx);
+
+/*
+ * Parse every non-empty line of a mapped CSV file. The column count is fixed
+ * by the first row; returns it, or 0 on a malformed file.
+ */
+static size_t csv_parse(const char *s, const char *end, int skip_header, CsvRowFn fn, void *ctx) {
+    size_t cap = 64, num_cols = 0;
+    scalar_t *row = (scalar_t *)malloc(sizeof(scalar_t) * cap);
+    int ok = row != NULL;
+
+    if (skip_header) {
+        while (s < end && *s != '\n')
+            s++;
+    }
+
+    while (ok && s < end) {
+        size_t n = 0;
+        while (s < end && (*s == ' ' || *s == '\t' || *s == '\r' || *s == '\n'))
+            s++;
+        if (s >= end)
+            break;
+
+        for (;;) {
+            double v;
+            while (s < end && (*s == ' ' || *s == '\t'))
+                s++;
+            if (parse_number(&s, end, &v) != 0) {
+                ok = 0;
+                break;
+            }
+            if (n == cap) {
+                scalar_t *grown = (scalar_t *)realloc(row, sizeof(scalar_t) * cap * 2);
+                if (!grown) {
+                    ok = 0;
+                    break;
+                }
+                row = grown;
+                cap *= 2;
+            }
+            row[n++] = (scalar_t)v;
+            while (s < end && (*s == ' ' || *s == '\t' || *s == '\r'))
+                s++;
+            if (s < end && *s == ',') {
+                s++;
+                continue;
+            }
+            if (s < end && *s != '\n')
+                ok = 0;
+            break;
+        }
+
+        if (ok && num_cols == 0)
+            num_cols = n;
+        if (ok && (n != num_cols || fn(row, n, ctx) != 0))
+            ok = 0;
+    }
+
+    free(row);
+    return ok ? num_cols : 0;
+}
+
+typedef struct CsvWriter {
+    FILE *file;
+    size_t num_rows;
+} CsvWriter;
+
+static int csv_write_row(const scalar_t *row, size_t num_cols, void *ctx) {
+    CsvWriter *w = (CsvWriter *)ctx;
+    w->num_rows++;
+    return fwrite(row, sizeof(scalar_t), num_cols, w->file) == num_cols ? 0 : -1;
+}
+
+int dataset_convert_csv(const char *csv_path, const char *bin_path, int skip_header) {
+    size_t size = 0;
+    void *text = map_file(csv_path, &size);
+    if (text == MAP_FAILED)
+        return -1;
+    madvise(text, size, MADV_SEQUENTIAL);
+
+    CsvWriter w = {bin_path ? fopen(bin_path, "wb") : NULL, 0};
+    DatasetHeader h;
+    header_init(&h, 0, 0);
+    int ret = w.file ? 0 : -1;
+
+    /* Rows are streamed after a placeholder header, which is rewritten at the end */
+    if (ret == 0 && fseek(w.file, (long)h.data_offset, SEEK_SET) != 0)
+        ret = -1;
+    size_t num_cols = 0;
+    if (ret == 0) {
+        num_cols = csv_parse((const char *)text, (const char *)text + size, skip_header,
+                             csv_write_row, &w);
+        ret = num_cols ? 0 : -1;
+    }
+    if (ret == 0) {
+        header_init(&h, w.num_rows, num_cols);
+        if (fseek(w.file, 0, SEEK_SET) != 0 || fwrite(&h, sizeof(h), 1, w.file) != 1)
+            ret = -1;
+    }
+    if (w.file && fclose(w.file) != 0)
+        ret = -1;
+    munmap(text, size);
+    return ret;
+}
+
+typedef struct CsvBuffer {
+    scalar_t *data;
+    size_t len;
+    size_t cap;
+    size_t num_rows;
+} CsvBuffer;
+
+static int csv_append_row(const scalar_t *row, size_t num_cols, void *ctx) {
+    CsvBuffer *b = (CsvBuffer *)ctx;
+    if (b->len + num_cols > b->cap) {
+        size_t cap = b->cap ? b->cap * 2 : 1024;
+        while (cap < b->len + num_cols)
+            cap *= 2;
+        scalar_t *grown = (scalar_t *)realloc(b->data, sizeof(scalar_t) * cap);
+        if (!grown)
+            return -1;
+        b->data = grown;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, row, sizeof(scalar_t) * num_cols);
+    b->len += num_cols;
+    b->num_rows++;
+    return 0;
+}
+
+Dataset *dataset_load_csv(const char *path, int skip_header) {
+    size_t size = 0;
+    void *text = map_file(path, &size);
+    if (text == MAP_FAILED)
+        return NULL;
+    madvise(text, size, MADV_SEQUENTIAL);
+
+    CsvBuffer b = {NULL, 0, 0, 0};
+    size_t num_cols = csv_parse((const char *)text, (const char *)text + size, skip_header,
+                                csv_append_row, &b);
+    munmap(text, size);
+
+    Dataset *ds = num_cols ? dataset_alloc(b.num_rows, num_cols) : NULL;
+    if (!ds) {
+        free(b.data);
+        return NULL;
+    }
+    ds->owned = b.data;
+    ds->data = b.data;
+    return ds;
+}
+
+void dataset_close(Dataset *ds) {
+    if (!ds)
+        return;
+    if (ds->map)
+        munmap(ds->map, ds->map_size);
+    free(ds->owned);
+    free(ds->order);
+    free(ds);
+}
+
+/* ================================================================
+ *  Access
+ * ================================================================ */
+
+/* xorshift64*: small, fast and good enough for shuffling */
+static uint64_t next_random(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ull;
+}
+
+void dataset_shuffle(Dataset *ds, uint64_t seed) {
+    if (!ds)
+        return;
+    uint64_t state = seed ? seed : 0x9E3779B97F4A7C15ull;
+    for (size_t i = ds->num_rows; i > 1; i--) {
+        size_t j = (size_t)(next_random(&state) % i);
+        size_t tmp = ds->order[i - 1];
+        ds->order[i - 1] = ds->order[j];
+        ds->order[j] = tmp;
+    }
+
+    /* Visiting rows out of order: sequential readahead would only waste I/O */
+    if (ds->map)
+        madvise(ds->map, ds->map_size, MADV_RANDOM);
+}
+
+const scalar_t *dataset_row(const Dataset *ds, size_t pos) {
+    if (!ds || pos >= ds->num_rows)
+        return NULL;
+    return ds->data + ds->order[pos] * ds->num_cols;
+}
+
+size_t dataset_gather(const Dataset *ds, size_t first, size_t count, scalar_t *out) {
+    if (!ds || !out || first >= ds->num_rows)
+        return 0;
+    if (count > ds->num_rows - first)
+        count = ds->num_rows - first;
+
+    for (size_t r = 0; r < count; r++)
+        memcpy(out + r * ds->num_cols, dataset_row(ds, first + r),
+               sizeof(scalar_t) * ds->num_cols);
+    return count;
+}
+
+/* ================================================================
+ *  Batched loading with prefetch
+ * ================================================================ */
+
+/*
+ * Two batch buffers: the caller reads one while the prefetch thread fills the
+ * other. ready[i] is set by the producer and cleared when the caller moves on.
+ */
+struct DataLoader {
+    Dataset *ds;
+    size_t batch_size;
+    int shuffle;
+    uint64_t seed;
+    size_t epoch;
+
+    scalar_t *buffers[2];
+    size_t rows[2];
+    int ready[2];
+    size_t produced; // Batches gathered this epoch
+    size_t consumed; // Batches handed to the caller this epoch
+
+    int prefetch;
+    int running; // Prefetch thread alive
+    int stop;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+static size_t num_batches(const DataLoader *dl) {
+    return (dl->ds->num_rows + dl->batch_size - 1) / dl->batch_size;
+}
+
+static void *prefetch_main(void *arg) {
+    DataLoader *dl = (DataLoader *)arg;
+    size_t total = num_batches(dl);
+
+    pthread_mutex_lock(&dl->lock);
+    while (!dl->stop && dl->produced < total) {
+        size_t b = dl->produced;
+        size_t slot = b % 2;
+        if (dl->ready[slot] || b > dl->consumed + 1) {
+            pthread_cond_wait(&dl->cond, &dl->lock);
+            continue;
+        }
+
+        /* Gather outside the lock: the caller never touches this slot meanwhile */
+        pthread_mutex_unlock(&dl->lock);
+        size_t rows = dataset_gather(dl->ds, b * dl->batch_size, dl->batch_size, dl->buffers[slot]);
+        pthread_mutex_lock(&dl->lock);
+
+        dl->rows[slot] = rows;
+        dl->ready[slot] = 1;
+        dl->produced++;
+        pthread_cond_broadcast(&dl->cond);
+    }
+    pthread_mutex_unlock(&dl->lock);
+    return NULL;
+}
+
+static void stop_prefetch(DataLoader *dl) {
+    if (!dl->running)
+        return;
+    pthread_mutex_lock(&dl->lock);
+    dl->stop = 1;
+    pthread_cond_broadcast(&dl->cond);
+    pthread_mutex_unlock(&dl->lock);
+    pthread_join(dl->thread, NULL);
+    dl->running = 0;
+}
+
+static void start_epoch(DataLoader *dl) {
+    if (dl->shuffle)
+        dataset_shuffle(dl->ds, dl->seed + dl->epoch);
+    dl->produced = 0;
+    dl->consumed = 0;
+    dl->ready[0] = dl->ready[1] = 0;
+    dl->stop = 0;
+    if (dl->prefetch)
+        dl->running = pthread_create(&dl->thread, NULL, prefetch_main, dl) == 0;
+}
+
+DataLoader *dataloader_create(Dataset *ds, size_t batch_size, int shuffle, uint64_t seed,
+                              int prefetch) {
+    if (!ds || batch_size == 0)
+        return NULL;
+
+    DataLoader *dl = (DataLoader *)calloc(1, sizeof(DataLoader));
+    if (!dl)
+        return NULL;
+    dl->ds = ds;
+    dl->batch_size = batch_size;
+    dl->shuffle = shuffle;
+    dl->seed = seed;
+    dl->prefetch = prefetch;
+    for (size_t i = 0; i < 2; i++) {
+        dl->buffers[i] = (scalar_t *)malloc(sizeof(scalar_t) * batch_size * (ds->num_cols + 1));
+        if (!dl->buffers[i]) {
+            free(dl->buffers[0]);
+            free(dl);
+            return NULL;
+        }
+    }
+    pthread_mutex_init(&dl->lock, NULL);
+    pthread_cond_init(&dl->cond, NULL);
+    start_epoch(dl);
+    return dl;
+}
+
+void dataloader_destroy(DataLoader *dl) {
+    if (!dl)
+        return;
+    stop_prefetch(dl);
+    pthread_mutex_destroy(&dl->lock);
+    pthread_cond_destroy(&dl->cond);
+    free(dl->buffers[0]);
+    free(dl->buffers[1]);
+    free(dl);
+}
+
+const scalar_t *dataloader_next(DataLoader *dl, size_t *rows) {
+    if (!dl)
+        return NULL;
+
+    size_t b = dl->consumed;
+    size_t slot = b % 2;
+    if (b >= num_batches(dl)) {
+        if (rows)
+            *rows = 0;
+        return NULL;
+    }
+
+    if (!dl->running) {
+        /* Synchronous: gather on the caller's thread */
+        dl->rows[slot] = dataset_gather(dl->ds, b * dl->batch_size, dl->batch_size,
+                                        dl->buffers[slot]);
+        dl->consumed++;
+    } else {
+        pthread_mutex_lock(&dl->lock);
+        /* The batch handed out last time is no longer in use */
+        if (b > 0)
+            dl->ready[(b - 1) % 2] = 0;
+        dl->consumed++;
+        pthread_cond_broadcast(&dl->cond);
+        while (!dl->ready[slot])
+            pthread_cond_wait(&dl->cond, &dl->lock);
+        pthread_mutex_unlock(&dl->lock);
+    }
+
+    if (rows)
+        *rows = dl->rows[slot];
+    return dl->buffers[slot];
+}
+
+size_t dataloader_next_leaves(DataLoader *dl, ValueData **leaves) {
+    size_t rows = 0;
+    const scalar_t *batch = dataloader_next(dl, &rows);
+    if (!batch || !leaves)
+        return 0;
+
+    size_t n = rows * dl->ds->num_cols;
+    for (size_t i = 0; i < n; i++)
+        leaves[i]->data = batch[i];
+    return rows;
+}
+
+void dataloader_reset(DataLoader *dl) {
+    if (!dl)
+        return;
+    stop_prefetch(dl);
+    dl->epoch++;
+    start_epoch(dl);
+}
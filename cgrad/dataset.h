@@ -0,0 +1,107 @@
+/*
+Streaming datasets: memory-mapped binary files, CSV parsing, shuffled batches
+and background prefetch.
+*/
+
+#ifndef CGRAD_DATASET_H
+#define CGRAD_DATASET_H
+
+#include "value.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Binary dataset file: a DatasetHeader followed, at data_offset, by
+ * num_rows * num_cols scalar_t values in row-major order (native byte order).
+ */
+#define DATASET_MAGIC   "CGRADSET"
+#define DATASET_VERSION 1
+
+typedef struct DatasetHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t scalar_size; // sizeof(scalar_t) of the producer
+    uint64_t num_rows;
+    uint64_t num_cols;
+    uint64_t data_offset;
+} DatasetHeader;
+
+/* A table of rows, either mapped from a binary file or owned in memory */
+typedef struct Dataset {
+    const scalar_t *data; // Row-major values
+    size_t num_rows;
+    size_t num_cols;
+    size_t *order; // Visiting order of the rows (identity until shuffled)
+
+    void *map; // Mapping of a binary file, or NULL
+    size_t map_size;
+    scalar_t *owned; // Values parsed into memory, or NULL
+} Dataset;
+
+/* Write rows to a binary dataset file; returns 0 on success, -1 on error */
+int dataset_write_binary(const char *path, const scalar_t *data, size_t num_rows,
+                         size_t num_cols);
+
+/*
+ * Convert a CSV file of numbers to a binary dataset file, one row at a time,
+ * so that files larger than memory can be converted. When skip_header is set
+ * the first line is ignored. Returns 0 on success, -1 on a malformed file.
+ */
+int dataset_convert_csv(const char *csv_path, const char *bin_path, int skip_header);
+
+/* Map a binary dataset file; the rows are paged in on demand */
+Dataset *dataset_open(const char *path);
+
+/* Parse a CSV file of numbers into memory */
+Dataset *dataset_load_csv(const char *path, int skip_header);
+
+void dataset_close(Dataset *ds);
+
+/* Shuffle the visiting order (Fisher-Yates, deterministic for a given seed) */
+void dataset_shuffle(Dataset *ds, uint64_t seed);
+
+/* Row at position pos of the visiting order */
+const scalar_t *dataset_row(const Dataset *ds, size_t pos);
+
+/*
+ * Gather count rows starting at position first of the visiting order into out
+ * (count * num_cols values). Returns the number of rows copied, which is
+ * smaller than count at the end of the dataset.
+ */
+size_t dataset_gather(const Dataset *ds, size_t first, size_t count, scalar_t *out);
+
+/*
+ * Batched iteration over a dataset. With prefetch, the next batch is gathered
+ * on a background thread while the caller computes on the current one.
+ */
+typedef struct DataLoader DataLoader;
+
+DataLoader *dataloader_create(Dataset *ds, size_t batch_size, int shuffle, uint64_t seed,
+                              int prefetch);
+void dataloader_destroy(DataLoader *dl);
+
+/*
+ * Next batch of the epoch: returns a row-major buffer of *rows rows that stays
+ * valid until the following call, or NULL once the epoch is over.
+ */
+const scalar_t *dataloader_next(DataLoader *dl, size_t *rows);
+
+/*
+ * Same as dataloader_next, but writes the batch into the data of leaves
+ * (batch_size * num_cols nodes, row-major) and returns the number of rows,
+ * 0 at the end of the epoch.
+ */
+size_t dataloader_next_leaves(DataLoader *dl, ValueData **leaves);
+
+/* Start the next epoch, reshuffling if the loader shuffles */
+void dataloader_reset(DataLoader *dl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CGRAD_DATASET_H
@@ -0,0 +1,314 @@
+/* distrib.c - Shared-memory gradient all-reduce between worker processes */
+
+#include "distrib.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define DIST_MAGIC    "CGRADDST"
+#define DIST_ALIGN    64
+#define DIST_NAME_LEN 64
+#define DIST_MAX_SIZE 256
+
+/* Start of the shared segment */
+typedef struct DistHeader {
+    char magic[8];
+    uint32_t scalar_size;
+    uint32_t size;
+    uint64_t num_params;
+    int launched; // dist_fork: 1 once every child exists, -1 if launching failed
+    pthread_barrier_t barrier;
+} DistHeader;
+
+struct DistGroup {
+    DistHeader *header;
+    void *base;
+    size_t map_size;
+
+    scalar_t *params;
+    scalar_t *reduced;
+    scalar_t *rows;
+    size_t num_params;
+    size_t stride; // Scalars between rows, padded to DIST_ALIGN bytes
+
+    int rank;
+    int size;
+    int forked;
+    pid_t *children; // Rank 0 of a forked group
+    char name[DIST_NAME_LEN]; // Rank 0 of a created group, to unlink it
+};
+
+static size_t align_up(size_t x) {
+    return (x + DIST_ALIGN - 1) & ~(size_t)(DIST_ALIGN - 1);
+}
+
+static size_t row_stride(size_t num_params) {
+    return align_up(num_params * sizeof(scalar_t)) / sizeof(scalar_t);
+}
+
+static size_t segment_size(int size, size_t num_params) {
+    return align_up(sizeof(DistHeader)) +
+           (size_t)(size + 2) * row_stride(num_params) * sizeof(scalar_t);
+}
+
+/* Map an open shared memory object and wrap it in a group */
+static DistGroup *group_map(int fd, size_t map_size, int rank) {
+    void *base = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED)
+        return NULL;
+
+    DistGroup *g = (DistGroup *)calloc(1, sizeof(DistGroup));
+    if (!g) {
+        munmap(base, map_size);
+        return NULL;
+    }
+    g->base = base;
+    g->map_size = map_size;
+    g->header = (DistHeader *)base;
+    g->rank = rank;
+    return g;
+}
+
+/* Point the group at the sections described by the header */
+static void group_layout(DistGroup *g) {
+    g->size = (int)g->header->size;
+    g->num_params = (size_t)g->header->num_params;
+    g->stride = row_stride(g->num_params);
+    g->params = (scalar_t *)((uint8_t *)g->base + align_up(sizeof(DistHeader)));
+    g->reduced = g->params + g->stride;
+    g->rows = g->reduced + g->stride;
+}
+
+static void group_free(DistGroup *g) {
+    munmap(g->base, g->map_size);
+    free(g->children);
+    free(g);
+}
+
+/* Create and map a named segment, with the header and barrier initialized */
+static DistGroup *segment_create(const char *name, int size, size_t num_params) {
+    if (size < 1 || size > DIST_MAX_SIZE || !name || strlen(name) >= DIST_NAME_LEN)
+        return NULL;
+
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+        return NULL;
+    size_t map_size = segment_size(size, num_params);
+    DistGroup *g = ftruncate(fd, (off_t)map_size) == 0 ? group_map(fd, map_size, 0) : NULL;
+    close(fd);
+    if (!g) {
+        shm_unlink(name);
+        return NULL;
+    }
+
+    DistHeader *h = g->header;
+    h->scalar_size = (uint32_t)sizeof(scalar_t);
+    h->size = (uint32_t)size;
+    h->num_params = (uint64_t)num_params;
+    h->launched = 0;
+
+    pthread_barrierattr_t attr;
+    pthread_barrierattr_init(&attr);
+    pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    int err = pthread_barrier_init(&h->barrier, &attr, (unsigned)size);
+    pthread_barrierattr_destroy(&attr);
+    if (err != 0) {
+        group_free(g);
+        shm_unlink(name);
+        return NULL;
+    }
+
+    /* Written last: a joining process checks it before anything else */
+    memcpy(h->magic, DIST_MAGIC, sizeof(h->magic));
+    group_layout(g);
+    return g;
+}
+
+DistGroup *dist_create(const char *name, int size, size_t num_params) {
+    DistGroup *g = segment_create(name, size, num_params);
+    if (g)
+        snprintf(g->name, sizeof(g->name), "%s", name);
+    return g;
+}
+
+DistGroup *dist_join(const char *name, int rank) {
+    if (!name || rank < 1)
+        return NULL;
+    int fd = shm_open(name, O_RDWR, 0600);
+    if (fd < 0)
+        return NULL;
+
+    /*
+     * The size is only known from the header. Rank 0 may not have sized the
+     * object yet, and touching pages past its end would raise SIGBUS.
+     */
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        st.st_size = 0;
+    DistGroup *g = NULL;
+    if ((size_t)st.st_size >= sizeof(DistHeader))
+        g = group_map(fd, sizeof(DistHeader), rank);
+    size_t map_size = 0;
+    if (g && memcmp(g->header->magic, DIST_MAGIC, sizeof(g->header->magic)) == 0 &&
+        g->header->scalar_size == sizeof(scalar_t) && rank < (int)g->header->size)
+        map_size = segment_size((int)g->header->size, (size_t)g->header->num_params);
+    if (g)
+        group_free(g);
+    if ((size_t)st.st_size < map_size)
+        map_size = 0;
+
+    g = map_size ? group_map(fd, map_size, rank) : NULL;
+    close(fd);
+    if (!g)
+        return NULL;
+    group_layout(g);
+    return g;
+}
+
+DistGroup *dist_fork(int size, size_t num_params) {
+    static unsigned counter = 0;
+    char name[DIST_NAME_LEN];
+    snprintf(name, sizeof(name), "/cgrad-%ld-%u", (long)getpid(), counter++);
+    DistGroup *g = segment_create(name, size, num_params);
+    /* Forked children inherit the mapping: the name is not needed past this point */
+    shm_unlink(name);
+    if (!g)
+        return NULL;
+    g->forked = 1;
+    g->children = (pid_t *)calloc((size_t)size, sizeof(pid_t));
+    if (!g->children) {
+        group_free(g);
+        return NULL;
+    }
+
+    /* Buffered output would otherwise be written once per process */
+    fflush(NULL);
+
+    int launched = 1;
+    for (int r = 1; r < size; r++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            free(g->children);
+            g->children = NULL;
+            g->rank = r;
+            /* Hold until every sibling exists, so that a failed launch leaves no worker */
+            int state;
+            while ((state = __atomic_load_n(&g->header->launched, __ATOMIC_ACQUIRE)) == 0)
+                sched_yield();
+            if (state < 0)
+                _exit(1);
+            return g;
+        }
+        if (pid < 0) {
+            launched = -1;
+            break;
+        }
+        g->children[r] = pid;
+    }
+
+    __atomic_store_n(&g->header->launched, launched, __ATOMIC_RELEASE);
+    if (launched < 0) {
+        for (int r = 1; r < size && g->children[r] > 0; r++)
+            waitpid(g->children[r], NULL, 0);
+        group_free(g);
+        return NULL;
+    }
+    return g;
+}
+
+int dist_rank(const DistGroup *g) {
+    return g ? g->rank : -1;
+}
+
+int dist_size(const DistGroup *g) {
+    return g ? g->size : 0;
+}
+
+void dist_barrier(DistGroup *g) {
+    if (g && g->size > 1)
+        pthread_barrier_wait(&g->header->barrier);
+}
+
+int dist_allreduce_grad(DistGroup *g, ParamStore *s, int average) {
+    if (!g || !s || s->num_params != g->num_params)
+        return -1;
+
+    size_t n = g->num_params;
+    memcpy(g->rows + (size_t)g->rank * g->stride, s->grad, sizeof(scalar_t) * n);
+    dist_barrier(g);
+
+    /* Reduce-scatter: this worker sums its chunk over all rows, in rank order */
+    size_t chunk = (n + (size_t)g->size - 1) / (size_t)g->size;
+    size_t begin = chunk * (size_t)g->rank;
+    size_t end = begin + chunk < n ? begin + chunk : n;
+    if (begin < end) {
+        scalar_t *restrict out = g->reduced + begin;
+        size_t len = end - begin;
+        memcpy(out, g->rows + begin, sizeof(scalar_t) * len);
+        for (int w = 1; w < g->size; w++) {
+            const scalar_t *restrict row = g->rows + (size_t)w * g->stride + begin;
+            for (size_t i = 0; i < len; i++)
+                out[i] += row[i];
+        }
+        if (average) {
+            scalar_t scale = (scalar_t)1.0 / (scalar_t)g->size;
+            for (size_t i = 0; i < len; i++)
+                out[i] *= scale;
+        }
+    }
+    dist_barrier(g);
+
+    /* All-gather: read every chunk back. The next call's first barrier keeps
+     * the reduced buffer stable until everyone has copied it. */
+    memcpy(s->grad, g->reduced, sizeof(scalar_t) * n);
+    return 0;
+}
+
+int dist_broadcast_params(DistGroup *g, ParamStore *s, int root) {
+    if (!g || !s || s->num_params != g->num_params || root < 0 || root >= g->size)
+        return -1;
+
+    if (g->rank == root)
+        memcpy(g->params, s->data, sizeof(scalar_t) * g->num_params);
+    dist_barrier(g);
+    if (g->rank != root)
+        memcpy(s->data, g->params, sizeof(scalar_t) * g->num_params);
+    dist_barrier(g);
+    return 0;
+}
+
+int dist_finish(DistGroup *g, int status) {
+    if (!g)
+        return -1;
+
+    if (g->forked && g->rank != 0) {
+        fflush(NULL);
+        _exit(status);
+    }
+
+    int result = status == 0 ? 0 : -1;
+    if (g->forked) {
+        for (int r = 1; r < g->size; r++) {
+            int child_status;
+            if (waitpid(g->children[r], &child_status, 0) < 0 || !WIFEXITED(child_status) ||
+                WEXITSTATUS(child_status) != 0)
+                result = -1;
+        }
+    } else {
+        /* Nobody may still be inside a collective when rank 0 removes the name */
+        dist_barrier(g);
+        if (g->rank == 0)
+            shm_unlink(g->name);
+    }
+    group_free(g);
+    return result;
+}
@@ -0,0 +1,85 @@
+/*
+Multi-process data parallelism: gradient all-reduce through POSIX shared memory.
+*/
+
+#ifndef CGRAD_DISTRIB_H
+#define CGRAD_DISTRIB_H
+
+#include "params.h"
+#include "value.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A group of worker processes on one machine. Each worker records and
+ * differentiates its own shard of the batch on its own tape, then the group
+ * sums the gradients through a shared segment laid out as
+ *
+ *   DistHeader (process-shared barrier)
+ *   scalar_t params[num_params]          broadcast buffer
+ *   scalar_t reduced[num_params]         summed gradients
+ *   scalar_t rows[size][num_params]      one gradient row per worker
+ *
+ * Every worker then applies the same optimizer step to the same summed
+ * gradient, so the parameter copies stay identical without being exchanged.
+ * Collective calls must be made by every worker in the same order; a worker
+ * that dies mid-step leaves the others waiting.
+ */
+typedef struct DistGroup DistGroup;
+
+/*
+ * Create a group of `size` processes by forking size - 1 children, with room
+ * for num_params gradients. Returns in every process of the group: rank 0 in
+ * the caller, 1 .. size - 1 in the children. NULL on error (no child is left
+ * running).
+ */
+DistGroup *dist_fork(int size, size_t num_params);
+
+/*
+ * For workers started some other way (e.g. one process per NUMA node under
+ * numactl): rank 0 creates the segment under a name such as "/cgrad-job",
+ * then ranks 1 .. size - 1 join it. dist_create returns before the others
+ * have joined; the first collective call waits for them.
+ *
+ * dist_join returns NULL while the segment does not exist or is not fully
+ * set up yet, as well as for a rank out of range or a segment from a build
+ * with another scalar type. A worker started alongside rank 0 should retry
+ * (e.g. sleep and try again, with a deadline).
+ */
+DistGroup *dist_create(const char *name, int size, size_t num_params);
+DistGroup *dist_join(const char *name, int rank);
+
+int dist_rank(const DistGroup *g);
+int dist_size(const DistGroup *g);
+
+/* Wait until every worker has reached the barrier */
+void dist_barrier(DistGroup *g);
+
+/*
+ * Sum s->grad over all workers, or average it when average is set, leaving
+ * the result in every worker's s->grad. The reduction is split in `size`
+ * chunks, each summed by one worker (reduce-scatter), then read by all
+ * (all-gather); workers are summed in rank order, so every process gets
+ * bit-identical results. Returns 0 on success, -1 if s does not match the
+ * group.
+ */
+int dist_allreduce_grad(DistGroup *g, ParamStore *s, int average);
+
+/* Copy the parameter values of rank `root` into every worker's store */
+int dist_broadcast_params(DistGroup *g, ParamStore *s, int root);
+
+/*
+ * Leave the group. In a forked child this exits the process with `status`
+ * and does not return. Rank 0 of a forked group waits for every child and
+ * returns -1 if one of them failed. Ranks of a created group unmap the
+ * segment; rank 0 also removes its name.
+ */
+int dist_finish(DistGroup *g, int status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CGRAD_DISTRIB_H
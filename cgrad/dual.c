@@ -0,0 +1,222 @@
+/* dual.c - Forward-mode automatic differentiation */
+
+#include "dual.h"
+
+#include "fusion.h"
+
+#include <stdlib.h>
+
+Dual dual_apply(ValueOp op, Dual a, Dual b) {
+    switch (op) {
+    case OP_ADD:
+        return dual_add(a, b);
+    case OP_SUB:
+        return dual_sub(a, b);
+    case OP_MUL:
+        return dual_mul(a, b);
+    case OP_DIV:
+        return dual_div(a, b);
+    default:
+        return dual_const(0.0f);
+    }
+}
+
+/* Dual value of a node input; nodes off the tape carry no tangent */
+static inline Dual node_dual(const Tape *t, const ValueData *x, const scalar_t *tan) {
+    return dual_make(x->data, tape_contains(t, x) ? tan[x->id] : 0.0f);
+}
+
+static scalar_t fused_tangent(const Tape *t, const FusedKernel *k, const scalar_t *tan) {
+    Dual regs[FUSED_MAX_STEPS];
+    Dual in[FUSED_MAX_INPUTS];
+    for (size_t i = 0; i < k->num_inputs; i++)
+        in[i] = node_dual(t, k->inputs[i], tan);
+
+    for (size_t s = 0; s < k->num_steps; s++) {
+        const FusedStep *st = &k->steps[s];
+        Dual a = FUSED_IS_REG(st->lhs) ? regs[FUSED_INDEX(st->lhs)] : in[st->lhs];
+        Dual b = FUSED_IS_REG(st->rhs) ? regs[FUSED_INDEX(st->rhs)] : in[st->rhs];
+        regs[s] = dual_apply(st->op, a, b);
+    }
+    return regs[k->num_steps - 1].tan;
+}
+
+/* Tangent of every node on the tape, seeded by tan[] on entry */
+static int tangent_sweep(const Tape *t, scalar_t *tan) {
+    for (size_t i = 0; i < t->num_nodes; i++) {
+        const ValueData *v = t->nodes[i];
+        if (v->opcode == OP_NONE)
+            continue;
+
+        if (value_op_is_binary(v->opcode)) {
+            Dual a = node_dual(t, v->children[0], tan);
+            Dual b = node_dual(t, v->children[1], tan);
+            tan[i] = dual_apply(v->opcode, a, b).tan;
+        } else if (v->opcode == OP_FUSED) {
+            tan[i] = fused_tangent(t, (const FusedKernel *)v->ctx, tan);
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int tape_jvp(const Tape *t, ValueData **inputs, const scalar_t *tangents, size_t num_inputs,
+             ValueData **outputs, scalar_t *out_tangents, size_t num_outputs) {
+    if (!t || (num_inputs && (!inputs || !tangents)) || (num_outputs && (!outputs || !out_tangents)))
+        return -1;
+
+    scalar_t *tan = (scalar_t *)calloc(t->num_nodes + 1, sizeof(scalar_t));
+    if (!tan)
+        return -1;
+
+    for (size_t k = 0; k < num_inputs; k++) {
+        if (tape_contains(t, inputs[k]))
+            tan[inputs[k]->id] += tangents[k];
+    }
+
+    int ret = tangent_sweep(t, tan);
+    for (size_t k = 0; k < num_outputs && ret == 0; k++)
+        out_tangents[k] = tape_contains(t, outputs[k]) ? tan[outputs[k]->id] : 0.0f;
+
+    free(tan);
+    return ret;
+}
+
+/* ================================================================
+ *  Forward-over-reverse (Hessian-vector products)
+ * ================================================================ */
+
+/*
+ * Local partials of a binary op as dual numbers: the tangent part is the
+ * derivative of the backward rule along the seeded direction. These mirror
+ * backward_add/sub/mul/div in value.c.
+ */
+static void dual_partials(ValueOp op, Dual a, Dual b, Dual *da, Dual *db) {
+    switch (op) {
+    case OP_ADD:
+        *da = dual_const(1.0f);
+        *db = dual_const(1.0f);
+        break;
+    case OP_SUB:
+        *da = dual_const(1.0f);
+        *db = dual_const(-1.0f);
+        break;
+    case OP_MUL:
+        *da = b;
+        *db = a;
+        break;
+    case OP_DIV:
+        *da = dual_div(dual_const(1.0f), b);
+        *db = dual_div(dual_sub(dual_const(0.0f), a), dual_mul(b, b));
+        break;
+    default:
+        *da = dual_const(0.0f);
+        *db = dual_const(0.0f);
+        break;
+    }
+}
+
+/* Dual adjoint (gradient, gradient tangent) of the nodes, indexed by id */
+typedef struct DualAdjoints {
+    scalar_t *grad;
+    scalar_t *grad_tan;
+} DualAdjoints;
+
+static inline void adjoint_accumulate(const Tape *t, DualAdjoints *adj, const ValueData *x,
+                                      Dual g) {
+    if (!tape_contains(t, x))
+        return;
+    adj->grad[x->id] += g.val;
+    adj->grad_tan[x->id] += g.tan;
+}
+
+static void fused_hvp(const Tape *t, const FusedKernel *k, const scalar_t *tan, DualAdjoints *adj,
+                      Dual g) {
+    Dual in[FUSED_MAX_INPUTS];
+    Dual regs[FUSED_MAX_STEPS];
+    Dual radj[FUSED_MAX_STEPS];
+    for (size_t i = 0; i < k->num_inputs; i++)
+        in[i] = node_dual(t, k->inputs[i], tan);
+
+    for (size_t s = 0; s < k->num_steps; s++) {
+        const FusedStep *st = &k->steps[s];
+        Dual a = FUSED_IS_REG(st->lhs) ? regs[FUSED_INDEX(st->lhs)] : in[st->lhs];
+        Dual b = FUSED_IS_REG(st->rhs) ? regs[FUSED_INDEX(st->rhs)] : in[st->rhs];
+        regs[s] = dual_apply(st->op, a, b);
+        radj[s] = dual_const(0.0f);
+    }
+    radj[k->num_steps - 1] = g;
+
+    for (size_t s = k->num_steps; s > 0; s--) {
+        const FusedStep *st = &k->steps[s - 1];
+        Dual a = FUSED_IS_REG(st->lhs) ? regs[FUSED_INDEX(st->lhs)] : in[st->lhs];
+        Dual b = FUSED_IS_REG(st->rhs) ? regs[FUSED_INDEX(st->rhs)] : in[st->rhs];
+        Dual da, db;
+        dual_partials(st->op, a, b, &da, &db);
+
+        uint8_t ops[2] = {st->lhs, st->rhs};
+        Dual contrib[2] = {dual_mul(radj[s - 1], da), dual_mul(radj[s - 1], db)};
+        for (size_t j = 0; j < 2; j++) {
+            if (FUSED_IS_REG(ops[j]))
+                radj[FUSED_INDEX(ops[j])] = dual_add(radj[FUSED_INDEX(ops[j])], contrib[j]);
+            else
+                adjoint_accumulate(t, adj, k->inputs[ops[j]], contrib[j]);
+        }
+    }
+}
+
+int tape_hvp(const Tape *t, ValueData *output, ValueData **params, const scalar_t *direction,
+             size_t num_params, scalar_t *hv, scalar_t *grad) {
+    if (!t || !tape_contains(t, output) || (num_params && (!params || !direction || !hv)))
+        return -1;
+
+    size_t n = t->num_nodes;
+    scalar_t *tan = (scalar_t *)calloc(n, sizeof(scalar_t));
+    DualAdjoints adj = {(scalar_t *)calloc(n, sizeof(scalar_t)),
+                        (scalar_t *)calloc(n, sizeof(scalar_t))};
+    int ret = (tan && adj.grad && adj.grad_tan) ? 0 : -1;
+
+    /* Forward: tangents of every node along the direction */
+    for (size_t k = 0; k < num_params && ret == 0; k++) {
+        if (tape_contains(t, params[k]))
+            tan[params[k]->id] += direction[k];
+    }
+    if (ret == 0)
+        ret = tangent_sweep(t, tan);
+
+    /* Reverse: dual adjoints, seeded with d(output)/d(output) = 1 */
+    if (ret == 0)
+        adj.grad[output->id] = 1.0f;
+    for (size_t i = output->id + 1; i > 0 && ret == 0; i--) {
+        const ValueData *v = t->nodes[i - 1];
+        Dual g = dual_make(adj.grad[i - 1], adj.grad_tan[i - 1]);
+        if (v->opcode == OP_NONE || (g.val == 0.0f && g.tan == 0.0f))
+            continue;
+
+        if (value_op_is_binary(v->opcode)) {
+            Dual a = node_dual(t, v->children[0], tan);
+            Dual b = node_dual(t, v->children[1], tan);
+            Dual da, db;
+            dual_partials(v->opcode, a, b, &da, &db);
+            adjoint_accumulate(t, &adj, v->children[0], dual_mul(g, da));
+            adjoint_accumulate(t, &adj, v->children[1], dual_mul(g, db));
+        } else if (v->opcode == OP_FUSED) {
+            fused_hvp(t, (const FusedKernel *)v->ctx, tan, &adj, g);
+        } else {
+            ret = -1;
+        }
+    }
+
+    for (size_t k = 0; k < num_params && ret == 0; k++) {
+        int on_tape = tape_contains(t, params[k]);
+        hv[k] = on_tape ? adj.grad_tan[params[k]->id] : 0.0f;
+        if (grad)
+            grad[k] = on_tape ? adj.grad[params[k]->id] : 0.0f;
+    }
+
+    free(tan);
+    free(adj.grad);
+    free(adj.grad_tan);
+    return ret;
+}
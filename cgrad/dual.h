@@ -0,0 +1,95 @@
+/*
+Forward-mode automatic differentiation with dual numbers, and second-order
+products built on top of it.
+*/
+
+#ifndef CGRAD_DUAL_H
+#define CGRAD_DUAL_H
+
+#include "tape.h"
+#include "value.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Dual number val + tan * eps, with eps^2 = 0 */
+typedef struct Dual {
+    scalar_t val; // Primal value
+    scalar_t tan; // Directional derivative
+} Dual;
+
+/*
+ * The dual operations are small enough to inline: a forward-mode evaluation
+ * is plain arithmetic on pairs, with no tape and no allocation.
+ */
+static inline Dual dual_make(scalar_t val, scalar_t tan) {
+    Dual d = {val, tan};
+    return d;
+}
+
+static inline Dual dual_const(scalar_t val) {
+    return dual_make(val, 0.0f);
+}
+
+/* Binary operations */
+static inline Dual dual_add(Dual a, Dual b) {
+    return dual_make(a.val + b.val, a.tan + b.tan);
+}
+
+static inline Dual dual_sub(Dual a, Dual b) {
+    return dual_make(a.val - b.val, a.tan - b.tan);
+}
+
+static inline Dual dual_mul(Dual a, Dual b) {
+    return dual_make(a.val * b.val, a.tan * b.val + a.val * b.tan);
+}
+
+static inline Dual dual_div(Dual a, Dual b) {
+    return dual_make(a.val / b.val, (a.tan * b.val - a.val * b.tan) / (b.val * b.val));
+}
+
+/* Scalar-on-left operations */
+static inline Dual scalar_add_dual(scalar_t s, Dual d) {
+    return dual_add(dual_const(s), d);
+}
+
+static inline Dual scalar_sub_dual(scalar_t s, Dual d) {
+    return dual_sub(dual_const(s), d);
+}
+
+static inline Dual scalar_mul_dual(scalar_t s, Dual d) {
+    return dual_mul(dual_const(s), d);
+}
+
+static inline Dual scalar_div_dual(scalar_t s, Dual d) {
+    return dual_div(dual_const(s), d);
+}
+
+/* Apply a binary opcode to dual numbers */
+Dual dual_apply(ValueOp op, Dual a, Dual b);
+
+/*
+ * Jacobian-vector product over a recorded tape: seed the inputs with the given
+ * tangents and sweep forward once, writing d(output)/d(direction) for every
+ * output. Leaves that are not listed as inputs have a zero tangent. Returns 0
+ * on success, -1 on error (including checkpoint nodes, which are opaque).
+ */
+int tape_jvp(const Tape *t, ValueData **inputs, const scalar_t *tangents, size_t num_inputs,
+             ValueData **outputs, scalar_t *out_tangents, size_t num_outputs);
+
+/*
+ * Hessian-vector product by forward-over-reverse: one tangent sweep along
+ * direction, then one reverse sweep carrying dual adjoints, so that
+ * hv[k] = sum_j d2(output)/d(params[k])d(params[j]) * direction[j].
+ * The gradient d(output)/d(params[k]) is written to grad[k] when grad is not
+ * NULL. Node grad fields are left untouched. Returns 0 on success, -1 on error.
+ */
+int tape_hvp(const Tape *t, ValueData *output, ValueData **params, const scalar_t *direction,
+             size_t num_params, scalar_t *hv, scalar_t *grad);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CGRAD_DUAL_H
@@ -0,0 +1,298 @@
+/* fusion.c - Elementwise op fusion */
+
+#include "fusion.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static inline scalar_t operand_value(const scalar_t *in, const scalar_t *regs, uint8_t o) {
+    return FUSED_IS_REG(o) ? regs[FUSED_INDEX(o)] : in[o];
+}
+
+scalar_t fused_program_eval(const FusedKernel *k, const scalar_t *in, scalar_t *regs) {
+    for (size_t s = 0; s < k->num_steps; s++) {
+        const FusedStep *st = &k->steps[s];
+        scalar_t a = operand_value(in, regs, st->lhs);
+        scalar_t b = operand_value(in, regs, st->rhs);
+        switch (st->op) {
+        case OP_ADD:
+            regs[s] = a + b;
+            break;
+        case OP_SUB:
+            regs[s] = a - b;
+            break;
+        case OP_MUL:
+            regs[s] = a * b;
+            break;
+        case OP_DIV:
+            regs[s] = a / b;
+            break;
+        default:
+            regs[s] = 0.0f;
+            break;
+        }
+    }
+    return regs[k->num_steps - 1];
+}
+
+static void gather_inputs(const FusedKernel *k, scalar_t *in) {
+    for (size_t i = 0; i < k->num_inputs; i++)
+        in[i] = k->inputs[i]->data;
+}
+
+scalar_t fused_kernel_eval(const FusedKernel *k, scalar_t *regs) {
+    scalar_t in[FUSED_MAX_INPUTS];
+    gather_inputs(k, in);
+    return fused_program_eval(k, in, regs);
+}
+
+void fused_forward(ValueData *v) {
+    scalar_t regs[FUSED_MAX_STEPS];
+    v->data = fused_kernel_eval((const FusedKernel *)v->ctx, regs);
+}
+
+/* Route a local adjoint either to a register or to an input node */
+static inline void accumulate(const FusedKernel *k, scalar_t *adj, uint8_t o, scalar_t g) {
+    if (FUSED_IS_REG(o))
+        adj[FUSED_INDEX(o)] += g;
+    else
+        k->inputs[o]->grad += g;
+}
+
+void fused_backward(ValueData *v) {
+    const FusedKernel *k = (const FusedKernel *)v->ctx;
+    scalar_t in[FUSED_MAX_INPUTS];
+    scalar_t regs[FUSED_MAX_STEPS];
+    scalar_t adj[FUSED_MAX_STEPS] = {0};
+
+    /* Intermediates are rematerialized rather than stored */
+    gather_inputs(k, in);
+    fused_program_eval(k, in, regs);
+    adj[k->num_steps - 1] = v->grad;
+
+    for (size_t s = k->num_steps; s > 0; s--) {
+        const FusedStep *st = &k->steps[s - 1];
+        scalar_t g = adj[s - 1];
+        scalar_t a = operand_value(in, regs, st->lhs);
+        scalar_t b = operand_value(in, regs, st->rhs);
+        switch (st->op) {
+        case OP_ADD:
+            accumulate(k, adj, st->lhs, g);
+            accumulate(k, adj, st->rhs, g);
+            break;
+        case OP_SUB:
+            accumulate(k, adj, st->lhs, g);
+            accumulate(k, adj, st->rhs, -g);
+            break;
+        case OP_MUL:
+            accumulate(k, adj, st->lhs, b * g);
+            accumulate(k, adj, st->rhs, a * g);
+            break;
+        case OP_DIV:
+            accumulate(k, adj, st->lhs, g / b);
+            accumulate(k, adj, st->rhs, -(a / (b * b)) * g);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/* ================================================================
+ *  Fusion pass
+ * ================================================================ */
+
+/* Kernel under construction: inputs are gathered before being copied to the arena */
+typedef struct KernelBuilder {
+    FusedKernel k;
+    ValueData *inputs[FUSED_MAX_INPUTS];
+} KernelBuilder;
+
+static uint8_t builder_input(KernelBuilder *b, ValueData *x) {
+    for (size_t i = 0; i < b->k.num_inputs; i++) {
+        if (b->inputs[i] == x)
+            return (uint8_t)i;
+    }
+    b->inputs[b->k.num_inputs] = x;
+    return (uint8_t)b->k.num_inputs++;
+}
+
+static uint8_t builder_step(KernelBuilder *b, ValueOp op, uint8_t lhs, uint8_t rhs) {
+    FusedStep *st = &b->k.steps[b->k.num_steps];
+    st->op = op;
+    st->lhs = lhs;
+    st->rhs = rhs;
+    return (uint8_t)(FUSED_REG | b->k.num_steps++);
+}
+
+/* Inline an absorbed child's program and return the operand holding its result */
+static uint8_t builder_inline(KernelBuilder *b, const ValueData *c) {
+    if (c->opcode != OP_FUSED) {
+        uint8_t lhs = builder_input(b, c->children[0]);
+        uint8_t rhs = builder_input(b, c->children[1]);
+        return builder_step(b, c->opcode, lhs, rhs);
+    }
+
+    const FusedKernel *ck = (const FusedKernel *)c->ctx;
+    uint8_t base = (uint8_t)b->k.num_steps;
+    uint8_t map[FUSED_MAX_INPUTS];
+    for (size_t i = 0; i < ck->num_inputs; i++)
+        map[i] = builder_input(b, ck->inputs[i]);
+
+    for (size_t s = 0; s < ck->num_steps; s++) {
+        const FusedStep *st = &ck->steps[s];
+        uint8_t lhs = FUSED_IS_REG(st->lhs) ? (uint8_t)(st->lhs + base) : map[st->lhs];
+        uint8_t rhs = FUSED_IS_REG(st->rhs) ? (uint8_t)(st->rhs + base) : map[st->rhs];
+        builder_step(b, st->op, lhs, rhs);
+    }
+    return (uint8_t)(FUSED_REG | (b->k.num_steps - 1));
+}
+
+/* Turn v into an OP_FUSED node running program on inputs */
+static int install_kernel(Tape *t, ValueData *v, const FusedKernel *program, ValueData **inputs,
+                          BackwardFn backward) {
+    /* Kernel and its input list live in the arena, next to the nodes */
+    FusedKernel *k = (FusedKernel *)tape_allocate(t, sizeof(FusedKernel));
+    ValueData **in = (ValueData **)tape_allocate(t, sizeof(ValueData *) * program->num_inputs);
+    if (!k || !in)
+        return -1;
+
+    *k = *program;
+    memcpy(in, inputs, sizeof(ValueData *) * program->num_inputs);
+    k->inputs = in;
+
+    v->opcode = OP_FUSED;
+    strncpy(v->op, value_op_symbol(OP_FUSED), sizeof(v->op) - 1);
+    v->op[sizeof(v->op) - 1] = '\0';
+    v->ctx = k;
+    v->children[0] = NULL;
+    v->children[1] = NULL;
+    v->num_children = 0;
+    v->backward_fn = v->requires_grad ? backward : NULL;
+    return 0;
+}
+
+/* The program is well formed and fits a kernel */
+static int program_valid(const FusedKernel *program) {
+    return program && program->num_steps > 0 && program->num_steps <= FUSED_MAX_STEPS &&
+           program->num_inputs <= FUSED_MAX_INPUTS;
+}
+
+static int inputs_require_grad(const FusedKernel *program, ValueData **inputs) {
+    int requires_grad = 0;
+    for (size_t i = 0; i < program->num_inputs; i++)
+        requires_grad |= inputs[i]->requires_grad;
+    return requires_grad;
+}
+
+ValueData *value_fused_with_tape(Tape *t, const FusedKernel *program, ValueData **inputs) {
+    if (!t || !program_valid(program))
+        return NULL;
+
+    scalar_t in[FUSED_MAX_INPUTS] = {0};
+    scalar_t regs[FUSED_MAX_STEPS];
+    for (size_t i = 0; i < program->num_inputs; i++)
+        in[i] = inputs[i]->data;
+    return value_fused_compiled(t, program, inputs, fused_program_eval(program, in, regs),
+                                fused_backward);
+}
+
+ValueData *value_fused_compiled(Tape *t, const FusedKernel *program, ValueData **inputs,
+                                scalar_t data, BackwardFn backward) {
+    if (!t || !program_valid(program) || !backward)
+        return NULL;
+
+    ValueData *v = value_create_with_tape(t, data, NULL, inputs_require_grad(program, inputs));
+    if (!v || install_kernel(t, v, program, inputs, backward) != 0)
+        return NULL;
+    return v;
+}
+
+static size_t kernel_steps(const ValueData *v) {
+    return v->opcode == OP_FUSED ? ((const FusedKernel *)v->ctx)->num_steps : 1;
+}
+
+size_t tape_fuse(Tape *t, ValueData **outputs, size_t num_outputs) {
+    if (!t || t->num_nodes == 0)
+        return 0;
+
+    size_t n = t->num_nodes;
+    size_t *uses = (size_t *)calloc(n, sizeof(size_t));
+    uint8_t *absorbed = (uint8_t *)calloc(n, sizeof(uint8_t));
+    if (!uses || !absorbed) {
+        free(uses);
+        free(absorbed);
+        return 0;
+    }
+
+    /* Consumer counts; outputs count as an external consumer */
+    for (size_t i = 0; i < n; i++) {
+        size_t count;
+        ValueData **in = value_inputs(t->nodes[i], &count);
+        for (size_t j = 0; j < count; j++) {
+            if (tape_contains(t, in[j]))
+                uses[in[j]->id]++;
+        }
+    }
+    for (size_t k = 0; k < num_outputs; k++) {
+        if (tape_contains(t, outputs[k]))
+            uses[outputs[k]->id]++;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        ValueData *v = t->nodes[i];
+        if (!value_op_is_binary(v->opcode))
+            continue;
+
+        /* Decide which children to absorb within the step budget */
+        int absorb[2] = {0, 0};
+        size_t steps = 1;
+        for (size_t j = 0; j < 2; j++) {
+            ValueData *c = v->children[j];
+            if (!tape_contains(t, c) || uses[c->id] != 1)
+                continue;
+            if (!value_op_is_binary(c->opcode) && c->opcode != OP_FUSED)
+                continue;
+            if (steps + kernel_steps(c) > FUSED_MAX_STEPS)
+                continue;
+            absorb[j] = 1;
+            steps += kernel_steps(c);
+        }
+        if (!absorb[0] && !absorb[1])
+            continue;
+
+        KernelBuilder b;
+        b.k.num_inputs = 0;
+        b.k.num_steps = 0;
+        uint8_t ops[2];
+        for (size_t j = 0; j < 2; j++) {
+            ValueData *c = v->children[j];
+            ops[j] = absorb[j] ? builder_inline(&b, c) : builder_input(&b, c);
+        }
+        builder_step(&b, v->opcode, ops[0], ops[1]);
+
+        ValueData *children[2] = {v->children[0], v->children[1]};
+        if (install_kernel(t, v, &b.k, b.inputs, fused_backward) != 0)
+            continue;
+        for (size_t j = 0; j < 2; j++) {
+            if (absorb[j])
+                absorbed[children[j]->id] = 1;
+        }
+    }
+
+    /* Compact the node index and renumber */
+    size_t kept = 0;
+    for (size_t i = 0; i < n; i++) {
+        ValueData *v = t->nodes[i];
+        if (absorbed[i])
+            continue;
+        v->id = kept;
+        t->nodes[kept++] = v;
+    }
+    t->num_nodes = kept;
+    tape_hash_invalidate(t);
+
+    free(uses);
+    free(absorbed);
+    return n - kept;
+}
@@ -0,0 +1,80 @@
+/*
+Elementwise op fusion: chains of single-consumer nodes collapsed into one node.
+*/
+
+#ifndef CGRAD_FUSION_H
+#define CGRAD_FUSION_H
+
+#include "tape.h"
+#include "value.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Maximum number of primitive ops in a fused kernel */
+#define FUSED_MAX_STEPS 16
+
+/* A chain of n binary ops has at most n + 1 distinct inputs */
+#define FUSED_MAX_INPUTS (FUSED_MAX_STEPS + 1)
+
+/* Operand encoding: kernel input index, or register index with the high bit set */
+#define FUSED_REG          0x80
+#define FUSED_IS_REG(o)    ((o) & FUSED_REG)
+#define FUSED_INDEX(o)     ((o) & ~FUSED_REG)
+
+/* One primitive op; its result is written to the register of the same index */
+typedef struct FusedStep {
+    ValueOp op;
+    uint8_t lhs;
+    uint8_t rhs;
+} FusedStep;
+
+/* Straight-line program of an OP_FUSED node; the last register is the output */
+typedef struct FusedKernel {
+    size_t num_inputs;
+    struct ValueData **inputs;
+    size_t num_steps;
+    FusedStep steps[FUSED_MAX_STEPS];
+} FusedKernel;
+
+/* Evaluate the program on input values in[0..num_inputs) into regs[0..num_steps) */
+scalar_t fused_program_eval(const FusedKernel *k, const scalar_t *in, scalar_t *regs);
+
+/* Same as fused_program_eval, reading the inputs from the kernel's input nodes */
+scalar_t fused_kernel_eval(const FusedKernel *k, scalar_t *regs);
+
+/*
+ * Record an OP_FUSED node running program (its inputs field is ignored) on
+ * inputs[0..num_inputs). The program is copied into the tape's arena.
+ */
+ValueData *value_fused_with_tape(Tape *t, const FusedKernel *program, ValueData **inputs);
+
+/*
+ * Same, for callers that evaluated the program themselves and have a backward
+ * pass specialized to it (cgrad.hpp compiles both per expression type). The
+ * node records `data` as its value and runs `backward` instead of the
+ * interpreter; replay and the tape passes still go through the program.
+ */
+ValueData *value_fused_compiled(Tape *t, const FusedKernel *program, ValueData **inputs,
+                                scalar_t data, BackwardFn backward);
+
+/* Forward replay and backward pass of an OP_FUSED node */
+void fused_forward(ValueData *v);
+void fused_backward(ValueData *v);
+
+/*
+ * Collapse chains of elementwise ops whose intermediates have a single
+ * consumer into OP_FUSED nodes, and return the number of nodes removed.
+ * The root of each chain is rewritten in place, so pointers held by the
+ * caller stay valid; outputs are never absorbed into their consumers.
+ */
+size_t tape_fuse(Tape *t, ValueData **outputs, size_t num_outputs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CGRAD_FUSION_H
@@ -0,0 +1,58 @@
+/*
+Graph export: buffered DOT output, subgraph extraction, collapsing and summaries.
+*/
+
+#ifndef CGRAD_GRAPH_H
+#define CGRAD_GRAPH_H
+
+#include "tape.h"
+#include "value.h"
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * What to export. Nodes are named n<id> after their position on the tape, so
+ * ids are stable across exports of the same tape and match value->id.
+ */
+typedef struct GraphExportOptions {
+    const ValueData *focus; // Export only the neighbourhood of this node (NULL: whole tape)
+    int depth;              // Hops from focus along inputs and consumers (< 0: unlimited)
+    int collapse;           // Merge structurally identical nodes into one "op xN" node
+    int collapse_depth;     // Levels of inputs the structural signature looks at
+    int show_values;        // Print data and grad in the labels
+} GraphExportOptions;
+
+/* Whole tape, no collapsing, no values; collapse_depth 3 */
+GraphExportOptions graph_export_defaults(void);
+
+/*
+ * Write the selected part of the tape as a DOT file. Everything is formatted
+ * in-process into a buffer; render it with e.g. `dot -Tsvg` or `sfdp` for large
+ * graphs. Nodes whose inputs were cut off by the depth limit are dashed.
+ * Returns 0 on success, -1 on error.
+ */
+int tape_export_dot(const Tape *t, const char *path, const GraphExportOptions *opts);
+
+/* Aggregate shape of a tape */
+typedef struct GraphSummary {
+    size_t num_nodes;
+    size_t num_edges;
+    size_t op_count[OP_COUNT];
+    size_t num_params;    // Leaves that require a gradient
+    size_t num_constants; // See value_is_constant
+    size_t depth;         // Longest input chain, in ops
+    size_t max_fan_out;   // Most consumers of a single node
+} GraphSummary;
+
+void tape_graph_summary(const Tape *t, GraphSummary *s);
+void graph_summary_print(const GraphSummary *s, FILE *f);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CGRAD_GRAPH_H
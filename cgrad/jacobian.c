@@ -0,0 +1,222 @@
+/* jacobian.c - Batched reverse mode */
+
+#include "jacobian.h"
+
+#include "fusion.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define K JACOBIAN_LANES
+
+/* Lane-wise dst += w * src; fixed width so the compiler emits vector code */
+static inline void lanes_axpy(scalar_t *restrict dst, scalar_t w, const scalar_t *restrict src) {
+    for (size_t l = 0; l < K; l++)
+        dst[l] += w * src[l];
+}
+
+/* Exact test: squaring small adjoints would underflow to zero */
+static inline int lanes_zero(const scalar_t *g) {
+    for (size_t l = 0; l < K; l++) {
+        if (g[l] != 0.0f)
+            return 0;
+    }
+    return 1;
+}
+
+/* Local partials of a binary op: d(a op b)/da and d(a op b)/db */
+static inline void partials(ValueOp op, scalar_t a, scalar_t b, scalar_t *wa, scalar_t *wb) {
+    switch (op) {
+    case OP_ADD:
+        *wa = 1.0f;
+        *wb = 1.0f;
+        break;
+    case OP_SUB:
+        *wa = 1.0f;
+        *wb = -1.0f;
+        break;
+    case OP_MUL:
+        *wa = b;
+        *wb = a;
+        break;
+    case OP_DIV:
+        *wa = 1.0f / b;
+        *wb = -a / (b * b);
+        break;
+    default:
+        *wa = 0.0f;
+        *wb = 0.0f;
+        break;
+    }
+}
+
+static void fused_sweep(const Tape *t, const FusedKernel *k, scalar_t *adj, const scalar_t *g) {
+    scalar_t in[FUSED_MAX_INPUTS];
+    scalar_t regs[FUSED_MAX_STEPS];
+    scalar_t radj[FUSED_MAX_STEPS][K];
+
+    for (size_t i = 0; i < k->num_inputs; i++)
+        in[i] = k->inputs[i]->data;
+    fused_program_eval(k, in, regs);
+    memset(radj, 0, sizeof(scalar_t) * K * k->num_steps);
+    memcpy(radj[k->num_steps - 1], g, sizeof(scalar_t) * K);
+
+    for (size_t s = k->num_steps; s > 0; s--) {
+        const FusedStep *st = &k->steps[s - 1];
+        uint8_t ops[2] = {st->lhs, st->rhs};
+        scalar_t vals[2], w[2];
+        for (size_t j = 0; j < 2; j++)
+            vals[j] = FUSED_IS_REG(ops[j]) ? regs[FUSED_INDEX(ops[j])] : in[ops[j]];
+        partials(st->op, vals[0], vals[1], &w[0], &w[1]);
+
+        for (size_t j = 0; j < 2; j++) {
+            if (FUSED_IS_REG(ops[j]))
+                lanes_axpy(radj[FUSED_INDEX(ops[j])], w[j], radj[s - 1]);
+            else if (tape_contains(t, k->inputs[ops[j]]))
+                lanes_axpy(&adj[k->inputs[ops[j]]->id * K], w[j], radj[s - 1]);
+        }
+    }
+}
+
+/* One reverse sweep of K seeds over nodes [0, end) */
+static int reverse_sweep(const Tape *t, scalar_t *adj, size_t end) {
+    for (size_t i = end; i > 0; i--) {
+        const ValueData *v = t->nodes[i - 1];
+        const scalar_t *g = &adj[(i - 1) * K];
+        if (v->opcode == OP_NONE || lanes_zero(g))
+            continue;
+
+        if (value_op_is_binary(v->opcode)) {
+            scalar_t wa, wb;
+            partials(v->opcode, v->children[0]->data, v->children[1]->data, &wa, &wb);
+            if (tape_contains(t, v->children[0]))
+                lanes_axpy(&adj[v->children[0]->id * K], wa, g);
+            if (tape_contains(t, v->children[1]))
+                lanes_axpy(&adj[v->children[1]->id * K], wb, g);
+        } else if (v->opcode == OP_FUSED) {
+            fused_sweep(t, (const FusedKernel *)v->ctx, adj, g);
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* ================================================================
+ *  Seed coloring
+ * ================================================================ */
+
+/* Input support of every node as a bitset of num_words 64-bit words */
+static uint64_t *compute_supports(const Tape *t, ValueData **inputs, size_t num_inputs,
+                                  size_t num_words) {
+    uint64_t *sup = (uint64_t *)calloc(t->num_nodes * num_words, sizeof(uint64_t));
+    if (!sup)
+        return NULL;
+
+    for (size_t j = 0; j < num_inputs; j++)
+        sup[inputs[j]->id * num_words + j / 64] |= 1ull << (j % 64);
+
+    for (size_t i = 0; i < t->num_nodes; i++) {
+        size_t count;
+        ValueData **in = value_inputs(t->nodes[i], &count);
+        for (size_t c = 0; c < count; c++) {
+            if (!tape_contains(t, in[c]))
+                continue;
+            for (size_t w = 0; w < num_words; w++)
+                sup[i * num_words + w] |= sup[in[c]->id * num_words + w];
+        }
+    }
+    return sup;
+}
+
+/* Greedy coloring: color[i] is the seed shared by output i */
+static size_t color_outputs(ValueData **outputs, size_t num_outputs, const uint64_t *sup,
+                            size_t num_words, size_t *color) {
+    uint64_t *used = (uint64_t *)calloc(num_outputs * num_words, sizeof(uint64_t));
+    size_t num_colors = 0;
+    if (!used)
+        return 0;
+
+    for (size_t i = 0; i < num_outputs; i++) {
+        const uint64_t *s = &sup[outputs[i]->id * num_words];
+        size_t c = 0;
+        for (; c < num_colors; c++) {
+            uint64_t overlap = 0;
+            for (size_t w = 0; w < num_words; w++)
+                overlap |= used[c * num_words + w] & s[w];
+            if (!overlap)
+                break;
+        }
+        if (c == num_colors)
+            num_colors++;
+        for (size_t w = 0; w < num_words; w++)
+            used[c * num_words + w] |= s[w];
+        color[i] = c;
+    }
+
+    free(used);
+    return num_colors;
+}
+
+int tape_jacobian(const Tape *t, ValueData **outputs, size_t num_outputs, ValueData **inputs,
+                  size_t num_inputs, scalar_t *jac, unsigned flags) {
+    if (!t || !outputs || !inputs || !jac)
+        return -1;
+    for (size_t i = 0; i < num_outputs; i++) {
+        if (!tape_contains(t, outputs[i]))
+            return -1;
+    }
+    for (size_t j = 0; j < num_inputs; j++) {
+        if (!tape_contains(t, inputs[j]))
+            return -1;
+    }
+
+    size_t num_words = (num_inputs + 63) / 64;
+    size_t *color = (size_t *)malloc(sizeof(size_t) * (num_outputs + 1));
+    uint64_t *sup = NULL;
+    scalar_t *adj = (scalar_t *)malloc(sizeof(scalar_t) * K * (t->num_nodes + 1));
+    int ret = (color && adj) ? 0 : -1;
+
+    size_t num_colors = num_outputs;
+    if (ret == 0 && (flags & JACOBIAN_COLORED)) {
+        sup = compute_supports(t, inputs, num_inputs, num_words);
+        num_colors = sup ? color_outputs(outputs, num_outputs, sup, num_words, color) : 0;
+        if (num_outputs > 0 && num_colors == 0)
+            ret = -1;
+    } else if (ret == 0) {
+        for (size_t i = 0; i < num_outputs; i++)
+            color[i] = i;
+    }
+
+    /* Sweep the seeds K at a time */
+    for (size_t base = 0; ret == 0 && base < num_colors; base += K) {
+        size_t end = 0;
+        memset(adj, 0, sizeof(scalar_t) * K * t->num_nodes);
+        for (size_t i = 0; i < num_outputs; i++) {
+            if (color[i] < base || color[i] >= base + K)
+                continue;
+            adj[outputs[i]->id * K + (color[i] - base)] += 1.0f;
+            if (outputs[i]->id + 1 > end)
+                end = outputs[i]->id + 1;
+        }
+        ret = reverse_sweep(t, adj, end);
+
+        /* Scatter lanes back to rows, masking inputs outside each output's support */
+        for (size_t i = 0; ret == 0 && i < num_outputs; i++) {
+            if (color[i] < base || color[i] >= base + K)
+                continue;
+            const uint64_t *s = sup ? &sup[outputs[i]->id * num_words] : NULL;
+            for (size_t j = 0; j < num_inputs; j++) {
+                int depends = !s || ((s[j / 64] >> (j % 64)) & 1);
+                jac[i * num_inputs + j] =
+                    depends ? adj[inputs[j]->id * K + (color[i] - base)] : 0.0f;
+            }
+        }
+    }
+
+    free(color);
+    free(sup);
+    free(adj);
+    return ret == 0 ? (int)num_colors : -1;
+}
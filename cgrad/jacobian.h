@@ -0,0 +1,41 @@
+/*
+Batched reverse mode: full Jacobians of vector-valued outputs.
+*/
+
+#ifndef CGRAD_JACOBIAN_H
+#define CGRAD_JACOBIAN_H
+
+#include "tape.h"
+#include "value.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Width of the adjoint vector carried by every node in one reverse sweep */
+#define JACOBIAN_LANES 8
+
+/* Seeding strategy */
+#define JACOBIAN_DENSE   0u        // One seed per output
+#define JACOBIAN_COLORED (1u << 0) // Outputs with disjoint input supports share a seed
+
+/*
+ * Fill jac (row-major, num_outputs x num_inputs) with
+ * jac[i * num_inputs + j] = d(outputs[i]) / d(inputs[j]).
+ *
+ * Every node carries a JACOBIAN_LANES-wide adjoint, so up to that many seeds
+ * are propagated in a single reverse sweep over the tape. With
+ * JACOBIAN_COLORED, outputs are greedily grouped so that no two outputs of a
+ * group depend on the same input, which needs far fewer seeds for sparse
+ * Jacobians. Node grad fields are left untouched.
+ *
+ * Returns the number of seeds used, or -1 on error.
+ */
+int tape_jacobian(const Tape *t, ValueData **outputs, size_t num_outputs, ValueData **inputs,
+                  size_t num_inputs, scalar_t *jac, unsigned flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CGRAD_JACOBIAN_H
@@ -0,0 +1,257 @@
+/* memplan.c - Liveness-based memory planner */
+
+#include "memplan.h"
+
+#include <stdlib.h>
+
+/* Last use of a node that must survive the whole plan */
+#define LIFETIME_PINNED SIZE_MAX
+
+/* Stack of recycled slots; LIFO keeps the working set hot */
+typedef struct SlotPool {
+    uint32_t *free;
+    size_t num_free;
+    size_t num_slots;
+} SlotPool;
+
+static uint32_t slot_acquire(SlotPool *pool) {
+    if (pool->num_free > 0)
+        return pool->free[--pool->num_free];
+    return (uint32_t)pool->num_slots++;
+}
+
+static void slot_release(SlotPool *pool, uint32_t slot) {
+    pool->free[pool->num_free++] = slot;
+}
+
+MemoryPlan *memplan_create(const Tape *t, ValueData **outputs, size_t num_outputs) {
+    if (!t || !outputs || num_outputs == 0 || t->num_nodes == 0)
+        return NULL;
+
+    size_t n = t->num_nodes;
+    size_t *last_use = (size_t *)malloc(sizeof(size_t) * n);
+    uint8_t *live = (uint8_t *)calloc(n, sizeof(uint8_t));
+    uint32_t *slot_of = (uint32_t *)malloc(sizeof(uint32_t) * n);
+    MemoryPlan *p = (MemoryPlan *)calloc(1, sizeof(MemoryPlan));
+    SlotPool pool = {(uint32_t *)malloc(sizeof(uint32_t) * n), 0, 0};
+
+    int ok = last_use && live && slot_of && p && pool.free;
+    if (ok) {
+        p->instrs = (PlanInstr *)malloc(sizeof(PlanInstr) * n);
+        p->fused = (PlanFused *)calloc(n, sizeof(PlanFused));
+        p->output_ids = (uint32_t *)malloc(sizeof(uint32_t) * num_outputs);
+        p->output_slots = (uint32_t *)malloc(sizeof(uint32_t) * num_outputs);
+        ok = p->instrs && p->fused && p->output_ids && p->output_slots;
+    }
+
+    /* Liveness from the outputs, walking the tape backwards */
+    for (size_t k = 0; ok && k < num_outputs; k++) {
+        ok = tape_contains(t, outputs[k]);
+        if (ok)
+            live[outputs[k]->id] = 1;
+    }
+    for (size_t i = n; ok && i > 0; i--) {
+        if (!live[i - 1])
+            continue;
+        size_t count;
+        ValueData **in = value_inputs(t->nodes[i - 1], &count);
+        for (size_t j = 0; ok && j < count; j++) {
+            ok = tape_contains(t, in[j]);
+            if (ok)
+                live[in[j]->id] = 1;
+        }
+    }
+
+    /* Lifetimes: the index of the last consumer of each live node */
+    for (size_t i = 0; ok && i < n; i++) {
+        last_use[i] = 0;
+        if (!live[i])
+            continue;
+        size_t count;
+        ValueData **in = value_inputs(t->nodes[i], &count);
+        for (size_t j = 0; j < count; j++)
+            last_use[in[j]->id] = i;
+    }
+    for (size_t k = 0; ok && k < num_outputs; k++)
+        last_use[outputs[k]->id] = LIFETIME_PINNED;
+
+    /* Linear scan: free the inputs that die here, then assign the destination */
+    for (size_t i = 0; ok && i < n; i++) {
+        if (!live[i])
+            continue;
+
+        const ValueData *v = t->nodes[i];
+        if (v->opcode != OP_NONE && v->opcode != OP_FUSED && !value_op_is_binary(v->opcode)) {
+            ok = 0;
+            break;
+        }
+
+        PlanInstr *ins = &p->instrs[p->num_instrs++];
+        ins->op = v->opcode;
+        ins->src[0] = ins->src[1] = 0;
+        ins->fused = 0;
+
+        size_t count;
+        ValueData **in = value_inputs(v, &count);
+        if (v->opcode == OP_NONE) {
+            ins->src[0] = (uint32_t)i;
+        } else if (v->opcode == OP_FUSED) {
+            PlanFused *f = &p->fused[p->num_fused];
+            f->kernel = *(const FusedKernel *)v->ctx;
+            f->kernel.inputs = NULL;
+            f->input_slots = (uint32_t *)malloc(sizeof(uint32_t) * count);
+            if (!f->input_slots) {
+                ok = 0;
+                break;
+            }
+            for (size_t j = 0; j < count; j++)
+                f->input_slots[j] = slot_of[in[j]->id];
+            ins->fused = (uint32_t)p->num_fused++;
+        } else {
+            ins->src[0] = slot_of[in[0]->id];
+            ins->src[1] = slot_of[in[1]->id];
+        }
+
+        /* An input listed twice must only be released once */
+        for (size_t j = 0; j < count; j++) {
+            size_t id = in[j]->id;
+            if (last_use[id] != i)
+                continue;
+            int seen = 0;
+            for (size_t q = 0; q < j; q++)
+                seen |= in[q]->id == id;
+            if (!seen)
+                slot_release(&pool, slot_of[id]);
+        }
+
+        slot_of[i] = slot_acquire(&pool);
+        ins->dst = slot_of[i];
+    }
+
+    if (ok) {
+        p->num_slots = pool.num_slots;
+        p->num_nodes = n;
+        p->num_outputs = num_outputs;
+        for (size_t k = 0; k < num_outputs; k++) {
+            p->output_ids[k] = (uint32_t)outputs[k]->id;
+            p->output_slots[k] = slot_of[outputs[k]->id];
+        }
+    }
+
+    free(last_use);
+    free(live);
+    free(slot_of);
+    free(pool.free);
+    if (!ok) {
+        memplan_destroy(p);
+        return NULL;
+    }
+    return p;
+}
+
+void memplan_destroy(MemoryPlan *p) {
+    if (!p)
+        return;
+    for (size_t i = 0; p->fused && i < p->num_fused; i++)
+        free(p->fused[i].input_slots);
+    free(p->fused);
+    free(p->instrs);
+    free(p->output_ids);
+    free(p->output_slots);
+    free(p);
+}
+
+size_t memplan_num_slots(const MemoryPlan *p) {
+    return p ? p->num_slots : 0;
+}
+
+/* Apply a binary opcode to two scalars */
+static inline scalar_t plan_apply(ValueOp op, scalar_t a, scalar_t b) {
+    switch (op) {
+    case OP_ADD:
+        return a + b;
+    case OP_SUB:
+        return a - b;
+    case OP_MUL:
+        return a * b;
+    default:
+        return a / b;
+    }
+}
+
+int memplan_execute(const MemoryPlan *p, Tape *t, scalar_t *buffer) {
+    if (!p || !t || !buffer || t->num_nodes != p->num_nodes)
+        return -1;
+
+    for (size_t i = 0; i < p->num_instrs; i++) {
+        const PlanInstr *ins = &p->instrs[i];
+        switch (ins->op) {
+        case OP_NONE:
+            buffer[ins->dst] = t->nodes[ins->src[0]]->data;
+            break;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+            buffer[ins->dst] = plan_apply(ins->op, buffer[ins->src[0]], buffer[ins->src[1]]);
+            break;
+        case OP_FUSED: {
+            const PlanFused *f = &p->fused[ins->fused];
+            scalar_t in[FUSED_MAX_INPUTS];
+            scalar_t regs[FUSED_MAX_STEPS];
+            for (size_t j = 0; j < f->kernel.num_inputs; j++)
+                in[j] = buffer[f->input_slots[j]];
+            buffer[ins->dst] = fused_program_eval(&f->kernel, in, regs);
+            break;
+        }
+        default:
+            return -1;
+        }
+    }
+
+    for (size_t k = 0; k < p->num_outputs; k++)
+        t->nodes[p->output_ids[k]]->data = buffer[p->output_slots[k]];
+    return 0;
+}
+
+int memplan_execute_half(const MemoryPlan *p, Tape *t, half_t *buffer, HalfFormat fmt) {
+    if (!p || !t || !buffer || t->num_nodes != p->num_nodes)
+        return -1;
+
+    for (size_t i = 0; i < p->num_instrs; i++) {
+        const PlanInstr *ins = &p->instrs[i];
+        scalar_t r;
+        switch (ins->op) {
+        case OP_NONE:
+            r = t->nodes[ins->src[0]]->data;
+            break;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+            r = plan_apply(ins->op, half_to_scalar(buffer[ins->src[0]], fmt),
+                           half_to_scalar(buffer[ins->src[1]], fmt));
+            break;
+        case OP_FUSED: {
+            const PlanFused *f = &p->fused[ins->fused];
+            scalar_t in[FUSED_MAX_INPUTS];
+            scalar_t regs[FUSED_MAX_STEPS];
+            for (size_t j = 0; j < f->kernel.num_inputs; j++)
+                in[j] = half_to_scalar(buffer[f->input_slots[j]], fmt);
+            r = fused_program_eval(&f->kernel, in, regs);
+            break;
+        }
+        default:
+            return -1;
+        }
+        buffer[ins->dst] = half_from_scalar(r, fmt);
+    }
+
+    for (size_t k = 0; k < p->num_outputs; k++)
+        t->nodes[p->output_ids[k]]->data = half_to_scalar(buffer[p->output_slots[k]], fmt);
+    return 0;
+}
+
+scalar_t memplan_output(const MemoryPlan *p, const scalar_t *buffer, size_t k) {
+    return (p && buffer && k < p->num_outputs) ? buffer[p->output_slots[k]] : 0.0;
+}
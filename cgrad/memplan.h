@@ -0,0 +1,83 @@
+/*
+Liveness-based memory planner for inference graphs.
+*/
+
+#ifndef CGRAD_MEMPLAN_H
+#define CGRAD_MEMPLAN_H
+
+#include "fusion.h"
+#include "precision.h"
+#include "tape.h"
+#include "value.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* One instruction of a plan; OP_NONE loads a leaf value from the tape */
+typedef struct PlanInstr {
+    ValueOp op;
+    uint32_t dst;    // Destination slot
+    uint32_t src[2]; // Operand slots (binary ops), or source node id (loads)
+    uint32_t fused;  // Index into MemoryPlan::fused (OP_FUSED only)
+} PlanInstr;
+
+/* Copy of a fused kernel program with its inputs resolved to slots */
+typedef struct PlanFused {
+    FusedKernel kernel; // inputs == NULL, see input_slots
+    uint32_t *input_slots;
+} PlanFused;
+
+/* Forward-only execution plan over a fixed buffer of reusable slots */
+typedef struct MemoryPlan {
+    PlanInstr *instrs;
+    size_t num_instrs;
+
+    PlanFused *fused;
+    size_t num_fused;
+
+    size_t num_slots; // Buffer length needed by memplan_execute
+    size_t num_nodes; // Size of the tape the plan was built for
+
+    uint32_t *output_ids; // Output node ids
+    uint32_t *output_slots;
+    size_t num_outputs;
+} MemoryPlan;
+
+/*
+ * Compute node lifetimes relative to the outputs and assign every live node a
+ * slot that is recycled as soon as its last consumer has run. Only the nodes
+ * that reach the outputs are scheduled; output slots are never recycled.
+ * Returns NULL on error (no outputs, inputs off the tape, out of memory).
+ */
+MemoryPlan *memplan_create(const Tape *t, ValueData **outputs, size_t num_outputs);
+void memplan_destroy(MemoryPlan *p);
+
+/* Slots needed by the plan; the caller's buffer must hold this many scalars */
+size_t memplan_num_slots(const MemoryPlan *p);
+
+/*
+ * Run the plan on a tape with the structure it was built from: leaf values are
+ * read from the tape, every intermediate lives in buffer, and the results are
+ * written back to the output nodes. Returns 0 on success, -1 on mismatch.
+ */
+int memplan_execute(const MemoryPlan *p, Tape *t, scalar_t *buffer);
+
+/*
+ * Same as memplan_execute, but every slot is stored in a 16-bit format:
+ * operands are widened to scalar_t for the arithmetic and each result is
+ * rounded on store, halving the memory traffic of the buffer. The buffer
+ * must hold memplan_num_slots() half_t words.
+ */
+int memplan_execute_half(const MemoryPlan *p, Tape *t, half_t *buffer, HalfFormat fmt);
+
+/* Value of the k-th output in buffer after memplan_execute */
+scalar_t memplan_output(const MemoryPlan *p, const scalar_t *buffer, size_t k);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CGRAD_MEMPLAN_H
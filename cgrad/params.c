@@ -0,0 +1,290 @@
+/* params.c - Persistent parameter store and optimizers */
+
+#include "params.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef CGRAD_DOUBLE
+#define scalar_sqrt sqrt
+#define scalar_pow pow
+#else
+#define scalar_sqrt sqrtf
+#define scalar_pow powf
+#endif
+
+/* Smallest slice of the store worth handing to a thread */
+#define PARAMS_MIN_PER_THREAD 16384
+
+/* Maximum number of optimizer threads */
+#define PARAMS_MAX_THREADS 64
+
+#define PARAMS_ALIGN 64 // Cache line
+
+/* Zeroed array of cap scalars starting on a cache line */
+static scalar_t *alloc_array(size_t cap) {
+    size_t bytes = (sizeof(scalar_t) * cap + PARAMS_ALIGN - 1) & ~(size_t)(PARAMS_ALIGN - 1);
+    scalar_t *p = (scalar_t *)aligned_alloc(PARAMS_ALIGN, bytes);
+    if (p)
+        memset(p, 0, bytes);
+    return p;
+}
+
+ParamStore *param_store_create(size_t capacity) {
+    ParamStore *s = (ParamStore *)calloc(1, sizeof(ParamStore));
+    if (!s)
+        return NULL;
+    s->capacity = capacity ? capacity : 64;
+
+    s->data = alloc_array(s->capacity);
+    s->grad = alloc_array(s->capacity);
+    s->m = alloc_array(s->capacity);
+    s->v = alloc_array(s->capacity);
+    if (!s->data || !s->grad || !s->m || !s->v) {
+        param_store_destroy(s);
+        return NULL;
+    }
+    return s;
+}
+
+void param_store_destroy(ParamStore *s) {
+    if (!s)
+        return;
+    free(s->data);
+    free(s->grad);
+    free(s->m);
+    free(s->v);
+    free(s);
+}
+
+/* realloc would not keep the alignment */
+static int grow_array(scalar_t **arr, size_t old_cap, size_t new_cap) {
+    scalar_t *p = alloc_array(new_cap);
+    if (!p)
+        return -1;
+    memcpy(p, *arr, sizeof(scalar_t) * old_cap);
+    free(*arr);
+    *arr = p;
+    return 0;
+}
+
+static int reserve(ParamStore *s, size_t needed) {
+    if (needed <= s->capacity)
+        return 0;
+
+    size_t new_cap = s->capacity * 2;
+    if (new_cap < needed)
+        new_cap = needed;
+
+    /* Arrays that did grow keep their new size; capacity tracks the smallest */
+    if (grow_array(&s->data, s->capacity, new_cap) != 0 ||
+        grow_array(&s->grad, s->capacity, new_cap) != 0 ||
+        grow_array(&s->m, s->capacity, new_cap) != 0 ||
+        grow_array(&s->v, s->capacity, new_cap) != 0)
+        return -1;
+    s->capacity = new_cap;
+    return 0;
+}
+
+size_t param_store_add(ParamStore *s, scalar_t init) {
+    return param_store_add_array(s, &init, 1);
+}
+
+size_t param_store_add_array(ParamStore *s, const scalar_t *init, size_t n) {
+    if (!s || (n && !init) || reserve(s, s->num_params + n) != 0)
+        return SIZE_MAX;
+
+    size_t first = s->num_params;
+    memcpy(s->data + first, init, sizeof(scalar_t) * n);
+    s->num_params += n;
+    return first;
+}
+
+size_t param_store_size(const ParamStore *s) {
+    return s ? s->num_params : 0;
+}
+
+void param_store_zero_grad(ParamStore *s) {
+    if (s)
+        memset(s->grad, 0, sizeof(scalar_t) * s->num_params);
+}
+
+/* ================================================================
+ *  Binding parameters onto a tape
+ * ================================================================ */
+
+/* ctx of a bound leaf */
+typedef struct ParamRef {
+    ParamStore *store;
+    size_t index;
+} ParamRef;
+
+/* Leaves are visited after all their consumers, so v->grad is complete here */
+static void backward_param(ValueData *v) {
+    const ParamRef *ref = (const ParamRef *)v->ctx;
+    ref->store->grad[ref->index] += v->grad;
+}
+
+ValueData *param_bind_with_tape(Tape *t, ParamStore *s, size_t index) {
+    if (!t || !s || index >= s->num_params)
+        return NULL;
+
+    ParamRef *ref = (ParamRef *)tape_allocate(t, sizeof(ParamRef));
+    ValueData *v = ref ? value_create_with_tape(t, s->data[index], "param", 1) : NULL;
+    if (!v)
+        return NULL;
+
+    ref->store = s;
+    ref->index = index;
+    v->ctx = ref;
+    v->backward_fn = backward_param;
+    return v;
+}
+
+ValueData *param_bind(ParamStore *s, size_t index) {
+    return param_bind_with_tape(tape_get_instance(), s, index);
+}
+
+size_t param_index(const ValueData *v, const ParamStore *s) {
+    if (!v || !s || v->backward_fn != backward_param)
+        return SIZE_MAX;
+    const ParamRef *ref = (const ParamRef *)v->ctx;
+    return ref->store == s ? ref->index : SIZE_MAX;
+}
+
+/* ================================================================
+ *  Optimizers
+ * ================================================================ */
+
+Optimizer optimizer_sgd(scalar_t lr, scalar_t momentum) {
+    Optimizer o = {OPTIM_SGD, lr, momentum, 0.9f, 0.999f, 1e-8f, 0.0f, 1};
+    return o;
+}
+
+Optimizer optimizer_adam(scalar_t lr) {
+    Optimizer o = {OPTIM_ADAM, lr, 0.0f, 0.9f, 0.999f, 1e-8f, 0.0f, 1};
+    return o;
+}
+
+Optimizer optimizer_adamw(scalar_t lr, scalar_t weight_decay) {
+    Optimizer o = {OPTIM_ADAMW, lr, 0.0f, 0.9f, 0.999f, 1e-8f, weight_decay, 1};
+    return o;
+}
+
+/* Per-step constants, hoisted out of the element loops */
+typedef struct StepCoeffs {
+    scalar_t step_size;    // lr, divided by the first-moment bias correction for Adam
+    scalar_t inv_sqrt_bc2; // 1 / sqrt(second-moment bias correction)
+    scalar_t decay;        // Multiplier applied to the data before the update (AdamW)
+} StepCoeffs;
+
+/*
+ * Element loops over [begin, end): no calls, no branches and restrict-qualified
+ * arrays, so that each one compiles to a single vectorized pass.
+ */
+static void sgd_range(ParamStore *s, const Optimizer *o, const StepCoeffs *c, size_t begin,
+                      size_t end) {
+    scalar_t *restrict p = s->data;
+    scalar_t *restrict vel = s->m;
+    const scalar_t *restrict g = s->grad;
+    const scalar_t mu = o->momentum, wd = o->weight_decay, lr = c->step_size;
+
+    for (size_t i = begin; i < end; i++) {
+        scalar_t gi = g[i] + wd * p[i];
+        vel[i] = mu * vel[i] + gi;
+        p[i] -= lr * vel[i];
+    }
+}
+
+static void adam_range(ParamStore *s, const Optimizer *o, const StepCoeffs *c, size_t begin,
+                       size_t end) {
+    scalar_t *restrict p = s->data;
+    scalar_t *restrict m = s->m;
+    scalar_t *restrict v = s->v;
+    const scalar_t *restrict g = s->grad;
+    const scalar_t b1 = o->beta1, b2 = o->beta2, eps = o->eps;
+    const scalar_t l2 = o->type == OPTIM_ADAM ? o->weight_decay : 0.0f;
+    const scalar_t step = c->step_size, inv_sqrt_bc2 = c->inv_sqrt_bc2, decay = c->decay;
+
+    for (size_t i = begin; i < end; i++) {
+        scalar_t gi = g[i] + l2 * p[i];
+        m[i] = b1 * m[i] + (1.0f - b1) * gi;
+        v[i] = b2 * v[i] + (1.0f - b2) * gi * gi;
+        p[i] = decay * p[i] - step * m[i] / (scalar_sqrt(v[i]) * inv_sqrt_bc2 + eps);
+    }
+}
+
+static void update_range(ParamStore *s, const Optimizer *o, const StepCoeffs *c, size_t begin,
+                         size_t end) {
+    if (o->type == OPTIM_SGD)
+        sgd_range(s, o, c, begin, end);
+    else
+        adam_range(s, o, c, begin, end);
+}
+
+typedef struct StepWorker {
+    pthread_t thread;
+    ParamStore *store;
+    const Optimizer *opt;
+    const StepCoeffs *coeffs;
+    size_t begin;
+    size_t end;
+} StepWorker;
+
+static void *step_worker(void *arg) {
+    StepWorker *w = (StepWorker *)arg;
+    update_range(w->store, w->opt, w->coeffs, w->begin, w->end);
+    return NULL;
+}
+
+int param_store_step(ParamStore *s, const Optimizer *opt) {
+    if (!s || !opt || opt->type > OPTIM_ADAMW)
+        return -1;
+
+    s->step++;
+    StepCoeffs c = {opt->lr, 1.0f, 1.0f};
+    if (opt->type != OPTIM_SGD) {
+        scalar_t t = (scalar_t)s->step;
+        c.step_size = opt->lr / (1.0f - scalar_pow(opt->beta1, t));
+        c.inv_sqrt_bc2 = 1.0f / scalar_sqrt(1.0f - scalar_pow(opt->beta2, t));
+        if (opt->type == OPTIM_ADAMW)
+            c.decay = 1.0f - opt->lr * opt->weight_decay;
+    }
+
+    size_t n = s->num_params;
+    size_t num_threads = opt->num_threads > 1 ? (size_t)opt->num_threads : 1;
+    if (num_threads > PARAMS_MAX_THREADS)
+        num_threads = PARAMS_MAX_THREADS;
+    if (num_threads > n / PARAMS_MIN_PER_THREAD)
+        num_threads = n / PARAMS_MIN_PER_THREAD;
+
+    if (num_threads <= 1) {
+        update_range(s, opt, &c, 0, n);
+        return 0;
+    }
+
+    /* The caller runs the first slice; threads that fail to start run inline */
+    StepWorker workers[PARAMS_MAX_THREADS];
+    int started[PARAMS_MAX_THREADS] = {0};
+    size_t chunk = (n + num_threads - 1) / num_threads;
+    chunk = (chunk + 63) & ~(size_t)63; // Slices start on cache lines: the arrays are aligned
+    for (size_t k = 0; k < num_threads; k++) {
+        size_t begin = k * chunk < n ? k * chunk : n;
+        size_t end = begin + chunk < n ? begin + chunk : n;
+        workers[k] = (StepWorker){.store = s, .opt = opt, .coeffs = &c, .begin = begin, .end = end};
+        if (k > 0)
+            started[k] = pthread_create(&workers[k].thread, NULL, step_worker, &workers[k]) == 0;
+    }
+
+    update_range(s, opt, &c, workers[0].begin, workers[0].end);
+    for (size_t k = 1; k < num_threads; k++) {
+        if (started[k])
+            pthread_join(workers[k].thread, NULL);
+        else
+            update_range(s, opt, &c, workers[k].begin, workers[k].end);
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+/*
+Persistent parameter store and optimizers.
+*/
+
+#ifndef CGRAD_PARAMS_H
+#define CGRAD_PARAMS_H
+
+#include "tape.h"
+#include "value.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Parameters living outside any tape, as structure-of-arrays: element i of
+ * every array belongs to parameter i. Clearing or destroying a tape leaves the
+ * store untouched, so a training loop records a fresh tape every step and
+ * binds the parameters onto it.
+ */
+typedef struct ParamStore {
+    scalar_t *data; // Parameter values
+    scalar_t *grad; // Gradients accumulated by backward passes over bound leaves
+    scalar_t *m;    // First moment (Adam) or velocity (SGD with momentum)
+    scalar_t *v;    // Second moment (Adam)
+    size_t num_params;
+    size_t capacity;
+    size_t step; // Optimizer steps taken, for Adam bias correction
+} ParamStore;
+
+/* Store lifecycle; capacity is a hint, the store grows as needed */
+ParamStore *param_store_create(size_t capacity);
+void param_store_destroy(ParamStore *s);
+
+/*
+ * Append parameters and return the index of the first one, or SIZE_MAX when
+ * out of memory. Growing the store may move its arrays: keep indices, not
+ * pointers into data or grad.
+ */
+size_t param_store_add(ParamStore *s, scalar_t init);
+size_t param_store_add_array(ParamStore *s, const scalar_t *init, size_t n);
+
+size_t param_store_size(const ParamStore *s);
+void param_store_zero_grad(ParamStore *s);
+
+/*
+ * Record parameter `index` as a leaf on the current tape (or on t). The leaf
+ * holds a copy of the value and a reference to the store: when the backward
+ * pass reaches it, its gradient is added to s->grad[index]. Returns NULL if
+ * the index is out of range.
+ */
+ValueData *param_bind(ParamStore *s, size_t index);
+ValueData *param_bind_with_tape(Tape *t, ParamStore *s, size_t index);
+
+/* Index of the parameter v is bound to in s, or SIZE_MAX if it is not bound to s */
+size_t param_index(const ValueData *v, const ParamStore *s);
+
+/* Update rule of param_store_step */
+typedef enum OptimizerType {
+    OPTIM_SGD,   // Momentum SGD (momentum = 0 gives plain SGD)
+    OPTIM_ADAM,  // Adam; weight_decay is added to the gradient (L2)
+    OPTIM_ADAMW, // Adam with decoupled weight decay
+} OptimizerType;
+
+typedef struct Optimizer {
+    OptimizerType type;
+    scalar_t lr;
+    scalar_t momentum; // SGD only
+    scalar_t beta1;
+    scalar_t beta2;
+    scalar_t eps;
+    scalar_t weight_decay;
+    int num_threads; // Worker threads for large stores; <= 1 runs on the caller
+} Optimizer;
+
+/* Defaults: beta1 = 0.9, beta2 = 0.999, eps = 1e-8, single-threaded */
+Optimizer optimizer_sgd(scalar_t lr, scalar_t momentum);
+Optimizer optimizer_adam(scalar_t lr);
+Optimizer optimizer_adamw(scalar_t lr, scalar_t weight_decay);
+
+/*
+ * Apply one update to every parameter from its accumulated gradient. The
+ * update is a single pass over the contiguous arrays, split across
+ * num_threads threads when the store is large enough to amortize them.
+ * Gradients are left as they are; call param_store_zero_grad before the next
+ * backward pass. Returns 0 on success, -1 on error.
+ */
+int param_store_step(ParamStore *s, const Optimizer *opt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CGRAD_PARAMS_H
@@ -0,0 +1,238 @@
+/* passes.c - Graph optimization passes */
+
+#include "passes.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Per-node flags used while rewriting */
+#define NODE_OUTPUT 0x1
+#define NODE_CONST  0x2
+#define NODE_LIVE   0x4
+#define NODE_PINNED 0x8 // Read by a checkpoint's steps: must keep its identity
+
+/* Open-addressing table of op nodes keyed by (opcode, children) */
+typedef struct ExprTable {
+    ValueData **slots;
+    size_t mask;
+} ExprTable;
+
+static int expr_table_init(ExprTable *tab, size_t num_nodes) {
+    size_t capacity = 16;
+    while (capacity < 2 * num_nodes)
+        capacity <<= 1;
+    tab->slots = (ValueData **)calloc(capacity, sizeof(ValueData *));
+    tab->mask = capacity - 1;
+    return tab->slots != NULL;
+}
+
+/* Commutative ops are keyed with their operands in address order */
+static void expr_key(const ValueData *v, const ValueData **a, const ValueData **b) {
+    *a = v->children[0];
+    *b = v->children[1];
+    if ((v->opcode == OP_ADD || v->opcode == OP_MUL) && (uintptr_t)*b < (uintptr_t)*a) {
+        const ValueData *tmp = *a;
+        *a = *b;
+        *b = tmp;
+    }
+}
+
+static size_t expr_hash(const ValueData *v) {
+    const ValueData *a, *b;
+    expr_key(v, &a, &b);
+    uint64_t h = (uint64_t)v->opcode * 0x9E3779B97F4A7C15ull;
+    h ^= (uint64_t)(uintptr_t)a + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+    h ^= (uint64_t)(uintptr_t)b + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+    return (size_t)h;
+}
+
+static int expr_equal(const ValueData *x, const ValueData *y) {
+    const ValueData *xa, *xb, *ya, *yb;
+    if (x->opcode != y->opcode)
+        return 0;
+    expr_key(x, &xa, &xb);
+    expr_key(y, &ya, &yb);
+    return xa == ya && xb == yb;
+}
+
+/* Return the existing equivalent node, or insert v and return NULL */
+static ValueData *expr_table_find_or_insert(ExprTable *tab, ValueData *v) {
+    size_t i = expr_hash(v) & tab->mask;
+    while (tab->slots[i]) {
+        if (expr_equal(tab->slots[i], v))
+            return tab->slots[i];
+        i = (i + 1) & tab->mask;
+    }
+    tab->slots[i] = v;
+    return NULL;
+}
+
+/* Identity operand of an op node, or NULL if it is not an identity */
+static ValueData *simplify_identity(ValueData *v, const uint8_t *flags, const Tape *t) {
+    ValueData *a = v->children[0];
+    ValueData *b = v->children[1];
+    int a_const = tape_contains(t, a) && (flags[a->id] & NODE_CONST);
+    int b_const = tape_contains(t, b) && (flags[b->id] & NODE_CONST);
+
+    switch (v->opcode) {
+    case OP_ADD:
+        if (b_const && b->data == 0.0f)
+            return a;
+        if (a_const && a->data == 0.0f)
+            return b;
+        break;
+    case OP_SUB:
+        if (b_const && b->data == 0.0f)
+            return a;
+        break;
+    case OP_MUL:
+        if (b_const && b->data == 1.0f)
+            return a;
+        if (a_const && a->data == 1.0f)
+            return b;
+        break;
+    case OP_DIV:
+        if (b_const && b->data == 1.0f)
+            return a;
+        break;
+    default:
+        break;
+    }
+    return NULL;
+}
+
+static int children_const(const ValueData *v, const uint8_t *flags, const Tape *t) {
+    size_t count;
+    ValueData **in = value_inputs(v, &count);
+    for (size_t j = 0; j < count; j++) {
+        const ValueData *ch = in[j];
+        if (!tape_contains(t, ch) || !(flags[ch->id] & NODE_CONST))
+            return 0;
+    }
+    return 1;
+}
+
+static void fold_to_constant(ValueData *v) {
+    v->opcode = OP_NONE;
+    v->op[0] = '\0';
+    v->backward_fn = NULL;
+    v->children[0] = NULL;
+    v->children[1] = NULL;
+    v->num_children = 0;
+    v->ctx = NULL;
+}
+
+size_t tape_optimize(Tape *t, ValueData **outputs, size_t num_outputs, unsigned passes) {
+    if (!t || t->num_nodes == 0)
+        return 0;
+
+    size_t n = t->num_nodes;
+    ValueData **repl = (ValueData **)calloc(n, sizeof(ValueData *));
+    uint8_t *flags = (uint8_t *)calloc(n, sizeof(uint8_t));
+    ExprTable tab = {NULL, 0};
+    if (!repl || !flags || ((passes & PASS_CSE) && !expr_table_init(&tab, n))) {
+        free(repl);
+        free(flags);
+        free(tab.slots);
+        return 0;
+    }
+
+    for (size_t k = 0; k < num_outputs; k++) {
+        if (tape_contains(t, outputs[k]))
+            flags[outputs[k]->id] |= NODE_OUTPUT;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (t->nodes[i]->opcode != OP_CHECKPOINT)
+            continue;
+        size_t count;
+        ValueData **in = value_inputs(t->nodes[i], &count);
+        for (size_t j = 0; j < count; j++) {
+            if (tape_contains(t, in[j]))
+                flags[in[j]->id] |= NODE_PINNED;
+        }
+    }
+
+    /* Single topological sweep: redirect children, then fold/simplify/merge */
+    for (size_t i = 0; i < n; i++) {
+        ValueData *v = t->nodes[i];
+        size_t count;
+        ValueData **in = value_inputs(v, &count);
+
+        for (size_t j = 0; j < count; j++) {
+            if (tape_contains(t, in[j]) && repl[in[j]->id])
+                in[j] = repl[in[j]->id];
+        }
+
+        if (v->opcode == OP_NONE) {
+            if (value_is_constant(v))
+                flags[i] |= NODE_CONST;
+            continue;
+        }
+
+        if ((passes & PASS_FOLD) && !v->requires_grad && children_const(v, flags, t)) {
+            value_forward(v);
+            fold_to_constant(v);
+            flags[i] |= NODE_CONST;
+            continue;
+        }
+
+        /* Fused kernels, checkpoints and subgraphs are opaque to the expression-level passes */
+        if (!value_op_is_binary(v->opcode))
+            continue;
+
+        if (flags[i] & (NODE_OUTPUT | NODE_PINNED)) {
+            if (passes & PASS_CSE)
+                expr_table_find_or_insert(&tab, v);
+            continue;
+        }
+
+        if (passes & PASS_SIMPLIFY) {
+            ValueData *x = simplify_identity(v, flags, t);
+            if (x) {
+                repl[i] = x;
+                continue;
+            }
+        }
+
+        if (passes & PASS_CSE) {
+            ValueData *w = expr_table_find_or_insert(&tab, v);
+            if (w)
+                repl[i] = w;
+        }
+    }
+
+    /* Liveness from the outputs, walking the tape backwards */
+    int dce = (passes & PASS_DCE) && num_outputs > 0;
+    if (dce) {
+        for (size_t i = n; i > 0; i--) {
+            ValueData *v = t->nodes[i - 1];
+            if (flags[i - 1] & NODE_OUTPUT)
+                flags[i - 1] |= NODE_LIVE;
+            if (!(flags[i - 1] & NODE_LIVE))
+                continue;
+            size_t count;
+            ValueData **in = value_inputs(v, &count);
+            for (size_t j = 0; j < count; j++) {
+                if (tape_contains(t, in[j]))
+                    flags[in[j]->id] |= NODE_LIVE;
+            }
+        }
+    }
+
+    /* Compact the node index and renumber */
+    size_t kept = 0;
+    for (size_t i = 0; i < n; i++) {
+        ValueData *v = t->nodes[i];
+        if (repl[i] || (dce && !(flags[i] & NODE_LIVE)))
+            continue;
+        v->id = kept;
+        t->nodes[kept++] = v;
+    }
+    t->num_nodes = kept;
+    tape_hash_invalidate(t);
+
+    free(repl);
+    free(flags);
+    free(tab.slots);
+    return n - kept;
+}
@@ -0,0 +1,40 @@
+/*
+Graph optimization passes over a recorded tape.
+*/
+
+#ifndef CGRAD_PASSES_H
+#define CGRAD_PASSES_H
+
+#include "tape.h"
+#include "value.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Pass selection flags */
+#define PASS_CSE      (1u << 0) // Merge duplicate subexpressions
+#define PASS_DCE      (1u << 1) // Drop nodes that do not reach the outputs
+#define PASS_FOLD     (1u << 2) // Turn ops over constants into constant leaves
+#define PASS_SIMPLIFY (1u << 3) // x*1, 1*x, x/1, x+0, 0+x, x-0 -> x
+#define PASS_ALL      (PASS_CSE | PASS_DCE | PASS_FOLD | PASS_SIMPLIFY)
+
+/*
+ * Rewrite the node index of a recorded tape in place and return the number of
+ * nodes removed. Gradients of the kept nodes are unchanged.
+ *
+ * Outputs, and the inputs of checkpoints (which their steps read through
+ * their context), are never merged or simplified away; DCE is skipped when no
+ * outputs are given. Only constants as defined by value_is_constant() are folded, so
+ * named leaves can still be re-fed and replayed with tape_forward().
+ *
+ * Removed nodes stay in the arena until tape_clear(), but are no longer
+ * visited by tape_forward(), tape_backward() or tape_zero_grad().
+ */
+size_t tape_optimize(Tape *t, ValueData **outputs, size_t num_outputs, unsigned passes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CGRAD_PASSES_H
@@ -0,0 +1,222 @@
+/* pipeline.c - Double-buffered tapes with a forward thread */
+
+#include "pipeline.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct Pipeline {
+    ParamStore *store;
+    ParamStore view; // What forward passes bind: the store, or a snapshot of its data
+    scalar_t *snapshot;
+    size_t snapshot_capacity;
+    Optimizer opt;
+    PipelineForwardFn forward;
+    void *user;
+    PipelineConfig config;
+
+    Tape *tapes[2];
+    ValueData *loss[2];
+
+    /* Forward thread (staleness 1): one job at a time */
+    int running;
+    int stop;
+    int pending;  // A job was posted and has not completed
+    size_t batch; // Batch of the pending job
+    int slot;     // Tape of the pending job
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+/* Record one batch on tapes[slot], reusing the blocks of its previous batch */
+static void record_batch(Pipeline *p, int slot, size_t batch) {
+    tape_clear(p->tapes[slot]);
+    Tape *prev = tape_set_instance(p->tapes[slot]);
+    p->loss[slot] = p->forward(&p->view, batch, p->user);
+    tape_set_instance(prev);
+}
+
+static void *forward_main(void *arg) {
+    Pipeline *p = (Pipeline *)arg;
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        while (!p->pending && !p->stop)
+            pthread_cond_wait(&p->cond, &p->lock);
+        if (p->stop)
+            break;
+        pthread_mutex_unlock(&p->lock);
+
+        record_batch(p, p->slot, p->batch);
+
+        pthread_mutex_lock(&p->lock);
+        p->pending = 0;
+        pthread_cond_broadcast(&p->cond);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+static void post_forward(Pipeline *p, int slot, size_t batch) {
+    pthread_mutex_lock(&p->lock);
+    p->slot = slot;
+    p->batch = batch;
+    p->pending = 1;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+}
+
+static void wait_forward(Pipeline *p) {
+    pthread_mutex_lock(&p->lock);
+    while (p->pending)
+        pthread_cond_wait(&p->cond, &p->lock);
+    pthread_mutex_unlock(&p->lock);
+}
+
+Pipeline *pipeline_create(ParamStore *s, const Optimizer *opt, PipelineForwardFn forward,
+                          void *user, PipelineConfig config) {
+    if (!s || !opt || !forward || config.staleness < 0 || config.staleness > 1)
+        return NULL;
+
+    Pipeline *p = (Pipeline *)calloc(1, sizeof(Pipeline));
+    if (!p)
+        return NULL;
+    p->store = s;
+    p->opt = *opt;
+    p->forward = forward;
+    p->user = user;
+    p->config = config;
+    if (p->config.accumulate == 0)
+        p->config.accumulate = 1;
+
+    p->tapes[0] = tape_create();
+    p->tapes[1] = tape_create();
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->cond, NULL);
+    if (!p->tapes[0] || !p->tapes[1]) {
+        pipeline_destroy(p);
+        return NULL;
+    }
+    tape_set_retain(p->tapes[0], 1);
+    tape_set_retain(p->tapes[1], 1);
+
+    if (config.staleness == 1) {
+        p->running = pthread_create(&p->thread, NULL, forward_main, p) == 0;
+        if (!p->running) {
+            pipeline_destroy(p);
+            return NULL;
+        }
+    }
+    return p;
+}
+
+void pipeline_destroy(Pipeline *p) {
+    if (!p)
+        return;
+    if (p->running) {
+        pthread_mutex_lock(&p->lock);
+        p->stop = 1;
+        pthread_cond_broadcast(&p->cond);
+        pthread_mutex_unlock(&p->lock);
+        pthread_join(p->thread, NULL);
+    }
+    pthread_mutex_destroy(&p->lock);
+    pthread_cond_destroy(&p->cond);
+    tape_destroy(p->tapes[0]);
+    tape_destroy(p->tapes[1]);
+    free(p->snapshot);
+    free(p);
+}
+
+/*
+ * Point the view at the store. With staleness 1 the forward thread reads a
+ * snapshot of the values instead, since the optimizer rewrites them while the
+ * next batch records; gradients always go straight to the store.
+ */
+static int view_sync(Pipeline *p) {
+    ParamStore *s = p->store;
+    p->view = *s;
+    if (p->config.staleness == 0)
+        return 0;
+
+    if (p->snapshot_capacity < s->num_params) {
+        free(p->snapshot);
+        p->snapshot = (scalar_t *)malloc(sizeof(scalar_t) * s->num_params);
+        p->snapshot_capacity = p->snapshot ? s->num_params : 0;
+        if (!p->snapshot)
+            return -1;
+    }
+    if (s->num_params)
+        memcpy(p->snapshot, s->data, sizeof(scalar_t) * s->num_params);
+    p->view.data = p->snapshot;
+    return 0;
+}
+
+/* Backward pass of tapes[slot], then the optimizer at accumulation boundaries */
+static int finish_batch(Pipeline *p, int slot, size_t batch, size_t num_batches,
+                        scalar_t *losses) {
+    ValueData *loss = p->loss[slot];
+    if (losses)
+        losses[batch] = loss->data;
+    loss->grad = 1.0;
+    tape_backward(p->tapes[slot]);
+
+    if ((batch + 1) % p->config.accumulate == 0 || batch + 1 == num_batches) {
+        if (param_store_step(p->store, &p->opt) != 0)
+            return -1;
+        param_store_zero_grad(p->store);
+    }
+    return 0;
+}
+
+int pipeline_run(Pipeline *p, size_t num_batches, scalar_t *losses) {
+    if (!p)
+        return -1;
+    if (num_batches == 0)
+        return 0;
+
+    if (p->config.staleness == 0) {
+        for (size_t i = 0; i < num_batches; i++) {
+            view_sync(p);
+            record_batch(p, 0, i);
+            if (!p->loss[0])
+                return -1;
+            if (finish_batch(p, 0, i, num_batches, losses) != 0)
+                return -1;
+        }
+        tape_clear(p->tapes[0]);
+        return 0;
+    }
+
+    /* Staleness 1: batch 0 records up front, then each step overlaps two batches */
+    if (view_sync(p) != 0)
+        return -1;
+    record_batch(p, 0, 0);
+    int status = 0;
+    for (size_t i = 0; i < num_batches; i++) {
+        int slot = (int)(i & 1);
+        int next = slot ^ 1;
+        if (!p->loss[slot]) {
+            status = -1;
+            break;
+        }
+
+        /* The snapshot still holds the parameters from before update i */
+        int overlap = i + 1 < num_batches;
+        if (overlap)
+            post_forward(p, next, i + 1);
+        if (finish_batch(p, slot, i, num_batches, losses) != 0)
+            status = -1;
+        if (overlap) {
+            wait_forward(p);
+            if (view_sync(p) != 0)
+                status = -1;
+        }
+        if (status != 0)
+            break;
+    }
+    tape_clear(p->tapes[0]);
+    tape_clear(p->tapes[1]);
+    return status;
+}
@@ -0,0 +1,56 @@
+/*
+Pipelined training: the forward pass of the next batch overlaps the backward
+pass and update of the current one.
+*/
+
+#ifndef CGRAD_PIPELINE_H
+#define CGRAD_PIPELINE_H
+
+#include "params.h"
+#include "tape.h"
+#include "value.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Record the forward pass of batch `batch` on the current tape and return the
+ * loss. Parameters must be bound from `s` (param_bind(s, i)), which is the
+ * pipeline's view of the store; do not add parameters from here.
+ */
+typedef ValueData *(*PipelineForwardFn)(ParamStore *s, size_t batch, void *user);
+
+/*
+ * Staleness policy:
+ *   0 - sequential steps: batch i is recorded, differentiated and applied
+ *       before batch i + 1 is recorded.
+ *   1 - batch i + 1 is recorded on a second thread and a second tape while
+ *       batch i runs backward and the optimizer. It sees the parameters from
+ *       before update i, so every gradient is exactly one update old, and it
+ *       is applied after update i.
+ */
+typedef struct PipelineConfig {
+    int staleness;
+    size_t accumulate; // Batches whose gradients are summed per optimizer step (0 means 1)
+} PipelineConfig;
+
+typedef struct Pipeline Pipeline;
+
+Pipeline *pipeline_create(ParamStore *s, const Optimizer *opt, PipelineForwardFn forward,
+                          void *user, PipelineConfig config);
+void pipeline_destroy(Pipeline *p);
+
+/*
+ * Train on batches 0 .. num_batches - 1, stepping the optimizer every
+ * `accumulate` batches and after the last one. losses[i] receives the loss of
+ * batch i when losses is not NULL. The caller's current tape is left alone.
+ * Returns 0 on success, -1 if a forward pass returned NULL or an update failed.
+ */
+int pipeline_run(Pipeline *p, size_t num_batches, scalar_t *losses);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CGRAD_PIPELINE_H
@@ -0,0 +1,157 @@
+/* plancache.c - Compiled plans keyed by graph structure */
+
+#include "plancache.h"
+
+#include <stdlib.h>
+
+#define PLAN_CACHE_DEFAULT_CAPACITY 16
+
+/* One remembered shape; compiled is NULL until it has been seen often enough */
+typedef struct PlanEntry {
+    uint64_t hash[2];
+    size_t num_nodes;
+    size_t seen;
+    uint64_t last_use;
+    int failed;
+    CompiledTape *compiled;
+} PlanEntry;
+
+/* A handful of shapes is expected: entries are scanned linearly */
+struct PlanCache {
+    PlanCacheConfig config;
+    PlanEntry *entries;
+    size_t num_entries;
+    uint64_t clock;
+    PlanCacheStats stats;
+};
+
+PlanCache *plan_cache_create(PlanCacheConfig config) {
+    if (config.capacity == 0)
+        config.capacity = PLAN_CACHE_DEFAULT_CAPACITY;
+    if (config.compile_after == 0)
+        config.compile_after = 1;
+
+    PlanCache *c = (PlanCache *)calloc(1, sizeof(PlanCache));
+    if (!c)
+        return NULL;
+    c->entries = (PlanEntry *)calloc(config.capacity, sizeof(PlanEntry));
+    if (!c->entries) {
+        free(c);
+        return NULL;
+    }
+    c->config = config;
+    return c;
+}
+
+void plan_cache_destroy(PlanCache *c) {
+    if (!c)
+        return;
+    for (size_t i = 0; i < c->num_entries; i++)
+        compiled_tape_destroy(c->entries[i].compiled);
+    free(c->entries);
+    free(c);
+}
+
+static PlanEntry *find(PlanCache *c, const uint64_t hash[2], size_t num_nodes) {
+    for (size_t i = 0; i < c->num_entries; i++) {
+        PlanEntry *e = &c->entries[i];
+        if (e->hash[0] == hash[0] && e->hash[1] == hash[1] && e->num_nodes == num_nodes)
+            return e;
+    }
+    return NULL;
+}
+
+/* New entry, evicting the least recently used one when full */
+static PlanEntry *insert(PlanCache *c, const uint64_t hash[2], size_t num_nodes) {
+    PlanEntry *e;
+    if (c->num_entries < c->config.capacity) {
+        e = &c->entries[c->num_entries++];
+    } else {
+        e = &c->entries[0];
+        for (size_t i = 1; i < c->num_entries; i++) {
+            if (c->entries[i].last_use < e->last_use)
+                e = &c->entries[i];
+        }
+        compiled_tape_destroy(e->compiled);
+        c->stats.evictions++;
+    }
+
+    e->hash[0] = hash[0];
+    e->hash[1] = hash[1];
+    e->num_nodes = num_nodes;
+    e->seen = 0;
+    e->failed = 0;
+    e->compiled = NULL;
+    return e;
+}
+
+CompiledTape *plan_cache_lookup(PlanCache *c, Tape *t) {
+    if (!c || !t)
+        return NULL;
+    uint64_t hash[2];
+    tape_structure_hash(t, hash);
+    PlanEntry *e = find(c, hash, t->num_nodes);
+    return e ? e->compiled : NULL;
+}
+
+/*
+ * Compiled forward and backward, with the gradients of the leaves handed back
+ * to the tape; intermediate nodes keep theirs
+ */
+static void run_plan(CompiledTape *ct, Tape *t, ValueData *output) {
+    compiled_tape_forward(ct, t);
+    compiled_tape_backward(ct, output);
+
+    /* Reverse order, so that leaf hooks run in the order tape_backward runs them */
+    for (size_t i = ct->num_leaves; i > 0; i--) {
+        size_t id = ct->leaf_ids[i - 1];
+        ValueData *v = t->nodes[id];
+        v->grad += ct->grads[id];
+        if (v->backward_fn)
+            v->backward_fn(v);
+    }
+}
+
+int plan_cache_backward(PlanCache *c, Tape *t, ValueData *output) {
+    if (!c || !t || !tape_contains(t, output))
+        return -1;
+
+    uint64_t hash[2];
+    tape_structure_hash(t, hash);
+    PlanEntry *e = find(c, hash, t->num_nodes);
+    if (!e)
+        e = insert(c, hash, t->num_nodes);
+    e->last_use = ++c->clock;
+    e->seen++;
+
+    int hit = e->compiled != NULL;
+    if (!e->compiled && !e->failed && e->seen >= c->config.compile_after) {
+        e->compiled = tape_compile(t);
+        e->failed = e->compiled == NULL;
+        if (e->failed)
+            c->stats.failures++;
+        else
+            c->stats.compiles++;
+    }
+    if (hit)
+        c->stats.hits++;
+    else
+        c->stats.misses++;
+
+    if (e->compiled) {
+        run_plan(e->compiled, t, output);
+        return 1;
+    }
+    output->grad = 1.0;
+    tape_backward(t);
+    return 0;
+}
+
+PlanCacheStats plan_cache_stats(const PlanCache *c) {
+    PlanCacheStats none = {0, 0, 0, 0, 0};
+    return c ? c->stats : none;
+}
+
+size_t plan_cache_size(const PlanCache *c) {
+    return c ? c->num_entries : 0;
+}
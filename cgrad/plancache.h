@@ -0,0 +1,62 @@
+/*
+Plan cache: compiled tapes reused across re-recorded graphs of the same shape.
+*/
+
+#ifndef CGRAD_PLANCACHE_H
+#define CGRAD_PLANCACHE_H
+
+#include "codegen.h"
+#include "tape.h"
+#include "value.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct PlanCacheConfig {
+    size_t capacity;      // Shapes remembered; the least recently used is evicted (0 means 16)
+    size_t compile_after; // Times a shape is seen before it is compiled (0 means 1)
+} PlanCacheConfig;
+
+typedef struct PlanCacheStats {
+    size_t hits;      // Backward passes run by a plan compiled earlier
+    size_t misses;    // Backward passes run otherwise
+    size_t compiles;  // Plans compiled
+    size_t failures;  // Shapes that could not be compiled (not retried)
+    size_t evictions; // Shapes dropped to make room
+} PlanCacheStats;
+
+/*
+ * Shapes are keyed by tape_structure_hash and the node count. A shape seen
+ * compile_after times is compiled with tape_compile; shapes that cannot be
+ * compiled (checkpoints, subgraphs) are remembered as such and always
+ * interpreted. Not thread-safe: use one cache per thread.
+ */
+typedef struct PlanCache PlanCache;
+
+PlanCache *plan_cache_create(PlanCacheConfig config);
+void plan_cache_destroy(PlanCache *c);
+
+/* Compiled plan for the structure of t, or NULL; does not count as a use */
+CompiledTape *plan_cache_lookup(PlanCache *c, Tape *t);
+
+/*
+ * Backward pass of a freshly recorded tape, like value_backward(output) but
+ * on tape t. With a compiled plan, it runs forward and backward from the leaf
+ * values of t, the gradients are added to the non-constant leaves and their
+ * backward hooks (bound parameters) run as usual; gradients of intermediate
+ * nodes are left in the plan. Otherwise the tape is interpreted. Returns 1 if
+ * a compiled plan ran, 0 if the tape was interpreted, -1 on error.
+ */
+int plan_cache_backward(PlanCache *c, Tape *t, ValueData *output);
+
+PlanCacheStats plan_cache_stats(const PlanCache *c);
+size_t plan_cache_size(const PlanCache *c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CGRAD_PLANCACHE_H
@@ -0,0 +1,34 @@
+/* precision.c - 16-bit storage formats */
+
+#include "precision.h"
+
+#include "tape.h"
+
+void half_pack(half_t *dst, const scalar_t *src, size_t n, HalfFormat fmt) {
+    if (fmt == HALF_BF16) {
+        for (size_t i = 0; i < n; i++)
+            dst[i] = bf16_from_float((float)src[i]);
+    } else {
+        for (size_t i = 0; i < n; i++)
+            dst[i] = fp16_from_float((float)src[i]);
+    }
+}
+
+void half_unpack(scalar_t *dst, const half_t *src, size_t n, HalfFormat fmt) {
+    if (fmt == HALF_BF16) {
+        for (size_t i = 0; i < n; i++)
+            dst[i] = (scalar_t)bf16_to_float(src[i]);
+    } else {
+        for (size_t i = 0; i < n; i++)
+            dst[i] = (scalar_t)fp16_to_float(src[i]);
+    }
+}
+
+void tape_round_to_half(Tape *t, HalfFormat fmt) {
+    if (!t)
+        return;
+    for (size_t i = 0; i < t->num_nodes; i++) {
+        ValueData *v = t->nodes[i];
+        v->data = half_to_scalar(half_from_scalar(v->data, fmt), fmt);
+    }
+}
@@ -0,0 +1,105 @@
+/*
+16-bit storage formats: bfloat16 and IEEE float16 conversions.
+*/
+
+#ifndef CGRAD_PRECISION_H
+#define CGRAD_PRECISION_H
+
+#include "value.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Raw 16-bit storage word, interpreted according to a HalfFormat */
+typedef uint16_t half_t;
+
+typedef enum HalfFormat {
+    HALF_BF16, // 8-bit exponent, 7-bit mantissa: float32 range, ~3 significant digits
+    HALF_FP16, // IEEE binary16: 5-bit exponent, 10-bit mantissa, max 65504
+} HalfFormat;
+
+/*
+ * Half values are only a storage format: they are widened to scalar_t before
+ * any arithmetic, and gradients always accumulate in scalar_t. Conversions
+ * round to nearest even, like the hardware instructions they stand in for.
+ */
+static inline half_t bf16_from_float(float f) {
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    if ((x & 0x7FFFFFFFu) > 0x7F800000u) // NaN: keep it quiet, don't round to inf
+        return (half_t)((x >> 16) | 0x40u);
+    x += 0x7FFFu + ((x >> 16) & 1u);
+    return (half_t)(x >> 16);
+}
+
+static inline float bf16_to_float(half_t h) {
+    uint32_t x = (uint32_t)h << 16;
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+static inline half_t fp16_from_float(float f) {
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    half_t sign = (half_t)((x >> 16) & 0x8000u);
+    uint32_t abs_x = x & 0x7FFFFFFFu;
+
+    if (abs_x >= 0x7F800000u) // Inf or NaN
+        return sign | 0x7C00u | (abs_x > 0x7F800000u ? 0x200u : 0u);
+    if (abs_x >= 0x477FF000u) // Rounds past 65504
+        return sign | 0x7C00u;
+    if (abs_x < 0x38800000u) { // Below 2^-14: subnormal in binary16
+        float a;
+        memcpy(&a, &abs_x, sizeof(a));
+        return sign | (half_t)lrintf(a * 16777216.0f);
+    }
+    /* Rebias the exponent from 127 to 15 and round the dropped 13 bits */
+    abs_x += 0xC8000FFFu + ((abs_x >> 13) & 1u);
+    return sign | (half_t)(abs_x >> 13);
+}
+
+static inline float fp16_to_float(half_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000u) << 16;
+    uint32_t exp = (h >> 10) & 0x1Fu;
+    uint32_t mant = h & 0x3FFu;
+    uint32_t x;
+    float f;
+
+    if (exp == 0) {
+        f = (float)mant * (1.0f / 16777216.0f);
+        return sign ? -f : f;
+    }
+    if (exp == 0x1F)
+        x = sign | 0x7F800000u | (mant << 13);
+    else
+        x = sign | ((exp + 112u) << 23) | (mant << 13);
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+static inline half_t half_from_scalar(scalar_t x, HalfFormat fmt) {
+    return fmt == HALF_BF16 ? bf16_from_float((float)x) : fp16_from_float((float)x);
+}
+
+static inline scalar_t half_to_scalar(half_t h, HalfFormat fmt) {
+    return (scalar_t)(fmt == HALF_BF16 ? bf16_to_float(h) : fp16_to_float(h));
+}
+
+/* Bulk conversions */
+void half_pack(half_t *dst, const scalar_t *src, size_t n, HalfFormat fmt);
+void half_unpack(scalar_t *dst, const half_t *src, size_t n, HalfFormat fmt);
+
+/* Round the data of every node on the tape to the given format, in place */
+void tape_round_to_half(struct Tape *t, HalfFormat fmt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CGRAD_PRECISION_H
@@ -0,0 +1,209 @@
+/* profile.c - Profiling statistics, reports and hardware counters */
+
+#include "profile.h"
+
+#include <string.h>
+#include <time.h>
+
+#if defined(CGRAD_PROFILE) && defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+ProfileStats g_profile;
+
+/* Names used in reports and folded stacks, indexed by ValueOp */
+static const char *const op_names[OP_COUNT] = {
+    [OP_NONE] = "leaf", [OP_ADD] = "add",     [OP_SUB] = "sub",         [OP_MUL] = "mul",
+    [OP_DIV] = "div",   [OP_FUSED] = "fused", [OP_CHECKPOINT] = "ckpt",
+    [OP_SUBGRAPH] = "subgraph",
+};
+
+static const char *const phase_names[PROFILE_PHASES] = {"record", "forward", "backward"};
+
+static const char *const hw_names[PROFILE_HW_COUNT] = {"cycles", "instructions",
+                                                       "cache-misses", "branch-misses"};
+
+int profile_enabled(void) {
+#ifdef CGRAD_PROFILE
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+const ProfileStats *profile_get(void) {
+    return &g_profile;
+}
+
+void profile_reset(void) {
+    memset(&g_profile, 0, sizeof(g_profile));
+}
+
+/* ================================================================
+ *  Tick calibration
+ * ================================================================ */
+
+static double wall_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+double profile_tick_ns(void) {
+#if defined(CGRAD_PROFILE) && (defined(__x86_64__) || defined(__i386__))
+    /* Measure the TSC against the wall clock once, over about 5 ms */
+    static double tick_ns = 0.0;
+    if (tick_ns == 0.0) {
+        double t0 = wall_ns();
+        uint64_t c0 = profile_now();
+        while (wall_ns() - t0 < 5e6)
+            ;
+        double t1 = wall_ns();
+        uint64_t c1 = profile_now();
+        tick_ns = c1 > c0 ? (t1 - t0) / (double)(c1 - c0) : 1.0;
+    }
+    return tick_ns;
+#else
+    (void)wall_ns;
+    return 1.0;
+#endif
+}
+
+/* ================================================================
+ *  Hardware counters
+ * ================================================================ */
+
+#if defined(CGRAD_PROFILE) && defined(__linux__)
+
+static int g_hw_fd[PROFILE_HW_COUNT] = {-1, -1, -1, -1};
+
+static const uint64_t hw_configs[PROFILE_HW_COUNT] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES};
+
+static void hw_close(void) {
+    for (int i = 0; i < PROFILE_HW_COUNT; i++) {
+        if (g_hw_fd[i] >= 0)
+            close(g_hw_fd[i]);
+        g_hw_fd[i] = -1;
+    }
+}
+
+int profile_hw_begin(void) {
+    hw_close();
+
+    /* One group led by the cycle counter, so that all counters cover the same interval */
+    for (int i = 0; i < PROFILE_HW_COUNT; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = hw_configs[i];
+        attr.disabled = i == 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        int group = i == 0 ? -1 : g_hw_fd[0];
+        g_hw_fd[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+        if (g_hw_fd[i] < 0) {
+            hw_close();
+            return -1;
+        }
+    }
+
+    ioctl(g_hw_fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(g_hw_fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return 0;
+}
+
+int profile_hw_end(void) {
+    if (g_hw_fd[0] < 0)
+        return -1;
+
+    ioctl(g_hw_fd[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    int status = 0;
+    for (int i = 0; i < PROFILE_HW_COUNT; i++) {
+        uint64_t value;
+        if (read(g_hw_fd[i], &value, sizeof(value)) == (ssize_t)sizeof(value))
+            g_profile.hw[i] += value;
+        else
+            status = -1;
+    }
+    hw_close();
+    return status;
+}
+
+#else
+
+int profile_hw_begin(void) {
+    return -1;
+}
+
+int profile_hw_end(void) {
+    return -1;
+}
+
+#endif
+
+/* ================================================================
+ *  Reports
+ * ================================================================ */
+
+void profile_print(FILE *f) {
+    const ProfileStats *s = &g_profile;
+    double tick_ns = profile_tick_ns();
+
+    if (!profile_enabled()) {
+        fprintf(f, "Profile: library built without CGRAD_PROFILE\n");
+        return;
+    }
+
+    fprintf(f, "Profile (ticks of %.3f ns):\n", tick_ns);
+    fprintf(f, "  %-6s %-9s %12s %14s %10s\n", "op", "phase", "count", "total ms", "mean ns");
+    for (int op = 0; op < OP_COUNT; op++) {
+        for (int p = 0; p < PROFILE_PHASES; p++) {
+            uint64_t n = s->count[p][op];
+            if (n == 0)
+                continue;
+            double ns = (double)s->ticks[p][op] * tick_ns;
+            fprintf(f, "  %-6s %-9s %12llu %14.3f %10.1f\n", op_names[op], phase_names[p],
+                    (unsigned long long)n, ns * 1e-6, ns / (double)n);
+        }
+    }
+
+    fprintf(f, "  Allocations: %llu (%llu bytes, %llu blocks), %.3f ms\n",
+            (unsigned long long)s->allocs, (unsigned long long)s->alloc_bytes,
+            (unsigned long long)s->alloc_blocks, (double)s->alloc_ticks * tick_ns * 1e-6);
+
+    if (s->hw[PROFILE_HW_CYCLES]) {
+        fprintf(f, "  Hardware:");
+        for (int i = 0; i < PROFILE_HW_COUNT; i++)
+            fprintf(f, " %s %llu", hw_names[i], (unsigned long long)s->hw[i]);
+        fprintf(f, " (IPC %.2f)\n",
+                (double)s->hw[PROFILE_HW_INSTRUCTIONS] / (double)s->hw[PROFILE_HW_CYCLES]);
+    }
+}
+
+int profile_write_folded(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "Error: Could not open file %s for writing\n", path);
+        return -1;
+    }
+
+    const ProfileStats *s = &g_profile;
+    for (int p = 0; p < PROFILE_PHASES; p++) {
+        for (int op = 0; op < OP_COUNT; op++) {
+            if (s->ticks[p][op])
+                fprintf(f, "cgrad;%s;%s %llu\n", phase_names[p], op_names[op],
+                        (unsigned long long)s->ticks[p][op]);
+        }
+    }
+    /* Allocation is timed separately from the phases, so the frames don't overlap */
+    if (s->alloc_ticks)
+        fprintf(f, "cgrad;tape_allocate %llu\n", (unsigned long long)s->alloc_ticks);
+
+    return fclose(f) == 0 ? 0 : -1;
+}
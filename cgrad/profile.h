@@ -0,0 +1,137 @@
+/*
+Opt-in profiling: per-op counts and timings, allocation counts and hardware counters.
+*/
+
+#ifndef CGRAD_PROFILE_H
+#define CGRAD_PROFILE_H
+
+#include "value.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef CGRAD_PROFILE
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The instrumentation is compiled out unless the library is built with
+ * -DCGRAD_PROFILE (make lib PROFILE=1). The functions below exist in both
+ * builds; without the flag the statistics simply stay at zero.
+ */
+
+/* Where the time of a node is spent */
+typedef enum ProfilePhase {
+    PROFILE_RECORD,   // Creating the node, excluding its tape_allocate call
+    PROFILE_FORWARD,  // Recomputing it in tape_forward
+    PROFILE_BACKWARD, // Running its backward function in tape_backward
+    PROFILE_PHASES
+} ProfilePhase;
+
+/* Hardware counters read through perf_event_open (Linux only) */
+typedef enum ProfileCounter {
+    PROFILE_HW_CYCLES,
+    PROFILE_HW_INSTRUCTIONS,
+    PROFILE_HW_CACHE_MISSES,
+    PROFILE_HW_BRANCH_MISSES,
+    PROFILE_HW_COUNT
+} ProfileCounter;
+
+typedef struct ProfileStats {
+    uint64_t count[PROFILE_PHASES][OP_COUNT]; // Nodes processed per phase and opcode
+    uint64_t ticks[PROFILE_PHASES][OP_COUNT]; // Cumulative ticks per phase and opcode
+
+    uint64_t allocs;       // tape_allocate calls
+    uint64_t alloc_bytes;  // Bytes handed out, after alignment
+    uint64_t alloc_blocks; // Arena blocks obtained from malloc
+    uint64_t alloc_ticks;  // Time spent in tape_allocate
+
+    uint64_t hw[PROFILE_HW_COUNT]; // Accumulated between profile_hw_begin/end
+} ProfileStats;
+
+/* 1 when the library was built with CGRAD_PROFILE */
+int profile_enabled(void);
+
+/*
+ * Accumulated statistics; reset them between the regions you want to compare.
+ * They are process-wide and unsynchronized: profile one recording thread.
+ */
+const ProfileStats *profile_get(void);
+void profile_reset(void);
+
+/* Nanoseconds per tick: ticks are TSC cycles on x86-64, nanoseconds elsewhere */
+double profile_tick_ns(void);
+
+/*
+ * Count hardware events for the calling thread between profile_hw_begin and
+ * profile_hw_end. Returns 0 on success, -1 when the counters are unavailable
+ * (not Linux, no CGRAD_PROFILE, or perf_event_paranoid forbids it).
+ */
+int profile_hw_begin(void);
+int profile_hw_end(void);
+
+/* Per-op table of counts, total and mean time per phase, then allocations */
+void profile_print(FILE *f);
+
+/*
+ * Write the ticks as folded stacks ("cgrad;backward;mul 1234" per line), the
+ * input format of flamegraph.pl and speedscope. Returns 0 on success.
+ */
+int profile_write_folded(const char *path);
+
+/* ================================================================
+ *  Instrumentation hooks (used inside the library)
+ * ================================================================ */
+
+#ifdef CGRAD_PROFILE
+
+#if defined(__x86_64__) || defined(__i386__)
+static inline uint64_t profile_now(void) {
+    return __rdtsc();
+}
+#else
+static inline uint64_t profile_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+extern ProfileStats g_profile;
+
+#define PROFILE_BEGIN(start) uint64_t start = profile_now()
+#define PROFILE_END(phase, op, start)                                                       \
+    do {                                                                                    \
+        g_profile.count[phase][op]++;                                                       \
+        g_profile.ticks[phase][op] += profile_now() - (start);                              \
+    } while (0)
+#define PROFILE_ALLOC(bytes, start)                                                         \
+    do {                                                                                    \
+        g_profile.allocs++;                                                                 \
+        g_profile.alloc_bytes += (bytes);                                                   \
+        g_profile.alloc_ticks += profile_now() - (start);                                   \
+    } while (0)
+#define PROFILE_BLOCK() (g_profile.alloc_blocks++)
+
+#else
+
+#define PROFILE_BEGIN(start)          ((void)0)
+#define PROFILE_END(phase, op, start) ((void)0)
+#define PROFILE_ALLOC(bytes, start)   ((void)0)
+#define PROFILE_BLOCK()               ((void)0)
+
+#endif // CGRAD_PROFILE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CGRAD_PROFILE_H
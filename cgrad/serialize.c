@@ -0,0 +1,375 @@
+/* serialize.c - Binary tape and parameter serialization */
+
+#include "serialize.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+_Static_assert(sizeof(((ValueData *)0)->name) == SERIAL_NAME_LEN, "name field size mismatch");
+
+static inline uint64_t align_up(uint64_t x) {
+    return (x + SERIAL_ALIGN - 1) & ~(uint64_t)(SERIAL_ALIGN - 1);
+}
+
+static inline scalar_t apply(uint32_t op, scalar_t a, scalar_t b) {
+    switch (op) {
+    case OP_ADD:
+        return a + b;
+    case OP_SUB:
+        return a - b;
+    case OP_MUL:
+        return a * b;
+    default:
+        return a / b;
+    }
+}
+
+/* ================================================================
+ *  Writing
+ * ================================================================ */
+
+/* Encode node i; returns -1 for nodes that have no serialized form */
+static int encode_node(const Tape *t, const ParamStore *s, const ValueData *v, SerialNode *out,
+                       SerialFused *fused, uint64_t *num_fused) {
+    out->op = (uint32_t)v->opcode;
+    out->flags = v->requires_grad ? SERIAL_REQUIRES_GRAD : 0u;
+    out->data = v->data;
+
+    if (v->opcode == OP_NONE) {
+        size_t index = param_index(v, s);
+        if (index != SIZE_MAX) {
+            out->flags |= SERIAL_PARAM;
+            out->arg[0] = (uint32_t)index;
+        } else if (value_is_constant(v)) {
+            out->flags |= SERIAL_CONSTANT;
+        }
+        return 0;
+    }
+
+    if (value_op_is_binary(v->opcode)) {
+        for (size_t j = 0; j < 2; j++) {
+            if (!tape_contains(t, v->children[j]))
+                return -1;
+            out->arg[j] = (uint32_t)v->children[j]->id;
+        }
+        return 0;
+    }
+
+    if (v->opcode == OP_FUSED) {
+        const FusedKernel *k = (const FusedKernel *)v->ctx;
+        SerialFused *f = &fused[*num_fused];
+        f->num_inputs = (uint32_t)k->num_inputs;
+        f->num_steps = (uint32_t)k->num_steps;
+        for (size_t j = 0; j < k->num_inputs; j++) {
+            if (!tape_contains(t, k->inputs[j]))
+                return -1;
+            f->inputs[j] = (uint32_t)k->inputs[j]->id;
+        }
+        for (size_t j = 0; j < k->num_steps; j++) {
+            f->steps[j].op = (uint8_t)k->steps[j].op;
+            f->steps[j].lhs = k->steps[j].lhs;
+            f->steps[j].rhs = k->steps[j].rhs;
+        }
+        out->arg[0] = (uint32_t)(*num_fused)++;
+        return 0;
+    }
+
+    fprintf(stderr, "Error: cannot serialize op '%s'\n", v->op);
+    return -1;
+}
+
+/* Write size bytes at offset, zero-filling the gap from the current position */
+static int write_at(FILE *file, uint64_t *pos, uint64_t offset, const void *data, size_t size) {
+    static const uint8_t zeros[SERIAL_ALIGN] = {0};
+    if (fwrite(zeros, 1, (size_t)(offset - *pos), file) != offset - *pos)
+        return -1;
+    if (size && fwrite(data, 1, size, file) != size)
+        return -1;
+    *pos = offset + size;
+    return 0;
+}
+
+int tape_save(const Tape *t, const ParamStore *s, const char *path) {
+    if (!t || !path || t->num_nodes > UINT32_MAX)
+        return -1;
+
+    size_t n = t->num_nodes;
+    SerialNode *nodes = (SerialNode *)calloc(n + 1, sizeof(SerialNode));
+    SerialFused *fused = (SerialFused *)calloc(n + 1, sizeof(SerialFused));
+    char(*names)[SERIAL_NAME_LEN] = calloc(n + 1, SERIAL_NAME_LEN);
+    int ret = (nodes && fused && names) ? 0 : -1;
+
+    SerialHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SERIAL_MAGIC, sizeof(h.magic));
+    h.version = SERIAL_VERSION;
+    h.byte_order = SERIAL_BYTE_ORDER;
+    h.scalar_size = (uint32_t)sizeof(scalar_t);
+    h.num_nodes = n;
+    h.num_params = s ? s->num_params : 0;
+
+    for (size_t i = 0; i < n && ret == 0; i++) {
+        ret = encode_node(t, s, t->nodes[i], &nodes[i], fused, &h.num_fused);
+        memcpy(names[i], t->nodes[i]->name, SERIAL_NAME_LEN);
+    }
+
+    h.nodes_offset = align_up(sizeof(SerialHeader));
+    h.fused_offset = align_up(h.nodes_offset + n * sizeof(SerialNode));
+    h.params_offset = align_up(h.fused_offset + h.num_fused * sizeof(SerialFused));
+    h.names_offset = align_up(h.params_offset + h.num_params * sizeof(scalar_t));
+    h.file_size = h.names_offset + n * SERIAL_NAME_LEN;
+
+    FILE *file = ret == 0 ? fopen(path, "wb") : NULL;
+    if (ret == 0 && !file) {
+        fprintf(stderr, "Error: Could not open file %s for writing\n", path);
+        ret = -1;
+    }
+    if (file) {
+        uint64_t pos = 0;
+        if (write_at(file, &pos, 0, &h, sizeof(h)) != 0 ||
+            write_at(file, &pos, h.nodes_offset, nodes, n * sizeof(SerialNode)) != 0 ||
+            write_at(file, &pos, h.fused_offset, fused, h.num_fused * sizeof(SerialFused)) != 0 ||
+            write_at(file, &pos, h.params_offset, s ? s->data : NULL,
+                     h.num_params * sizeof(scalar_t)) != 0 ||
+            write_at(file, &pos, h.names_offset, names, n * SERIAL_NAME_LEN) != 0)
+            ret = -1;
+        if (fclose(file) != 0)
+            ret = -1;
+    }
+
+    free(nodes);
+    free(fused);
+    free(names);
+    return ret;
+}
+
+/* ================================================================
+ *  Mapping and validation
+ * ================================================================ */
+
+/* Does [offset, offset + count * size) fit in the file, suitably aligned? */
+static int section_ok(const SerialHeader *h, uint64_t offset, uint64_t count, size_t size) {
+    if (offset % sizeof(uint64_t) != 0 || offset > h->file_size)
+        return 0;
+    return count <= (h->file_size - offset) / size;
+}
+
+static int fused_ok(const SerialFused *f, uint64_t id) {
+    if (f->num_steps == 0 || f->num_steps > FUSED_MAX_STEPS || f->num_inputs > FUSED_MAX_INPUTS)
+        return 0;
+    for (uint32_t j = 0; j < f->num_inputs; j++) {
+        if (f->inputs[j] >= id)
+            return 0;
+    }
+    for (uint32_t j = 0; j < f->num_steps; j++) {
+        const SerialFusedStep *st = &f->steps[j];
+        uint8_t ops[2] = {st->lhs, st->rhs};
+        if (!value_op_is_binary((ValueOp)st->op))
+            return 0;
+        for (size_t o = 0; o < 2; o++) {
+            uint32_t limit = FUSED_IS_REG(ops[o]) ? j : f->num_inputs;
+            if (FUSED_INDEX(ops[o]) >= limit)
+                return 0;
+        }
+    }
+    return 1;
+}
+
+static int image_ok(const TapeImage *img) {
+    const SerialHeader *h = img->header;
+    if (img->size < sizeof(SerialHeader) || memcmp(h->magic, SERIAL_MAGIC, sizeof(h->magic)) ||
+        h->version != SERIAL_VERSION || h->byte_order != SERIAL_BYTE_ORDER ||
+        h->scalar_size != sizeof(scalar_t) || h->file_size != img->size)
+        return 0;
+    if (!section_ok(h, h->nodes_offset, h->num_nodes, sizeof(SerialNode)) ||
+        !section_ok(h, h->fused_offset, h->num_fused, sizeof(SerialFused)) ||
+        !section_ok(h, h->params_offset, h->num_params, sizeof(scalar_t)) ||
+        !section_ok(h, h->names_offset, h->num_nodes, SERIAL_NAME_LEN))
+        return 0;
+
+    const uint8_t *base = (const uint8_t *)img->base;
+    const SerialNode *nodes = (const SerialNode *)(base + h->nodes_offset);
+    const SerialFused *fused = (const SerialFused *)(base + h->fused_offset);
+    for (uint64_t i = 0; i < h->num_nodes; i++) {
+        const SerialNode *nd = &nodes[i];
+        if (nd->op == OP_NONE) {
+            if ((nd->flags & SERIAL_PARAM) && nd->arg[0] >= h->num_params)
+                return 0;
+        } else if (value_op_is_binary((ValueOp)nd->op)) {
+            if (nd->arg[0] >= i || nd->arg[1] >= i)
+                return 0;
+        } else if (nd->op == OP_FUSED) {
+            if (nd->arg[0] >= h->num_fused || !fused_ok(&fused[nd->arg[0]], i))
+                return 0;
+        } else {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+TapeImage *tape_image_open(const char *path) {
+    int fd = path ? open(path, O_RDONLY) : -1;
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    void *base = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return NULL;
+
+    TapeImage *img = (TapeImage *)calloc(1, sizeof(TapeImage));
+    if (!img) {
+        munmap(base, (size_t)st.st_size);
+        return NULL;
+    }
+    img->base = base;
+    img->size = (size_t)st.st_size;
+    img->header = (const SerialHeader *)base;
+    if (!image_ok(img)) {
+        fprintf(stderr, "Error: %s is not a valid tape image for this build\n", path);
+        tape_image_close(img);
+        return NULL;
+    }
+
+    const uint8_t *bytes = (const uint8_t *)base;
+    img->nodes = (const SerialNode *)(bytes + img->header->nodes_offset);
+    img->fused = (const SerialFused *)(bytes + img->header->fused_offset);
+    img->params = (const scalar_t *)(bytes + img->header->params_offset);
+    img->names = (const char(*)[SERIAL_NAME_LEN])(bytes + img->header->names_offset);
+    return img;
+}
+
+void tape_image_close(TapeImage *img) {
+    if (!img)
+        return;
+    if (img->base)
+        munmap(img->base, img->size);
+    free(img);
+}
+
+size_t tape_image_num_nodes(const TapeImage *img) {
+    return img ? (size_t)img->header->num_nodes : 0;
+}
+
+/* ================================================================
+ *  In-place evaluation
+ * ================================================================ */
+
+void tape_image_reset(const TapeImage *img, scalar_t *values) {
+    if (!img || !values)
+        return;
+    for (uint64_t i = 0; i < img->header->num_nodes; i++)
+        values[i] = img->nodes[i].data;
+}
+
+static scalar_t fused_eval(const SerialFused *f, const scalar_t *values) {
+    scalar_t regs[FUSED_MAX_STEPS];
+    for (uint32_t s = 0; s < f->num_steps; s++) {
+        const SerialFusedStep *st = &f->steps[s];
+        scalar_t a =
+            FUSED_IS_REG(st->lhs) ? regs[FUSED_INDEX(st->lhs)] : values[f->inputs[st->lhs]];
+        scalar_t b =
+            FUSED_IS_REG(st->rhs) ? regs[FUSED_INDEX(st->rhs)] : values[f->inputs[st->rhs]];
+        regs[s] = apply(st->op, a, b);
+    }
+    return regs[f->num_steps - 1];
+}
+
+void tape_image_forward(const TapeImage *img, scalar_t *values) {
+    if (!img || !values)
+        return;
+
+    for (uint64_t i = 0; i < img->header->num_nodes; i++) {
+        const SerialNode *nd = &img->nodes[i];
+        if (nd->op == OP_NONE) {
+            if (nd->flags & SERIAL_PARAM)
+                values[i] = img->params[nd->arg[0]];
+        } else if (nd->op == OP_FUSED) {
+            values[i] = fused_eval(&img->fused[nd->arg[0]], values);
+        } else {
+            values[i] = apply(nd->op, values[nd->arg[0]], values[nd->arg[1]]);
+        }
+    }
+}
+
+/* ================================================================
+ *  Loading onto a tape
+ * ================================================================ */
+
+static ValueData *load_node(const TapeImage *img, uint64_t i, Tape *t, ParamStore *s,
+                            ValueData **nodes) {
+    const SerialNode *nd = &img->nodes[i];
+    const char *name = img->names[i];
+    ValueData *a, *b;
+
+    switch (nd->op) {
+    case OP_NONE:
+        if ((nd->flags & SERIAL_PARAM) && s)
+            return param_bind_with_tape(t, s, nd->arg[0]);
+        if (nd->flags & SERIAL_PARAM)
+            return value_create_with_tape(t, img->params[nd->arg[0]], name, 1);
+        return value_create_with_tape(t, nd->data, (nd->flags & SERIAL_CONSTANT) ? NULL : name,
+                                      (nd->flags & SERIAL_REQUIRES_GRAD) != 0);
+    case OP_FUSED: {
+        const SerialFused *f = &img->fused[nd->arg[0]];
+        FusedKernel k;
+        ValueData *inputs[FUSED_MAX_INPUTS];
+        k.num_inputs = f->num_inputs;
+        k.num_steps = f->num_steps;
+        k.inputs = NULL;
+        for (uint32_t j = 0; j < f->num_inputs; j++)
+            inputs[j] = nodes[f->inputs[j]];
+        for (uint32_t j = 0; j < f->num_steps; j++) {
+            k.steps[j].op = (ValueOp)f->steps[j].op;
+            k.steps[j].lhs = f->steps[j].lhs;
+            k.steps[j].rhs = f->steps[j].rhs;
+        }
+        return value_fused_with_tape(t, &k, inputs);
+    }
+    default:
+        /* Binary ops record on the current instance, set by tape_image_load */
+        a = nodes[nd->arg[0]];
+        b = nodes[nd->arg[1]];
+        switch (nd->op) {
+        case OP_ADD:
+            return value_add(a, b);
+        case OP_SUB:
+            return value_sub(a, b);
+        case OP_MUL:
+            return value_mul(a, b);
+        default:
+            return value_div(a, b);
+        }
+    }
+}
+
+int tape_image_load(const TapeImage *img, Tape *t, ParamStore *s, ValueData **nodes) {
+    if (!img || !t)
+        return -1;
+
+    size_t n = (size_t)img->header->num_nodes;
+    ValueData **created = nodes ? nodes : (ValueData **)malloc(sizeof(ValueData *) * (n + 1));
+    if (!created)
+        return -1;
+
+    Tape *prev = tape_set_instance(t);
+    int ret = 0;
+    for (size_t i = 0; i < n && ret == 0; i++) {
+        created[i] = load_node(img, i, t, s, created);
+        if (!created[i])
+            ret = -1;
+    }
+    tape_set_instance(prev);
+
+    if (created != nodes)
+        free(created);
+    return ret;
+}
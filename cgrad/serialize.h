@@ -0,0 +1,132 @@
+/*
+Binary, memory-mappable serialization of tapes and parameters.
+*/
+
+#ifndef CGRAD_SERIALIZE_H
+#define CGRAD_SERIALIZE_H
+
+#include "fusion.h"
+#include "params.h"
+#include "tape.h"
+#include "value.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * File layout (native byte order, every section aligned to SERIAL_ALIGN):
+ *
+ *   SerialHeader
+ *   SerialNode  nodes[num_nodes]   in tape order, children before parents
+ *   SerialFused fused[num_fused]   programs of OP_FUSED nodes
+ *   scalar_t    params[num_params] parameter store values
+ *   char        names[num_nodes][SERIAL_NAME_LEN]
+ *
+ * All records are fixed-size and refer to each other by index, so a mapped
+ * file is used as is: no pointer fix-ups, no parsing beyond validation.
+ * Names come last since evaluation never touches them.
+ */
+#define SERIAL_MAGIC      "CGRADTAP"
+#define SERIAL_VERSION    1
+#define SERIAL_BYTE_ORDER 0x01020304u
+#define SERIAL_ALIGN      64
+#define SERIAL_NAME_LEN   32
+
+typedef struct SerialHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;  // SERIAL_BYTE_ORDER as written by the producer
+    uint32_t scalar_size; // sizeof(scalar_t) of the producer
+    uint32_t reserved;
+    uint64_t file_size;
+    uint64_t num_nodes;
+    uint64_t nodes_offset;
+    uint64_t num_fused;
+    uint64_t fused_offset;
+    uint64_t num_params;
+    uint64_t params_offset;
+    uint64_t names_offset;
+} SerialHeader;
+
+/* Node flags */
+#define SERIAL_REQUIRES_GRAD (1u << 0)
+#define SERIAL_CONSTANT      (1u << 1) // Unnamed leaf without gradient
+#define SERIAL_PARAM         (1u << 2) // Leaf bound to params[arg[0]]
+
+typedef struct SerialNode {
+    uint32_t op;     // ValueOp
+    uint32_t flags;  // SERIAL_* flags
+    uint32_t arg[2]; // Child ids (binary ops), fused[arg[0]] (OP_FUSED), param index
+    scalar_t data;   // Recorded value
+} SerialNode;
+
+typedef struct SerialFusedStep {
+    uint8_t op;
+    uint8_t lhs; // FusedStep operand encoding
+    uint8_t rhs;
+    uint8_t reserved;
+} SerialFusedStep;
+
+typedef struct SerialFused {
+    uint32_t num_inputs;
+    uint32_t num_steps;
+    uint32_t inputs[FUSED_MAX_INPUTS]; // Node ids
+    SerialFusedStep steps[FUSED_MAX_STEPS];
+} SerialFused;
+
+/*
+ * Write the tape, and the parameters of s when s is not NULL, to path. Leaves
+ * bound to s are stored as references into the parameter section. Returns 0
+ * on success, -1 on error (checkpoint nodes and inputs off the tape cannot be
+ * serialized).
+ */
+int tape_save(const Tape *t, const ParamStore *s, const char *path);
+
+/* A serialized tape mapped read-only into memory */
+typedef struct TapeImage {
+    void *base;
+    size_t size;
+    const SerialHeader *header;
+    const SerialNode *nodes;
+    const SerialFused *fused;
+    const scalar_t *params;
+    const char (*names)[SERIAL_NAME_LEN];
+} TapeImage;
+
+/*
+ * Map a file written by tape_save and validate it: magic, version, byte
+ * order, scalar size, section bounds, and that every reference points to an
+ * earlier node. Returns NULL if the file cannot be used by this build.
+ */
+TapeImage *tape_image_open(const char *path);
+void tape_image_close(TapeImage *img);
+
+size_t tape_image_num_nodes(const TapeImage *img);
+
+/* Copy the recorded value of every node into values[0..num_nodes) */
+void tape_image_reset(const TapeImage *img, scalar_t *values);
+
+/*
+ * Evaluate the image in place: parameter leaves are read straight from the
+ * mapped parameter section, other leaves from values[] (set inputs by node
+ * id), and every op node is recomputed into values[].
+ */
+void tape_image_forward(const TapeImage *img, scalar_t *values);
+
+/*
+ * Rebuild the image as live nodes on t, for training or further recording.
+ * Parameter leaves are bound to s (which must already hold the parameters,
+ * e.g. from param_store_add_array with img->params), or recorded as plain
+ * leaves when s is NULL. When nodes is not NULL it receives the node created
+ * for every serialized node. Returns 0 on success, -1 on error.
+ */
+int tape_image_load(const TapeImage *img, Tape *t, ParamStore *s, ValueData **nodes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CGRAD_SERIALIZE_H
@@ -0,0 +1,315 @@
+/* subgraph.c - Subgraph templates */
+
+#include "subgraph.h"
+
+#include "fusion.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Adjoints of instances up to this many slots live on the stack */
+#define SUBGRAPH_LOCAL_SLOTS 256
+
+/* Arena bytes of an instance without its output nodes; must fit one tape block */
+static size_t instance_bytes(size_t num_inputs, size_t num_outputs, size_t num_steps) {
+    return sizeof(SubgraphInstance) + sizeof(ValueData *) * (num_inputs + num_outputs) +
+           sizeof(scalar_t) * num_steps;
+}
+
+size_t subgraph_instance_size(const SubgraphTemplate *tmpl) {
+    if (!tmpl)
+        return 0;
+    size_t bytes = instance_bytes(tmpl->num_inputs, tmpl->num_outputs, tmpl->num_steps);
+    return ((bytes + 7) & ~(size_t)7) + tmpl->num_outputs * ((sizeof(ValueData) + 7) & ~(size_t)7);
+}
+
+/* ================================================================
+ *  Capture
+ * ================================================================ */
+
+/* Steps a recorded node expands to, or -1 if it cannot be part of a template */
+static long node_steps(const ValueData *v) {
+    if (v->opcode == OP_NONE)
+        return 0;
+    if (value_op_is_binary(v->opcode))
+        return 1;
+    if (v->opcode == OP_FUSED)
+        return (long)((const FusedKernel *)v->ctx)->num_steps;
+    return -1;
+}
+
+/* Slot of an operand node, or UINT32_MAX if it was not recorded by the body */
+static uint32_t operand_slot(const Tape *t, const uint32_t *slot, const ValueData *x) {
+    return tape_contains(t, x) ? slot[x->id] : UINT32_MAX;
+}
+
+/*
+ * Turn the scratch tape into a template: nodes [0, num_inputs) are the input
+ * placeholders, other leaves become constants and op nodes become steps, with
+ * fused kernels inlined.
+ */
+static SubgraphTemplate *capture(const Tape *t, size_t num_inputs, ValueData **outputs,
+                                 size_t num_outputs) {
+    size_t n = t->num_nodes;
+    size_t num_consts = 0, num_steps = 0;
+    for (size_t i = num_inputs; i < n; i++) {
+        long steps = node_steps(t->nodes[i]);
+        if (steps < 0)
+            return NULL;
+        num_consts += steps == 0;
+        num_steps += (size_t)steps;
+    }
+    if (instance_bytes(num_inputs, num_outputs, num_steps) > TAPE_BLOCK_SIZE)
+        return NULL;
+
+    /* One allocation: header, constants, steps, output slots */
+    size_t bytes = sizeof(SubgraphTemplate) + sizeof(scalar_t) * num_consts +
+                   sizeof(SubgraphStep) * num_steps + sizeof(uint32_t) * num_outputs;
+    SubgraphTemplate *tmpl = (SubgraphTemplate *)calloc(1, bytes);
+    uint32_t *slot = (uint32_t *)malloc(sizeof(uint32_t) * (n ? n : 1));
+    if (!tmpl || !slot) {
+        free(tmpl);
+        free(slot);
+        return NULL;
+    }
+    tmpl->num_inputs = num_inputs;
+    tmpl->num_consts = num_consts;
+    tmpl->num_steps = num_steps;
+    tmpl->num_outputs = num_outputs;
+    tmpl->consts = (scalar_t *)(tmpl + 1);
+    tmpl->steps = (SubgraphStep *)(tmpl->consts + num_consts);
+    tmpl->outputs = (uint32_t *)(tmpl->steps + num_steps);
+
+    for (size_t i = 0; i < num_inputs; i++)
+        slot[i] = (uint32_t)i;
+
+    uint32_t base = (uint32_t)(num_inputs + num_consts);
+    size_t c = 0, s = 0;
+    int ok = 1;
+    for (size_t i = num_inputs; ok && i < n; i++) {
+        const ValueData *v = t->nodes[i];
+        if (v->opcode == OP_NONE) {
+            tmpl->consts[c] = v->data;
+            slot[i] = (uint32_t)(num_inputs + c++);
+        } else if (value_op_is_binary(v->opcode)) {
+            SubgraphStep *st = &tmpl->steps[s];
+            st->op = v->opcode;
+            st->lhs = operand_slot(t, slot, v->children[0]);
+            st->rhs = operand_slot(t, slot, v->children[1]);
+            ok = st->lhs != UINT32_MAX && st->rhs != UINT32_MAX;
+            slot[i] = base + (uint32_t)s++;
+        } else {
+            const FusedKernel *k = (const FusedKernel *)v->ctx;
+            uint32_t first = base + (uint32_t)s;
+            for (size_t j = 0; ok && j < k->num_steps; j++) {
+                const FusedStep *fs = &k->steps[j];
+                SubgraphStep *st = &tmpl->steps[s++];
+                st->op = fs->op;
+                st->lhs = FUSED_IS_REG(fs->lhs) ? first + FUSED_INDEX(fs->lhs)
+                                                : operand_slot(t, slot, k->inputs[fs->lhs]);
+                st->rhs = FUSED_IS_REG(fs->rhs) ? first + FUSED_INDEX(fs->rhs)
+                                                : operand_slot(t, slot, k->inputs[fs->rhs]);
+                ok = st->lhs != UINT32_MAX && st->rhs != UINT32_MAX;
+            }
+            slot[i] = base + (uint32_t)s - 1;
+        }
+    }
+    for (size_t o = 0; ok && o < num_outputs; o++) {
+        tmpl->outputs[o] = operand_slot(t, slot, outputs[o]);
+        ok = tmpl->outputs[o] != UINT32_MAX;
+    }
+
+    free(slot);
+    if (!ok) {
+        free(tmpl);
+        return NULL;
+    }
+    return tmpl;
+}
+
+SubgraphTemplate *subgraph_template_create(SubgraphFn fn, size_t num_inputs, size_t num_outputs,
+                                           void *ctx) {
+    if (!fn || num_outputs == 0)
+        return NULL;
+
+    Tape *scratch = tape_create();
+    ValueData **inputs = (ValueData **)calloc(num_inputs + 1, sizeof(ValueData *));
+    ValueData **outputs = (ValueData **)calloc(num_outputs, sizeof(ValueData *));
+    SubgraphTemplate *tmpl = NULL;
+    if (scratch && inputs && outputs) {
+        /* Placeholders take the first ids; their values do not matter */
+        Tape *prev = tape_set_instance(scratch);
+        int ok = 1;
+        for (size_t i = 0; i < num_inputs; i++)
+            ok &= (inputs[i] = value_create(1.0, "", 1)) != NULL;
+        if (ok)
+            fn(inputs, outputs, ctx);
+        tape_set_instance(prev);
+        if (ok)
+            tmpl = capture(scratch, num_inputs, outputs, num_outputs);
+    }
+
+    tape_destroy(scratch);
+    free(inputs);
+    free(outputs);
+    return tmpl;
+}
+
+void subgraph_template_destroy(SubgraphTemplate *tmpl) {
+    free(tmpl);
+}
+
+/* ================================================================
+ *  Instances
+ * ================================================================ */
+
+static inline scalar_t slot_value(const SubgraphInstance *inst, uint32_t s) {
+    const SubgraphTemplate *tmpl = inst->tmpl;
+    if (s < tmpl->num_inputs)
+        return inst->inputs[s]->data;
+    s -= (uint32_t)tmpl->num_inputs;
+    if (s < tmpl->num_consts)
+        return tmpl->consts[s];
+    return inst->values[s - tmpl->num_consts];
+}
+
+static void instance_eval(SubgraphInstance *inst) {
+    const SubgraphTemplate *tmpl = inst->tmpl;
+    for (size_t s = 0; s < tmpl->num_steps; s++) {
+        const SubgraphStep *st = &tmpl->steps[s];
+        scalar_t a = slot_value(inst, st->lhs);
+        scalar_t b = slot_value(inst, st->rhs);
+        switch (st->op) {
+        case OP_ADD:
+            inst->values[s] = a + b;
+            break;
+        case OP_SUB:
+            inst->values[s] = a - b;
+            break;
+        case OP_MUL:
+            inst->values[s] = a * b;
+            break;
+        case OP_DIV:
+            inst->values[s] = a / b;
+            break;
+        default:
+            inst->values[s] = 0.0f;
+            break;
+        }
+    }
+}
+
+int subgraph_apply(const SubgraphTemplate *tmpl, ValueData **inputs, ValueData **outputs) {
+    if (!tmpl || (tmpl->num_inputs && !inputs) || !outputs)
+        return -1;
+
+    int requires_grad = 0;
+    for (size_t i = 0; i < tmpl->num_inputs; i++) {
+        if (!inputs[i])
+            return -1;
+        requires_grad |= inputs[i]->requires_grad;
+    }
+
+    Tape *t = tape_get_instance();
+    SubgraphInstance *inst = (SubgraphInstance *)tape_allocate(
+        t, instance_bytes(tmpl->num_inputs, tmpl->num_outputs, tmpl->num_steps));
+    if (!inst)
+        return -1;
+    inst->tmpl = tmpl;
+    inst->inputs = (ValueData **)(inst + 1);
+    inst->outputs = inst->inputs + tmpl->num_inputs;
+    inst->values = (scalar_t *)(inst->outputs + tmpl->num_outputs);
+    memcpy(inst->inputs, inputs, sizeof(ValueData *) * tmpl->num_inputs);
+    instance_eval(inst);
+
+    for (size_t o = 0; o < tmpl->num_outputs; o++) {
+        scalar_t data = slot_value(inst, tmpl->outputs[o]);
+        ValueData *y = value_create_with_tape(t, data, NULL, requires_grad);
+        if (!y)
+            return -1;
+        y->opcode = OP_SUBGRAPH;
+        snprintf(y->op, sizeof(y->op), "%s", value_op_symbol(OP_SUBGRAPH));
+        y->ctx = inst;
+        y->backward_fn = o == 0 && requires_grad ? subgraph_backward : NULL;
+        inst->outputs[o] = y;
+        outputs[o] = y;
+    }
+    return 0;
+}
+
+ValueData **subgraph_inputs(const ValueData *v, size_t *count) {
+    SubgraphInstance *inst = (SubgraphInstance *)v->ctx;
+    if (v == inst->outputs[0]) {
+        *count = inst->tmpl->num_inputs;
+        return inst->inputs;
+    }
+    *count = 1;
+    return inst->outputs;
+}
+
+void subgraph_forward(ValueData *v) {
+    SubgraphInstance *inst = (SubgraphInstance *)v->ctx;
+    if (v != inst->outputs[0])
+        return; // Recomputed with the first output, which comes earlier on the tape
+
+    const SubgraphTemplate *tmpl = inst->tmpl;
+    instance_eval(inst);
+    for (size_t o = 0; o < tmpl->num_outputs; o++)
+        inst->outputs[o]->data = slot_value(inst, tmpl->outputs[o]);
+}
+
+/*
+ * Reverse sweep of the whole instance, run from the first output: the other
+ * outputs are recorded after it, so their gradients are complete by then.
+ */
+void subgraph_backward(ValueData *v) {
+    const SubgraphInstance *inst = (const SubgraphInstance *)v->ctx;
+    const SubgraphTemplate *tmpl = inst->tmpl;
+    size_t num_slots = tmpl->num_inputs + tmpl->num_consts + tmpl->num_steps;
+    scalar_t local[SUBGRAPH_LOCAL_SLOTS];
+    scalar_t *adj = num_slots <= SUBGRAPH_LOCAL_SLOTS
+                        ? local
+                        : (scalar_t *)malloc(sizeof(scalar_t) * num_slots);
+    if (!adj)
+        return;
+    memset(adj, 0, sizeof(scalar_t) * num_slots);
+
+    for (size_t o = 0; o < tmpl->num_outputs; o++)
+        adj[tmpl->outputs[o]] += inst->outputs[o]->grad;
+
+    size_t base = tmpl->num_inputs + tmpl->num_consts;
+    for (size_t s = tmpl->num_steps; s > 0; s--) {
+        const SubgraphStep *st = &tmpl->steps[s - 1];
+        scalar_t g = adj[base + s - 1];
+        if (g == 0.0f)
+            continue;
+        scalar_t a = slot_value(inst, st->lhs);
+        scalar_t b = slot_value(inst, st->rhs);
+        switch (st->op) {
+        case OP_ADD:
+            adj[st->lhs] += g;
+            adj[st->rhs] += g;
+            break;
+        case OP_SUB:
+            adj[st->lhs] += g;
+            adj[st->rhs] -= g;
+            break;
+        case OP_MUL:
+            adj[st->lhs] += b * g;
+            adj[st->rhs] += a * g;
+            break;
+        case OP_DIV:
+            adj[st->lhs] += g / b;
+            adj[st->rhs] -= (a / (b * b)) * g;
+            break;
+        default:
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < tmpl->num_inputs; i++)
+        inst->inputs[i]->grad += adj[i];
+    if (adj != local)
+        free(adj);
+}
@@ -0,0 +1,93 @@
+/*
+Subgraph templates: a repeated structure (an RNN time step, a layer of a stack)
+recorded once and instantiated many times.
+*/
+
+#ifndef CGRAD_SUBGRAPH_H
+#define CGRAD_SUBGRAPH_H
+
+#include "tape.h"
+#include "value.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Body of a template: records outputs[0 .. num_outputs) from
+ * inputs[0 .. num_inputs) on the current tape, using the binary ops (and
+ * fused nodes). Everything that differs between instances or needs a
+ * gradient, weights included, must be an input: leaves the body creates are
+ * baked into the template as constants.
+ */
+typedef void (*SubgraphFn)(ValueData **inputs, ValueData **outputs, void *ctx);
+
+/* Operands are slots: inputs, then constants, then the result of each step */
+typedef struct SubgraphStep {
+    ValueOp op;
+    uint32_t lhs;
+    uint32_t rhs;
+} SubgraphStep;
+
+/* Shared structure of every instance; owned by the caller, not by a tape */
+typedef struct SubgraphTemplate {
+    size_t num_inputs;
+    size_t num_consts;
+    size_t num_steps;
+    size_t num_outputs;
+    scalar_t *consts;
+    SubgraphStep *steps;
+    uint32_t *outputs; // Slot of each output
+} SubgraphTemplate;
+
+/*
+ * One instance, in the arena of the tape it was recorded on: the bindings,
+ * one value per step and the output nodes. No node is recorded for the steps.
+ */
+typedef struct SubgraphInstance {
+    const SubgraphTemplate *tmpl;
+    ValueData **inputs;
+    ValueData **outputs;
+    scalar_t *values;
+} SubgraphInstance;
+
+/*
+ * Run fn once on a scratch tape and capture its structure. Returns NULL if the
+ * body fails, leaves an output NULL, reads nodes from another tape or records
+ * an op other than the binary ops and fused nodes.
+ */
+SubgraphTemplate *subgraph_template_create(SubgraphFn fn, size_t num_inputs, size_t num_outputs,
+                                           void *ctx);
+void subgraph_template_destroy(SubgraphTemplate *tmpl);
+
+/*
+ * Instantiate the template on the current tape with the given input bindings
+ * and store its output nodes in outputs[0 .. num_outputs). The outputs are
+ * OP_SUBGRAPH nodes: the first one runs the backward sweep of the whole
+ * instance and the others depend on it, so that passes keep them together.
+ * Returns 0 on success, -1 on error.
+ *
+ * The template must outlive every tape holding one of its instances. Like
+ * checkpoints, OP_SUBGRAPH nodes are handled by replay and the backward pass
+ * but not by codegen, serialization, the memory planner or the Jacobian and
+ * forward-mode sweeps.
+ */
+int subgraph_apply(const SubgraphTemplate *tmpl, ValueData **inputs, ValueData **outputs);
+
+/* Bytes of arena one instance takes, output nodes included */
+size_t subgraph_instance_size(const SubgraphTemplate *tmpl);
+
+/* Input nodes of an OP_SUBGRAPH node (see value_inputs) */
+ValueData **subgraph_inputs(const ValueData *v, size_t *count);
+
+/* Forward replay and backward pass of an OP_SUBGRAPH node */
+void subgraph_forward(ValueData *v);
+void subgraph_backward(ValueData *v);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CGRAD_SUBGRAPH_H
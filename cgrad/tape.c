@@ -1,18 +1,29 @@
 /* tape.c - Tape implementation */
 
+#define _GNU_SOURCE // sync_file_range
+
 #include "tape.h"
 
+#include "checkpoint.h"
+#include "fusion.h"
+#include "graph.h"
+#include "profile.h"
+#include "subgraph.h"
 #include "value.h"
 
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 /* Initial capacities */
 #define INITIAL_BLOCKS_CAPACITY 8
 #define INITIAL_NODES_CAPACITY  64
 
-/* Global singleton instance */
-static Tape *g_tape_instance = NULL;
+/* Current tape of each thread, so that threads can record concurrently */
+static _Thread_local Tape *g_tape_instance = NULL;
 
 Tape *tape_create(void) {
     Tape *t = (Tape *)malloc(sizeof(Tape));
@@ -23,11 +34,192 @@ Tape *tape_create(void) {
     t->blocks = (TapeBlock **)malloc(sizeof(TapeBlock *) * INITIAL_BLOCKS_CAPACITY);
     t->num_blocks = 0;
     t->blocks_capacity = INITIAL_BLOCKS_CAPACITY;
+    t->blocks_owned = 0;
+    t->retain = 0;
 
     t->nodes = (ValueData **)malloc(sizeof(ValueData *) * INITIAL_NODES_CAPACITY);
     t->num_nodes = 0;
     t->nodes_capacity = INITIAL_NODES_CAPACITY;
 
+    t->map = NULL;
+    t->map_capacity = 0;
+    t->map_fd = -1;
+
+    t->region = NULL;
+    t->region_size = 0;
+
+    t->error = TAPE_OK;
+    t->on_error = NULL;
+    t->error_ctx = NULL;
+
+    tape_hash_invalidate(t);
+    return t;
+}
+
+/* ================================================================
+ *  Fixed tapes
+ * ================================================================ */
+
+#define REGION_ALIGN 64 // Cache line
+
+/* Every node takes a ValueData in the arena, so a block never holds more than this */
+#define NODES_PER_BLOCK (TAPE_BLOCK_SIZE / sizeof(ValueData))
+
+static size_t align_up(size_t n) {
+    return (n + REGION_ALIGN - 1) & ~(size_t)(REGION_ALIGN - 1);
+}
+
+/* Layout from an aligned start: Tape, block pointers, node pointers, then the blocks */
+static size_t region_layout(size_t num_blocks, size_t *nodes_off, size_t *blocks_off) {
+    size_t pointers_off = align_up(sizeof(Tape));
+    *nodes_off = align_up(pointers_off + num_blocks * sizeof(TapeBlock *));
+    *blocks_off = align_up(*nodes_off + num_blocks * NODES_PER_BLOCK * sizeof(ValueData *));
+    return *blocks_off + num_blocks * sizeof(TapeBlock);
+}
+
+size_t tape_region_size(size_t arena_bytes) {
+    size_t num_blocks = (arena_bytes + TAPE_BLOCK_SIZE - 1) / TAPE_BLOCK_SIZE;
+    size_t nodes_off, blocks_off;
+    if (num_blocks == 0)
+        num_blocks = 1;
+    return region_layout(num_blocks, &nodes_off, &blocks_off) + REGION_ALIGN - 1;
+}
+
+Tape *tape_create_in(void *buf, size_t size) {
+    if (!buf)
+        return NULL;
+    uintptr_t base = ((uintptr_t)buf + REGION_ALIGN - 1) & ~(uintptr_t)(REGION_ALIGN - 1);
+    size_t skip = (size_t)(base - (uintptr_t)buf);
+    if (size <= skip)
+        return NULL;
+    size -= skip;
+
+    /* As many blocks as fit, with their share of both pointer arrays */
+    size_t nodes_off, blocks_off;
+    size_t per_block = sizeof(TapeBlock) + sizeof(TapeBlock *) + NODES_PER_BLOCK * sizeof(ValueData *);
+    size_t fixed = region_layout(0, &nodes_off, &blocks_off);
+    size_t num_blocks = size > fixed ? (size - fixed) / per_block : 0;
+    while (num_blocks > 0 && region_layout(num_blocks, &nodes_off, &blocks_off) > size)
+        num_blocks--;
+    if (num_blocks == 0)
+        return NULL;
+    region_layout(num_blocks, &nodes_off, &blocks_off);
+
+    uint8_t *p = (uint8_t *)base;
+    Tape *t = (Tape *)p;
+    t->blocks = (TapeBlock **)(p + align_up(sizeof(Tape)));
+    t->num_blocks = 0;
+    t->blocks_capacity = num_blocks;
+    t->blocks_owned = 0;
+    t->retain = 0;
+
+    t->nodes = (ValueData **)(p + nodes_off);
+    t->num_nodes = 0;
+    t->nodes_capacity = num_blocks * NODES_PER_BLOCK;
+
+    t->map = NULL;
+    t->map_capacity = 0;
+    t->map_fd = -1;
+
+    t->region = p + blocks_off;
+    t->region_size = 0;
+
+    t->error = TAPE_OK;
+    t->on_error = NULL;
+    t->error_ctx = NULL;
+
+    tape_hash_invalidate(t);
+    return t;
+}
+
+Tape *tape_create_region(size_t size, unsigned flags) {
+    int mflags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_POPULATE
+    mflags |= MAP_POPULATE;
+#endif
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, mflags, -1, 0);
+    if (map == MAP_FAILED)
+        return NULL;
+
+    Tape *t = NULL;
+    if (!(flags & TAPE_REGION_LOCK) || mlock(map, size) == 0)
+        t = tape_create_in(map, size);
+    if (!t) {
+        munmap(map, size);
+        return NULL;
+    }
+
+    /* The mapping is page aligned, so the tape sits at its start */
+    t->region_size = size;
+    return t;
+}
+
+void tape_set_error_handler(Tape *t, TapeErrorFn fn, void *ctx) {
+    if (!t)
+        return;
+    t->on_error = fn;
+    t->error_ctx = ctx;
+}
+
+TapeError tape_error(const Tape *t) {
+    return t ? t->error : TAPE_OK;
+}
+
+const char *tape_error_string(TapeError err) {
+    switch (err) {
+    case TAPE_OK:
+        return "no error";
+    case TAPE_ERR_ARENA:
+        return "tape arena exhausted";
+    case TAPE_ERR_NODES:
+        return "tape node index full";
+    case TAPE_ERR_SIZE:
+        return "allocation larger than a tape block";
+    }
+    return "unknown tape error";
+}
+
+/* Record a failed allocation; always returns NULL for the allocator to pass on */
+static void *tape_fail(Tape *t, TapeError err) {
+    t->error = err;
+    if (t->on_error)
+        t->on_error(t, err, t->error_ctx);
+    return NULL;
+}
+
+Tape *tape_create_mapped(const char *dir, size_t capacity) {
+    if (!dir)
+        dir = getenv("TMPDIR");
+    if (!dir || !*dir)
+        dir = "/var/tmp";
+
+    char path[4096];
+    if (snprintf(path, sizeof(path), "%s/cgrad-tape-XXXXXX", dir) >= (int)sizeof(path))
+        return NULL;
+    int fd = mkstemp(path);
+    if (fd < 0)
+        return NULL;
+    unlink(path);
+
+    /* The file is sparse: disk is only used by blocks that are written */
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    capacity = (capacity + page - 1) / page * page;
+    void *map = MAP_FAILED;
+    if (capacity >= sizeof(TapeBlock) && ftruncate(fd, (off_t)capacity) == 0)
+        map = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    Tape *t = map != MAP_FAILED ? tape_create() : NULL;
+    if (!t) {
+        if (map != MAP_FAILED)
+            munmap(map, capacity);
+        close(fd);
+        return NULL;
+    }
+
+    /* Sweeps read ahead explicitly; the default read-around only helps forward faults */
+    madvise(map, capacity, MADV_RANDOM);
+    t->map = (uint8_t *)map;
+    t->map_capacity = capacity;
+    t->map_fd = fd;
     return t;
 }
 
@@ -35,9 +227,21 @@ void tape_destroy(Tape *t) {
     if (!t)
         return;
 
+    /* A fixed tape lives in its region */
+    if (t->region) {
+        if (t->region_size)
+            munmap(t, t->region_size);
+        return;
+    }
+
     /* Free all blocks */
-    for (size_t i = 0; i < t->num_blocks; i++) {
-        free(t->blocks[i]);
+    if (t->map) {
+        munmap(t->map, t->map_capacity);
+        close(t->map_fd);
+    } else {
+        for (size_t i = 0; i < t->blocks_owned; i++) {
+            free(t->blocks[i]);
+        }
     }
     free(t->blocks);
     free(t->nodes);
@@ -51,6 +255,12 @@ Tape *tape_get_instance(void) {
     return g_tape_instance;
 }
 
+Tape *tape_set_instance(Tape *t) {
+    Tape *prev = g_tape_instance;
+    g_tape_instance = t;
+    return prev;
+}
+
 void tape_destroy_instance(void) {
     if (g_tape_instance) {
         tape_destroy(g_tape_instance);
@@ -58,12 +268,105 @@ void tape_destroy_instance(void) {
     }
 }
 
+/* ================================================================
+ *  Out-of-core windows
+ * ================================================================ */
+
+/* Byte range of window w within the part of the mapping in use; 0 if outside */
+static size_t map_range(const Tape *t, size_t w, size_t *off) {
+    size_t used = t->num_blocks * sizeof(TapeBlock);
+    *off = w * TAPE_MAP_WINDOW;
+    if (*off >= used)
+        return 0;
+    return used - *off < TAPE_MAP_WINDOW ? used - *off : TAPE_MAP_WINDOW;
+}
+
+static void map_prefetch(Tape *t, size_t w) {
+    size_t off, len = map_range(t, w, &off);
+    if (len)
+        madvise(t->map + off, len, MADV_WILLNEED);
+}
+
+/* Start writing window w to the file without waiting */
+static void map_writeback(Tape *t, size_t w) {
+    size_t off, len = map_range(t, w, &off);
+#ifdef __linux__
+    if (len)
+        sync_file_range(t->map_fd, (off_t)off, (off_t)len, SYNC_FILE_RANGE_WRITE);
+#else
+    (void)off;
+    (void)len;
+#endif
+}
+
+/* Finish writing window w, then release its pages */
+static void map_drop(Tape *t, size_t w) {
+    size_t off, len = map_range(t, w, &off);
+    if (!len)
+        return;
+#ifdef __linux__
+    sync_file_range(t->map_fd, (off_t)off, (off_t)len,
+                    SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+                        SYNC_FILE_RANGE_WAIT_AFTER);
+#else
+    msync(t->map + off, len, MS_SYNC);
+#endif
+    madvise(t->map + off, len, MADV_DONTNEED);
+    posix_fadvise(t->map_fd, (off_t)off, (off_t)len, POSIX_FADV_DONTNEED);
+}
+
+/*
+ * A sweep over the nodes reached `v`: when it enters a new window, read ahead
+ * the window it reaches next and let go of the ones behind it. Nodes outside
+ * the mapping (e.g. from another tape) are ignored.
+ */
+static void map_visit(Tape *t, const ValueData *v, size_t *window, int reverse) {
+    const uint8_t *p = (const uint8_t *)v;
+    if (p < t->map || p >= t->map + t->num_blocks * sizeof(TapeBlock))
+        return;
+    size_t w = (size_t)(p - t->map) / TAPE_MAP_WINDOW;
+    if (w == *window)
+        return;
+    *window = w;
+
+    if (reverse) {
+        if (w > 0)
+            map_prefetch(t, w - 1);
+        map_writeback(t, w + 1);
+        map_drop(t, w + 2);
+    } else {
+        map_prefetch(t, w + 1);
+        if (w >= 1)
+            map_writeback(t, w - 1);
+        if (w >= 2)
+            map_drop(t, w - 2);
+    }
+}
+
+/* Next block of an out-of-core tape, spilling the windows recording has left */
+static TapeBlock *map_block(Tape *t) {
+    size_t i = t->num_blocks;
+    if ((i + 1) * sizeof(TapeBlock) > t->map_capacity)
+        return NULL;
+
+    size_t w = i * sizeof(TapeBlock) / TAPE_MAP_WINDOW;
+    if (i > 0 && w != (i - 1) * sizeof(TapeBlock) / TAPE_MAP_WINDOW) {
+        map_writeback(t, w - 1);
+        if (w >= 2)
+            map_drop(t, w - 2);
+    }
+    return (TapeBlock *)(t->map + i * sizeof(TapeBlock));
+}
+
 void *tape_allocate(Tape *t, size_t size) {
     if (!t)
         return NULL;
+    PROFILE_BEGIN(start);
 
     // 8 bytes alignment
     size = (size + 7) & ~7;
+    if (size > TAPE_BLOCK_SIZE)
+        return tape_fail(t, TAPE_ERR_SIZE);
 
     /* Check if a new block is needed */
     if (t->num_blocks == 0 || t->blocks[t->num_blocks - 1]->offset + size > TAPE_BLOCK_SIZE) {
@@ -71,64 +374,232 @@ void *tape_allocate(Tape *t, size_t size) {
         /* No space in current block, allocate a new one
         In principle == is enough, but just in case */
         if (t->num_blocks >= t->blocks_capacity) {
+            if (t->region)
+                return tape_fail(t, TAPE_ERR_ARENA);
             size_t new_capacity = t->blocks_capacity * 2;
             TapeBlock **new_blocks =
                 (TapeBlock **)realloc(t->blocks, sizeof(TapeBlock *) * new_capacity);
             if (!new_blocks)
-                return NULL;
+                return tape_fail(t, TAPE_ERR_ARENA);
             t->blocks_capacity = new_capacity;
             t->blocks = new_blocks;
         }
 
         /* Allocate a new block */
-        TapeBlock *block = (TapeBlock *)malloc(sizeof(TapeBlock));
+        TapeBlock *block;
+        if (t->region)
+            block = (TapeBlock *)(t->region + t->num_blocks * sizeof(TapeBlock));
+        else if (t->map)
+            block = map_block(t);
+        else if (t->num_blocks < t->blocks_owned)
+            block = t->blocks[t->num_blocks]; // Kept by tape_clear
+        else
+            block = (TapeBlock *)malloc(sizeof(TapeBlock));
         if (!block)
-            return NULL;
+            return tape_fail(t, TAPE_ERR_ARENA);
+        if (!t->region && !t->map && t->num_blocks == t->blocks_owned)
+            t->blocks_owned++;
         block->offset = 0;
         t->blocks[t->num_blocks++] = block;
+        PROFILE_BLOCK();
     }
 
     /* Move the allocation pointer within the current block */
     TapeBlock *block = t->blocks[t->num_blocks - 1];
     void *ptr = block->data + block->offset;
     block->offset += size;
+    PROFILE_ALLOC(size, start);
     return ptr;
 }
 
 void tape_clear(Tape *t) {
     if (!t) return;
 
-    for (size_t i = 0; i < t->num_blocks; i++) {
-        free(t->blocks[i]);
+    if (t->map) {
+        /* Drop the pages and the file contents; the mapping stays valid */
+        madvise(t->map, t->map_capacity, MADV_DONTNEED);
+        if (ftruncate(t->map_fd, 0) != 0 || ftruncate(t->map_fd, (off_t)t->map_capacity) != 0)
+            perror("tape_clear");
+    } else if (!t->region && !t->retain) {
+        for (size_t i = 0; i < t->blocks_owned; i++) {
+            free(t->blocks[i]);
+        }
+        t->blocks_owned = 0;
     }
     t->num_blocks = 0;
     t->num_nodes = 0;
+    t->error = TAPE_OK;
+    tape_hash_invalidate(t);
 }
 
-void tape_register_node(Tape *t, ValueData *node) {
-    if (!t || !node)
+void tape_set_retain(Tape *t, int retain) {
+    if (t)
+        t->retain = retain;
+}
+
+/* ================================================================
+ *  Structural hash
+ * ================================================================ */
+
+#define HASH_SEED_0 0x243F6A8885A308D3ull
+#define HASH_SEED_1 0x13198A2E03707344ull
+
+static inline void hash_word(uint64_t hash[2], uint64_t x) {
+    hash[0] = (hash[0] ^ x) * 0xBF58476D1CE4E5B9ull;
+    hash[0] ^= hash[0] >> 31;
+    hash[1] = (hash[1] ^ x) * 0x94D049BB133111EBull;
+    hash[1] ^= hash[1] >> 29;
+}
+
+/* Input of node i: its distance back along the tape, or its address if on another tape */
+static inline uint64_t hash_input(const Tape *t, size_t i, const ValueData *in) {
+    if (tape_contains(t, in))
+        return (uint64_t)(i - in->id);
+    return ~(uint64_t)(uintptr_t)in;
+}
+
+static void hash_node(const Tape *t, size_t i, uint64_t hash[2]) {
+    const ValueData *v = t->nodes[i];
+    uint64_t head = (uint64_t)v->opcode | (uint64_t)(v->requires_grad != 0) << 8;
+
+    /* Binary ops, the bulk of a tape, take a single word */
+    if (v->opcode >= OP_ADD && v->opcode <= OP_DIV) {
+        uint64_t lhs = hash_input(t, i, v->children[0]);
+        uint64_t rhs = hash_input(t, i, v->children[1]);
+        if ((lhs | rhs) < (1ull << 24)) {
+            hash_word(hash, head | lhs << 16 | rhs << 40);
+            return;
+        }
+        hash_word(hash, head | 1ull << 9);
+        hash_word(hash, lhs);
+        hash_word(hash, rhs);
+        return;
+    }
+
+    if (v->opcode == OP_NONE) {
+        if (!value_is_constant(v)) {
+            hash_word(hash, head);
+            return;
+        }
+        uint64_t bits = 0;
+        memcpy(&bits, &v->data, sizeof(v->data));
+        hash_word(hash, head | 1ull << 10);
+        hash_word(hash, bits);
+        return;
+    }
+
+    size_t count;
+    ValueData **in = value_inputs(v, &count);
+    hash_word(hash, head | (uint64_t)count << 16);
+    for (size_t j = 0; j < count; j++)
+        hash_word(hash, hash_input(t, i, in[j]));
+
+    if (v->opcode == OP_FUSED) {
+        const FusedKernel *k = (const FusedKernel *)v->ctx;
+        for (size_t s = 0; s < k->num_steps; s++) {
+            const FusedStep *st = &k->steps[s];
+            hash_word(hash, (uint64_t)st->op | (uint64_t)st->lhs << 8 | (uint64_t)st->rhs << 16);
+        }
+    } else if (v->opcode == OP_CHECKPOINT) {
+        const CheckpointSegment *seg = (const CheckpointSegment *)v->ctx;
+        hash_word(hash, (uint64_t)(uintptr_t)seg->fn ^ (uint64_t)(uintptr_t)seg->ctx);
+        hash_word(hash, (uint64_t)seg->first | (uint64_t)seg->count << 32);
+    } else if (v->opcode == OP_SUBGRAPH) {
+        /* Instances of one template share their structure */
+        const SubgraphInstance *inst = (const SubgraphInstance *)v->ctx;
+        hash_word(hash, (uint64_t)(uintptr_t)inst->tmpl);
+    }
+}
+
+/* Fold nodes [num_hashed, end) into the hash */
+static void hash_nodes(Tape *t, size_t end) {
+    uint64_t hash[2] = {t->hash[0], t->hash[1]};
+    for (size_t i = t->num_hashed; i < end; i++)
+        hash_node(t, i, hash);
+    t->hash[0] = hash[0];
+    t->hash[1] = hash[1];
+    t->num_hashed = end;
+}
+
+void tape_structure_hash(Tape *t, uint64_t hash[2]) {
+    if (!t) {
+        hash[0] = hash[1] = 0;
         return;
+    }
+    hash_nodes(t, t->num_nodes);
+    hash[0] = t->hash[0] ^ t->num_nodes;
+    hash[1] = t->hash[1];
+}
+
+void tape_hash_invalidate(Tape *t) {
+    if (!t)
+        return;
+    t->hash[0] = HASH_SEED_0;
+    t->hash[1] = HASH_SEED_1;
+    t->num_hashed = 0;
+}
+
+int tape_register_node(Tape *t, ValueData *node) {
+    if (!t || !node)
+        return -1;
 
     /* Grow nodes array if needed */
     if (t->num_nodes >= t->nodes_capacity) {
+        if (t->region) {
+            tape_fail(t, TAPE_ERR_NODES);
+            return -1;
+        }
         size_t new_capacity = t->nodes_capacity * 2;
         ValueData **new_nodes = (ValueData **)realloc(t->nodes, sizeof(ValueData *) * new_capacity);
-        if (!new_nodes)
-            return;
+        if (!new_nodes) {
+            tape_fail(t, TAPE_ERR_NODES);
+            return -1;
+        }
         t->nodes_capacity = new_capacity;
         t->nodes = new_nodes;
     }
 
+    node->id = t->num_nodes;
     t->nodes[t->num_nodes++] = node;
+    return 0;
+}
+
+int tape_contains(const Tape *t, const ValueData *node) {
+    return t && node && node->id < t->num_nodes && t->nodes[node->id] == node;
+}
+
+void tape_forward(Tape *t) {
+    if (!t)
+        return;
+
+    /* Nodes are registered after their children, so tape order is topological */
+    size_t window = SIZE_MAX;
+    for (size_t i = 0; i < t->num_nodes; i++) {
+        ValueData *v = t->nodes[i];
+        if (t->map)
+            map_visit(t, v, &window, 0);
+        if (v->opcode != OP_NONE) {
+            PROFILE_BEGIN(start);
+            value_forward(v);
+            PROFILE_END(PROFILE_FORWARD, v->opcode, start);
+        }
+    }
 }
 
 void tape_backward(Tape *t) {
     if (!t) return;
 
     /* Iterate over nodes in backward order */
+    size_t window = SIZE_MAX;
     for (size_t i = t->num_nodes; i > 0; i--) {
       ValueData* v = t->nodes[i-1];
-      if (v->backward_fn) v->backward_fn(v);
+      if (t->map)
+          map_visit(t, v, &window, 1);
+      if (v->backward_fn) {
+          PROFILE_BEGIN(start);
+          v->backward_fn(v);
+          PROFILE_END(PROFILE_BACKWARD, v->opcode, start);
+      }
     }
 }
 
@@ -136,8 +607,11 @@ void tape_zero_grad(Tape *t) {
     if (!t) return;
 
     /* Iterate over nodes and set grad = 0.0 */
+    size_t window = SIZE_MAX;
     for (size_t i = 0; i < t->num_nodes; i++) {
         ValueData* v = t->nodes[i];
+        if (t->map)
+            map_visit(t, v, &window, 0);
         v->grad = 0.0;
     }
 }
@@ -174,61 +648,13 @@ void tape_print_stats(const Tape *t) {
            tape_mem_used(t) / (1024.0 * 1024.0));
 }
 
-/* GraphViz */
+/* GraphViz: the whole tape with values, through the buffered exporter */
 void tape_graphviz(Tape *t, const char *filename) {
-    /* Buffer to hold the result */
-    char dot_filename[256];
-
     /* Format: filename + ".dot" - max 256 chars (including null terminator) */
+    char dot_filename[256];
     snprintf(dot_filename, sizeof(dot_filename), "%s.dot", filename);
 
-    /* Open file */
-    FILE *file = fopen(dot_filename, "w");
-    if (file == NULL) {
-        fprintf(stderr, "Error: Could not open file %s for writing\n", dot_filename);
-        return;
-    }
-
-    fprintf(file, "digraph G {\n");
-    fprintf(file, "  rankdir=LR;\n"); // Left to right layout
-    fprintf(file, "  node [shape=record];\n");
-
-    for (size_t i = 0; i < t->num_nodes; i++) {
-        /* For any value in the graph, create a node */
-        struct ValueData *v = t->nodes[i];
-        fprintf(file, "  node_%p [label=\" %s: %f  grad: %f \"];\n", (void *)v, v->name, v->data,
-                v->grad);
-        if (v->op[0]) {
-            /* If this value is a result of an operation, create an op node */
-            fprintf(file, "  node_op_%p [label=\"%s\", shape=circle];\n", (void *)v, v->op);
-            /* Connect value node to op node */
-            fprintf(file, "  node_op_%p -> node_%p;\n", (void *)v, (void *)v);
-        }
-    }
-    
-    // Collect all edges
-    for (size_t i = 0; i < t->num_nodes; i++) {
-        struct ValueData *v = t->nodes[i];
-        if (v->num_children >= 0) {
-            for (size_t j = 0; j < v->num_children; j++) {
-                ValueData *ch = v->children[j];
-                fprintf(file, "  node_%p -> node_op_%p;\n", (void *)ch, (void *)v);
-            }
-        }
-          
-    }
-
-    fprintf(file, "}\n");
-    fclose(file);
-
-    /* System call to generate a PNG using GraphViz (if installed) */
-    char cmd[512];
-    snprintf(cmd, sizeof(cmd), "dot -V");
-    int ret = system(cmd);
-    if (ret != 0) {
-        fprintf(stderr, "Error: GraphViz command failed\n");
-    }
-
-    snprintf(cmd, sizeof(cmd), "graph-easy %s --as=png ", dot_filename);
-    system(cmd);
+    GraphExportOptions opts = graph_export_defaults();
+    opts.show_values = 1;
+    tape_export_dot(t, dot_filename, &opts);
 }
@@ -19,37 +19,147 @@ struct ValueData;
 /* Memory block for arena allocation */
 #define TAPE_BLOCK_SIZE 4096 // 4KB blocks
 
+/* Out-of-core tapes write out, drop and read ahead their mapping in windows of this size */
+#define TAPE_MAP_WINDOW (1u << 20) // 1MB, a multiple of the page size
+
 typedef struct TapeBlock {
     uint8_t data[TAPE_BLOCK_SIZE];
     size_t offset;
 } TapeBlock;
 
+/* Why an allocation on a tape failed; sticky until tape_clear */
+typedef enum TapeError {
+    TAPE_OK = 0,
+    TAPE_ERR_ARENA, // No block left (fixed or out-of-core capacity, or malloc failed)
+    TAPE_ERR_NODES, // Node index full
+    TAPE_ERR_SIZE,  // Request larger than TAPE_BLOCK_SIZE
+} TapeError;
+
+struct Tape;
+
+/* Called on every failed allocation, before the allocator returns NULL */
+typedef void (*TapeErrorFn)(struct Tape *t, TapeError err, void *ctx);
+
 typedef struct Tape {
     TapeBlock **blocks;     // Array of block pointers
     size_t num_blocks;      // Current count
     size_t blocks_capacity; // Allocated capacity in blocks
+    size_t blocks_owned;    // Heap tapes: blocks malloc'd, the first num_blocks in use
+    int retain;             // Keep the blocks across tape_clear (tape_set_retain)
 
     struct ValueData **nodes; // Array of node pointers
     size_t num_nodes;
     size_t nodes_capacity;
+
+    /* Structural hash of nodes [0, num_hashed), see tape_structure_hash */
+    uint64_t hash[2];
+    size_t num_hashed;
+
+    /* Out-of-core tapes: blocks are carved from a mapping of an unlinked file */
+    uint8_t *map;        // NULL for malloc'd blocks
+    size_t map_capacity; // Bytes mapped
+    int map_fd;
+
+    /* Fixed tapes: the tape, its index arrays and its blocks live in one region */
+    uint8_t *region;    // First block; NULL for tapes that grow
+    size_t region_size; // Bytes to munmap on destroy; 0 if the caller owns the region
+
+    /* Out-of-memory path */
+    TapeError error;
+    TapeErrorFn on_error;
+    void *error_ctx;
 } Tape;
 
 /* Tape lifecycle management */
 Tape *tape_create(void);
 void tape_destroy(Tape *t);
 
-/* Singleton accessor */
+/*
+ * Out-of-core tape: blocks are allocated from a file of `capacity` bytes
+ * created in `dir` (NULL for $TMPDIR, else /var/tmp) and removed right away,
+ * so nothing is left behind. Use a directory on disk: a tmpfs keeps the file
+ * in memory.
+ *
+ * While recording, each 1MB window of blocks is written out once the next
+ * window fills and dropped from memory one window later. tape_forward,
+ * tape_backward and tape_zero_grad walk the tape window by window, reading
+ * ahead the window they reach next (the previous one, in a reverse sweep) and
+ * writing out and dropping the ones they have left, so memory holds a few
+ * windows plus whatever nodes are referenced out of order, e.g. parameters.
+ * The node pointer array (8 bytes per node) stays in memory.
+ *
+ * tape_allocate returns NULL once the capacity is used up.
+ */
+Tape *tape_create_mapped(const char *dir, size_t capacity);
+
+/*
+ * Fixed tape: the Tape itself, the node index and every block are carved from
+ * `buf`, so recording and tape_clear never call the allocator and
+ * tape_destroy frees nothing. The block count is fixed at creation and the
+ * index is sized for the most nodes those blocks can hold. Returns NULL if
+ * `size` cannot hold a single block. The buffer must outlive the tape.
+ */
+Tape *tape_create_in(void *buf, size_t size);
+
+/* Buffer size for tape_create_in with room for at least `arena_bytes` of nodes */
+size_t tape_region_size(size_t arena_bytes);
+
+/*
+ * Fixed tape in an anonymous mapping of `size` bytes, faulted in up front and,
+ * with TAPE_REGION_LOCK, locked in memory (fails if mlock does, e.g. over
+ * RLIMIT_MEMLOCK). tape_destroy unmaps it.
+ */
+#define TAPE_REGION_LOCK (1u << 0)
+Tape *tape_create_region(size_t size, unsigned flags);
+
+/*
+ * Allocation failures on any tape record a TapeError, call the handler (if
+ * set) and make tape_allocate return NULL, which the value ops pass on as a
+ * NULL result. The handler may abort or longjmp out of the recording; the
+ * tape stays consistent either way, and tape_clear resets the error.
+ */
+void tape_set_error_handler(Tape *t, TapeErrorFn fn, void *ctx);
+TapeError tape_error(const Tape *t);
+const char *tape_error_string(TapeError err);
+
+/* Singleton accessor: every thread has its own current tape */
 Tape *tape_get_instance(void);
+Tape *tape_set_instance(Tape *t); // Returns the previous instance
 void tape_destroy_instance(void);
 
-/* Memory allocation */
+/* Memory allocation: at most TAPE_BLOCK_SIZE bytes at a time */
 void *tape_allocate(Tape *t, size_t size);
 
 /* Memory menagement */
 void tape_clear(Tape *t);
 
+/*
+ * With retain set, tape_clear keeps the blocks of a heap tape and the next
+ * recording reuses them instead of going back to malloc, for tapes that are
+ * re-recorded every step. Cleared with retain unset, the tape frees them.
+ */
+void tape_set_retain(Tape *t, int retain);
+
 /* Node management */
-void tape_register_node(Tape *t, struct ValueData *node);
+int tape_register_node(Tape *t, struct ValueData *node); // 0, or -1 if the index is full
+int tape_contains(const Tape *t, const struct ValueData *node);
+
+/*
+ * Structural hash of the recorded graph as two independent 64-bit words:
+ * opcodes, input topology by node id, fused programs, the template or segment
+ * of subgraph and checkpoint nodes, and constant values (constants are
+ * baked into compiled code), but not the values of inputs.
+ * Tapes recording the same computation on other inputs hash the same.
+ *
+ * Recording does not pay for the hash: each query folds in the nodes
+ * registered since the previous one. Passes that rewrite the node index call
+ * tape_hash_invalidate, and the next query rehashes the tape.
+ */
+void tape_structure_hash(Tape *t, uint64_t hash[2]);
+void tape_hash_invalidate(Tape *t);
+
+/* Forward replay (recompute every op node from its children) */
+void tape_forward(Tape *t);
 
 /* Backward pass */
 void tape_backward(Tape *t);
@@ -61,7 +171,7 @@ size_t tape_num_blocks(const Tape *t);
 size_t tape_mem_used(const Tape *t);
 void tape_print_stats(const Tape *t);
 
-/* GraphViz */
+/* GraphViz: writes filename.dot (see graph.h for subgraphs and collapsing) */
 void tape_graphviz(Tape *t, const char *filename);
 
 #ifdef __cplusplus
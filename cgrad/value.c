@@ -1,17 +1,28 @@
 #include "value.h"
 
+#include "checkpoint.h"
+#include "fusion.h"
+#include "profile.h"
+#include "subgraph.h"
 #include "tape.h"
 
 #include <string.h>
 
+/* Printable symbol of each opcode, indexed by ValueOp */
+static const char *const op_symbols[OP_COUNT] = {
+    [OP_NONE] = "", [OP_ADD] = "+", [OP_SUB] = "-", [OP_MUL] = "*", [OP_DIV] = "/",
+    [OP_FUSED] = "fused", [OP_CHECKPOINT] = "ckpt", [OP_SUBGRAPH] = "tmpl",
+};
+
 /* Helper function to create a ValueData in the tape */
 static ValueData *value_create_internal(Tape *t, scalar_t data, const char *name, int requires_grad,
-                                        const char *op, ValueData *child1, ValueData *child2) {
+                                        ValueOp opcode, ValueData *child1, ValueData *child2) {
 
     /* Allocate the node in the memory arena and return the pointer*/
     ValueData *v = (ValueData *)tape_allocate(t, sizeof(ValueData));
     if (!v)
         return NULL;
+    PROFILE_BEGIN(start);
 
     /* Initialize ValueData */
     v->data = data;
@@ -22,6 +33,7 @@ static ValueData *value_create_internal(Tape *t, scalar_t data, const char *name
     v->num_children = 0;
     v->children[0] = NULL;
     v->children[1] = NULL;
+    v->ctx = NULL;
 
     if (name && name[0]) {
         strncpy(v->name, name, sizeof(v->name) - 1);
@@ -31,12 +43,9 @@ static ValueData *value_create_internal(Tape *t, scalar_t data, const char *name
     }
 
     /* Copy op */
-    if (op && op[0]) {
-        strncpy(v->op, op, sizeof(v->op) - 1);
-        v->op[sizeof(v->op) - 1] = '\0';
-    } else {
-        v->op[0] = '\0';
-    }
+    v->opcode = opcode;
+    strncpy(v->op, value_op_symbol(opcode), sizeof(v->op) - 1);
+    v->op[sizeof(v->op) - 1] = '\0';
 
     /* Set children */
     if (child1) {
@@ -46,21 +55,27 @@ static ValueData *value_create_internal(Tape *t, scalar_t data, const char *name
         v->children[v->num_children++] = child2;
     }
 
-    tape_register_node(t, v);
-    return v;
+    /* A node the index has no room for is not usable for the backward pass */
+    int registered = tape_register_node(t, v);
+    PROFILE_END(PROFILE_RECORD, opcode, start);
+    return registered == 0 ? v : NULL;
 }
 
 ValueData *value_create(scalar_t data, const char *name, int requires_grad) {
     Tape *t = tape_get_instance();
-    return value_create_internal(t, data, name, requires_grad, "", NULL, NULL);
+    return value_create_internal(t, data, name, requires_grad, OP_NONE, NULL, NULL);
 }
 
 ValueData *value_create_with_tape(struct Tape *t, scalar_t data, const char *name,
                                   int requires_grad) {
-    return value_create_internal(t, data, name, requires_grad, "", NULL, NULL);
+    return value_create_internal(t, data, name, requires_grad, OP_NONE, NULL, NULL);
 }
 
 /* Accessors */
+size_t value_scalar_size(void) {
+    return sizeof(scalar_t);
+}
+
 scalar_t value_get_data(const ValueData *v) {
     return v ? v->data : 0.0;
 }
@@ -77,6 +92,41 @@ int value_requires_grad(const ValueData *v) {
     return v ? v->requires_grad : 0;
 }
 
+/* Unnamed leaves without gradient tracking (e.g. the literals created by the
+ * scalar_*_value helpers) are constants. Named leaves are inputs that may be
+ * re-fed with value_set_data before a replay. */
+int value_is_constant(const ValueData *v) {
+    return v && v->opcode == OP_NONE && !v->requires_grad && v->name[0] == '\0';
+}
+
+const char *value_op_symbol(ValueOp op) {
+    return ((unsigned)op < OP_COUNT) ? op_symbols[op] : "?";
+}
+
+int value_op_is_binary(ValueOp op) {
+    return op == OP_ADD || op == OP_SUB || op == OP_MUL || op == OP_DIV;
+}
+
+ValueData **value_inputs(const ValueData *v, size_t *count) {
+    if (!v) {
+        *count = 0;
+        return NULL;
+    }
+
+    if (v->opcode == OP_FUSED) {
+        FusedKernel *k = (FusedKernel *)v->ctx;
+        *count = k->num_inputs;
+        return k->inputs;
+    }
+    if (v->opcode == OP_CHECKPOINT)
+        return checkpoint_inputs(v, count);
+    if (v->opcode == OP_SUBGRAPH)
+        return subgraph_inputs(v, count);
+
+    *count = v->num_children;
+    return (ValueData **)v->children;
+}
+
 /* Setters */
 void value_set_data(ValueData *v, scalar_t data) {
     if (v)
@@ -135,7 +185,7 @@ ValueData *value_add(ValueData *a, ValueData *b) {
 
     Tape *t = tape_get_instance();
     int out_rg = a->requires_grad || b->requires_grad;
-    ValueData *out = value_create_internal(t, a->data + b->data, "", out_rg, "+", a, b);
+    ValueData *out = value_create_internal(t, a->data + b->data, "", out_rg, OP_ADD, a, b);
 
     if (out_rg && out) {
         out->backward_fn = backward_add;
@@ -149,7 +199,7 @@ ValueData *value_sub(ValueData *a, ValueData *b) {
     
     Tape *t = tape_get_instance();
     int out_rg = a->requires_grad || b->requires_grad;
-    ValueData *out = value_create_internal(t, a->data - b->data, "", out_rg, "-", a, b);
+    ValueData *out = value_create_internal(t, a->data - b->data, "", out_rg, OP_SUB, a, b);
     
     if (out_rg && out) {
         out->backward_fn = backward_sub;
@@ -164,7 +214,7 @@ ValueData *value_mul(ValueData *a, ValueData *b) {
 
     Tape *t = tape_get_instance();
     int out_rg = a->requires_grad || b->requires_grad;
-    ValueData *out = value_create_internal(t, a->data * b->data, "", out_rg, "*", a, b);
+    ValueData *out = value_create_internal(t, a->data * b->data, "", out_rg, OP_MUL, a, b);
 
     if (out_rg && out) {
         out->backward_fn = backward_mul;
@@ -182,7 +232,7 @@ ValueData *value_div(ValueData *a, ValueData *b) {
 
     Tape *t = tape_get_instance();
     int out_rg = a->requires_grad || b->requires_grad;
-    ValueData *out = value_create_internal(t, a->data / b->data, "", out_rg, "/", a, b);
+    ValueData *out = value_create_internal(t, a->data / b->data, "", out_rg, OP_DIV, a, b);
 
     if (out_rg && out) {
         out->backward_fn = backward_div;
@@ -199,7 +249,7 @@ ValueData *scalar_add_value(scalar_t s, ValueData *v) {
     if (!v) return NULL;
     
     Tape *t = tape_get_instance();
-    ValueData *scalar_v = value_create_internal(t, s, "", 0, "", NULL, NULL);
+    ValueData *scalar_v = value_create_internal(t, s, "", 0, OP_NONE, NULL, NULL);
     return value_add(scalar_v, v);
 }
 
@@ -207,7 +257,7 @@ ValueData *scalar_sub_value(scalar_t s, ValueData *v) {
     if (!v) return NULL;
 
     Tape *t = tape_get_instance();
-    ValueData *scalar_v = value_create_internal(t, s, "", 0, "", NULL, NULL);
+    ValueData *scalar_v = value_create_internal(t, s, "", 0, OP_NONE, NULL, NULL);
     return value_sub(scalar_v, v);
 }
 
@@ -215,18 +265,61 @@ ValueData *scalar_mul_value(scalar_t s, ValueData *v) {
     if (!v) return NULL;
 
     Tape *t = tape_get_instance();
-    ValueData *scalar_v = value_create_internal(t, s, "", 0, "", NULL, NULL);
-    return value_sub(scalar_v, v);
+    ValueData *scalar_v = value_create_internal(t, s, "", 0, OP_NONE, NULL, NULL);
+    return value_mul(scalar_v, v);
 }
 
 ValueData *scalar_div_value(scalar_t s, ValueData *v) {
     if (!v) return NULL;
 
     Tape *t = tape_get_instance();
-    ValueData *scalar_v = value_create_internal(t, s, "", 0, "", NULL, NULL);
+    ValueData *scalar_v = value_create_internal(t, s, "", 0, OP_NONE, NULL, NULL);
     return value_div(scalar_v, v);
 }
 
+/* Forward pass */
+void value_forward(ValueData *v) {
+    if (!v || v->opcode == OP_NONE)
+        return;
+
+    if (v->opcode == OP_FUSED) {
+        fused_forward(v);
+        return;
+    }
+    if (v->opcode == OP_CHECKPOINT) {
+        checkpoint_forward(v);
+        return;
+    }
+    if (v->opcode == OP_SUBGRAPH) {
+        subgraph_forward(v);
+        return;
+    }
+
+    scalar_t a = v->children[0]->data;
+    scalar_t b = v->children[1]->data;
+
+    switch (v->opcode) {
+    case OP_ADD:
+        v->data = a + b;
+        break;
+    case OP_SUB:
+        v->data = a - b;
+        break;
+    case OP_MUL:
+        v->data = a * b;
+        v->cached_a = b;
+        v->cached_b = a;
+        break;
+    case OP_DIV:
+        v->data = a / b;
+        v->cached_a = a;
+        v->cached_b = b;
+        break;
+    default:
+        break;
+    }
+}
+
 /* Backward pass */
 void value_backward(ValueData *v) {
     if (!v) return;
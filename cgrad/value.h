@@ -7,13 +7,34 @@
 extern "C" {
 #endif
 
-/* Scalar type - fixed to float32 */
+/*
+ * Scalar type - float32 by default, float64 when built with -DCGRAD_DOUBLE
+ * (make lib64). Code compiled against one variant must link the matching
+ * library; value_scalar_size() reports what the library was built with.
+ */
+#ifdef CGRAD_DOUBLE
+typedef double scalar_t;
+#else
 typedef float scalar_t;
+#endif
 
 /* Forward declarations */
 struct ValueData;
 struct Tape;
 
+/* Operation codes, one per primitive recorded on the tape */
+typedef enum ValueOp {
+    OP_NONE = 0, // Leaf (input, parameter or constant)
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_FUSED,      // Chain of elementwise ops collapsed by tape_fuse()
+    OP_CHECKPOINT, // Segment recomputed during backward (value_checkpoint)
+    OP_SUBGRAPH,   // Output of a subgraph template instance (subgraph_apply)
+    OP_COUNT
+} ValueOp;
+
 /* Backward function pointer type */
 typedef void (*BackwardFn)(struct ValueData *output);
 
@@ -23,6 +44,7 @@ typedef struct ValueData {
     scalar_t grad;
     char name[32];
     char op[8];
+    ValueOp opcode;
     int requires_grad;
 
     BackwardFn backward_fn;
@@ -34,6 +56,12 @@ typedef struct ValueData {
     // Children nodes
     struct ValueData *children[2];
     size_t num_children;
+
+    // Op-specific state (e.g. the FusedKernel of an OP_FUSED node)
+    void *ctx;
+
+    // Position on the owning tape, assigned by tape_register_node
+    size_t id;
 } ValueData;
 
 /* Value creation */
@@ -41,11 +69,20 @@ ValueData *value_create(scalar_t data, const char *name, int required_grad);
 ValueData *value_create_with_tape(struct Tape *t, scalar_t data, const char *name,
                                   int required_grad);
 
+/* sizeof(scalar_t) in the library build, to check against the header */
+size_t value_scalar_size(void);
+
 /* Value accessors */
 scalar_t value_get_data(const ValueData *v);
 scalar_t value_get_grad(const ValueData *v);
 const char *value_get_name(const ValueData *v);
 int value_requires_grad(const ValueData *v);
+int value_is_constant(const ValueData *v);
+const char *value_op_symbol(ValueOp op);
+int value_op_is_binary(ValueOp op);
+
+/* Input nodes of any op: children for binary ops, kernel inputs for fused ops, etc. */
+struct ValueData **value_inputs(const ValueData *v, size_t *count);
 
 /* Value setters */
 void value_set_data(ValueData *v, scalar_t data);
@@ -64,6 +101,9 @@ ValueData *scalar_sub_value(scalar_t s, ValueData *v);
 ValueData *scalar_mul_value(scalar_t s, ValueData *v);
 ValueData *scalar_div_value(scalar_t s, ValueData *v);
 
+/* Forward pass: recompute a node from its children (replay) */
+void value_forward(ValueData *v);
+
 /* Backward pass */
 void value_backward(ValueData *v);
 
@@ -1,7 +1,43 @@
 #include "test_binary_ops.h"
+#include "test_checkpoint.h"
+#include "test_codegen.h"
+#include "test_dataset.h"
+#include "test_distrib.h"
+#include "test_dual.h"
+#include "test_fusion.h"
+#include "test_graph.h"
+#include "test_jacobian.h"
+#include "test_memplan.h"
+#include "test_params.h"
+#include "test_passes.h"
+#include "test_pipeline.h"
+#include "test_plancache.h"
+#include "test_precision.h"
+#include "test_profile.h"
+#include "test_serialize.h"
+#include "test_subgraph.h"
+#include "test_tape.h"
 
 int main(void) {
     run_binary_ops_tests();
+    run_tape_tests();
+    run_passes_tests();
+    run_fusion_tests();
+    run_codegen_tests();
+    run_memplan_tests();
+    run_checkpoint_tests();
+    run_dual_tests();
+    run_jacobian_tests();
+    run_precision_tests();
+    run_params_tests();
+    run_serialize_tests();
+    run_dataset_tests();
+    run_profile_tests();
+    run_graph_tests();
+    run_pipeline_tests();
+    run_distrib_tests();
+    run_subgraph_tests();
+    run_plancache_tests();
 
     TEST_REPORT();
     return g_tests_failed > 0 ? 1 : 0;
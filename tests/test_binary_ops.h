@@ -223,6 +223,16 @@ void test_scalar_sub_value(void) {
     ASSERT_NEAR(value_get_grad(a), -1.0f, DEFAULT_TOL);
 }
 
+void test_scalar_mul_value(void) {
+    /* L = 5 * a  =>  dL/da = 5 */
+    ValueData *a = value_create(3.0f, "a", 1);
+    ValueData *L = scalar_mul_value(5.0f, a);
+    value_backward(L);
+
+    ASSERT_NEAR(value_get_data(L), 15.0f, DEFAULT_TOL);
+    ASSERT_NEAR(value_get_grad(a), 5.0f, DEFAULT_TOL);
+}
+
 void test_scalar_div_value(void) {
     /* L = 6 / a  =>  dL/da = -6/a^2 = -6/9 */
     ValueData *a = value_create(3.0f, "a", 1);
@@ -309,6 +319,7 @@ void run_binary_ops_tests(void) {
     TEST_SUITE("Scalar-on-Left Operations");
     RUN_TEST(test_scalar_add_value);
     RUN_TEST(test_scalar_sub_value);
+    RUN_TEST(test_scalar_mul_value);
     RUN_TEST(test_scalar_div_value);
 
     TEST_SUITE("Edge Cases");
@@ -0,0 +1,122 @@
+#ifndef CGRAD_TEST_CHECKPOINT
+#define CGRAD_TEST_CHECKPOINT
+
+#include "utils.h"
+
+/* ================================================================
+ *  Gradient checkpointing
+ * ================================================================ */
+
+typedef struct AffineStep {
+    ValueData *w;
+    ValueData *b;
+} AffineStep;
+
+/* state -> state * w + b */
+static ValueData *affine_step(ValueData *state, size_t index, void *ctx) {
+    AffineStep *p = (AffineStep *)ctx;
+    (void)index;
+    return value_add(value_mul(state, p->w), p->b);
+}
+
+void test_checkpoint_segment_len(void) {
+    ASSERT_EQ(checkpoint_segment_len(0), 1);
+    ASSERT_EQ(checkpoint_segment_len(1), 1);
+    ASSERT_EQ(checkpoint_segment_len(100), 10);
+    ASSERT_EQ(checkpoint_segment_len(101), 11);
+}
+
+void test_checkpoint_matches_full_graph(void) {
+    const size_t n = 64;
+    scalar_t ref[4];
+
+    /* Reference: the fully recorded graph */
+    {
+        ValueData *x = value_create(0.5f, "x", 1);
+        AffineStep p = {value_create(0.9f, "w", 1), value_create(0.1f, "b", 1)};
+        ValueData *y = x;
+        for (size_t i = 0; i < n; i++)
+            y = affine_step(y, i, &p);
+        value_backward(y);
+        ref[0] = value_get_data(y);
+        ref[1] = value_get_grad(x);
+        ref[2] = value_get_grad(p.w);
+        ref[3] = value_get_grad(p.b);
+        tape_clear(tape_get_instance());
+    }
+
+    Tape *t = tape_get_instance();
+    ValueData *x = value_create(0.5f, "x", 1);
+    AffineStep p = {value_create(0.9f, "w", 1), value_create(0.1f, "b", 1)};
+    ValueData *y = value_checkpoint_sequential(x, affine_step, n, CHECKPOINT_AUTO, &p);
+    ASSERT_NOT_NULL(y);
+
+    /* 3 leaves plus one node per segment of 8 steps */
+    ASSERT_EQ(tape_num_nodes(t), 3 + 8);
+
+    value_backward(y);
+    ASSERT_NEAR(value_get_data(y), ref[0], 1e-4f);
+    ASSERT_NEAR(value_get_grad(x), ref[1], 1e-4f);
+    ASSERT_NEAR(value_get_grad(p.w), ref[2], 1e-3f);
+    ASSERT_NEAR(value_get_grad(p.b), ref[3], 1e-4f);
+}
+
+void test_checkpoint_replay(void) {
+    /* y = (x * w + b) * w + b, replayed with a new input */
+    Tape *t = tape_get_instance();
+    ValueData *x = value_create(1.0f, "x", 1);
+    AffineStep p = {value_create(2.0f, "w", 1), value_create(3.0f, "b", 1)};
+    ValueData *y = value_checkpoint(x, affine_step, 0, 2, &p);
+    ASSERT_NEAR(value_get_data(y), 13.0f, DEFAULT_TOL);
+
+    value_set_data(x, 2.0f);
+    tape_forward(t);
+    ASSERT_NEAR(value_get_data(y), 17.0f, DEFAULT_TOL);
+
+    /* dy/dx = w^2, dy/dw = 2xw + b, dy/db = w + 1 */
+    value_backward(y);
+    ASSERT_NEAR(value_get_grad(x), 4.0f, DEFAULT_TOL);
+    ASSERT_NEAR(value_get_grad(p.w), 11.0f, DEFAULT_TOL);
+    ASSERT_NEAR(value_get_grad(p.b), 3.0f, DEFAULT_TOL);
+}
+
+void test_checkpoint_outer_inputs_survive_passes(void) {
+    /* The steps read w2 = w * w through their context, not through the state */
+    Tape *t = tape_get_instance();
+    ValueData *x = value_create(1.0f, "x", 1);
+    ValueData *w = value_create(2.0f, "w", 1);
+    ValueData *dup = value_mul(w, w);
+    AffineStep p = {value_mul(w, w), value_create(3.0f, "b", 1)};
+    ValueData *y = value_checkpoint(x, affine_step, 0, 2, &p);
+    ASSERT_NOT_NULL(y);
+
+    size_t count;
+    ValueData **in = value_inputs(y, &count);
+    ASSERT_EQ(count, 3);
+    ASSERT_TRUE(in[0] == x && in[1] == p.w && in[2] == p.b);
+
+    /* dup is dead and merges with w2; w2 itself must stay on the tape */
+    ASSERT_EQ(tape_optimize(t, &y, 1, PASS_ALL), 1);
+    ASSERT_TRUE(!tape_contains(t, dup));
+    ASSERT_TRUE(tape_contains(t, p.w));
+
+    /* dy/dw2 = 2 x w2 + b = 11, dy/dw = 2 w dy/dw2 */
+    value_backward(y);
+    ASSERT_NEAR(value_get_grad(x), 16.0f, DEFAULT_TOL);
+    ASSERT_NEAR(value_get_grad(w), 44.0f, DEFAULT_TOL);
+    ASSERT_NEAR(value_get_grad(p.b), 5.0f, DEFAULT_TOL);
+}
+
+/* ================================================================
+ *  Suite runner
+ * ================================================================ */
+
+void run_checkpoint_tests(void) {
+    TEST_SUITE("Gradient Checkpointing");
+    RUN_TEST(test_checkpoint_segment_len);
+    RUN_TEST(test_checkpoint_matches_full_graph);
+    RUN_TEST(test_checkpoint_replay);
+    RUN_TEST(test_checkpoint_outer_inputs_survive_passes);
+}
+
+#endif /* CGRAD_TEST_CHECKPOINT */
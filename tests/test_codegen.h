@@ -0,0 +1,121 @@
+#ifndef CGRAD_TEST_CODEGEN
+#define CGRAD_TEST_CODEGEN
+
+#include "utils.h"
+
+/* ================================================================
+ *  Code generation and compile-and-load
+ * ================================================================ */
+
+void test_codegen_emits_source(void) {
+    Tape *t = tape_get_instance();
+    ValueData *a = value_create(2.0f, "a", 1);
+    ValueData *L = scalar_add_value(3.0f, value_mul(a, a));
+
+    char buf[2048] = {0};
+    FILE *mem = fmemopen(buf, sizeof(buf) - 1, "w");
+    ASSERT_EQ(tape_codegen(t, mem), 0);
+    fclose(mem);
+
+    ASSERT_TRUE(strstr(buf, "void cgrad_forward(scalar_t *v)") != NULL);
+    ASSERT_TRUE(strstr(buf, "void cgrad_backward(const scalar_t *v, scalar_t *g)") != NULL);
+    ASSERT_TRUE(strstr(buf, "v[1] = v[0] * v[0];") != NULL);
+    /* The literal 3 is baked in rather than read from v[] */
+    ASSERT_TRUE(strstr(buf, "((scalar_t)3) + v[1]") != NULL);
+    (void)L;
+}
+
+void test_compiled_matches_interpreter(void) {
+    /* L = (a * b) / c - f + 3.4 */
+    Tape *t = tape_get_instance();
+    ValueData *a = value_create(2.0f, "a", 1);
+    ValueData *b = value_create(-3.0f, "b", 1);
+    ValueData *c = value_create(10.0f, "c", 1);
+    ValueData *f = value_create(-2.0f, "f", 1);
+    ValueData *L = scalar_add_value(3.4f, value_sub(value_div(value_mul(a, b), c), f));
+
+    CompiledTape *ct = tape_compile(t);
+    ASSERT_NOT_NULL(ct);
+    if (!ct)
+        return;
+
+    value_set_data(a, 1.5f);
+    compiled_tape_forward(ct, t);
+    compiled_tape_backward(ct, L);
+
+    tape_forward(t);
+    value_backward(L);
+
+    ASSERT_NEAR(compiled_tape_data(ct, L), value_get_data(L), DEFAULT_TOL);
+    ASSERT_NEAR(compiled_tape_grad(ct, a), value_get_grad(a), DEFAULT_TOL);
+    ASSERT_NEAR(compiled_tape_grad(ct, b), value_get_grad(b), DEFAULT_TOL);
+    ASSERT_NEAR(compiled_tape_grad(ct, c), value_get_grad(c), DEFAULT_TOL);
+    ASSERT_NEAR(compiled_tape_grad(ct, f), value_get_grad(f), DEFAULT_TOL);
+    compiled_tape_destroy(ct);
+}
+
+void test_compiled_fused_kernel(void) {
+    /* L = ((a * b) + c) * f after fusion */
+    Tape *t = tape_get_instance();
+    ValueData *a = value_create(2.0f, "a", 1);
+    ValueData *b = value_create(-3.0f, "b", 1);
+    ValueData *c = value_create(10.0f, "c", 1);
+    ValueData *f = value_create(-2.0f, "f", 1);
+    ValueData *L = value_mul(value_add(value_mul(a, b), c), f);
+    tape_fuse(t, &L, 1);
+
+    CompiledTape *ct = tape_compile(t);
+    ASSERT_NOT_NULL(ct);
+    if (!ct)
+        return;
+
+    compiled_tape_forward(ct, t);
+    compiled_tape_backward(ct, L);
+    ASSERT_NEAR(compiled_tape_data(ct, L), -8.0f, DEFAULT_TOL);
+    ASSERT_NEAR(compiled_tape_grad(ct, a), 6.0f, DEFAULT_TOL);
+    ASSERT_NEAR(compiled_tape_grad(ct, b), -4.0f, DEFAULT_TOL);
+    ASSERT_NEAR(compiled_tape_grad(ct, c), -2.0f, DEFAULT_TOL);
+    ASSERT_NEAR(compiled_tape_grad(ct, f), 4.0f, DEFAULT_TOL);
+    compiled_tape_destroy(ct);
+}
+
+void test_compiled_nonfinite_constant(void) {
+    /* L = a * inf + a, built with $CC carrying its own arguments */
+    Tape *t = tape_get_instance();
+    ValueData *a = value_create(2.0f, "a", 1);
+    ValueData *L = value_add(scalar_mul_value((scalar_t)INFINITY, a), a);
+
+    char buf[2048] = {0};
+    FILE *mem = fmemopen(buf, sizeof(buf) - 1, "w");
+    ASSERT_EQ(tape_codegen(t, mem), 0);
+    fclose(mem);
+    ASSERT_TRUE(strstr(buf, "((scalar_t)INFINITY)") != NULL);
+
+    const char *cc = getenv("CC");
+    char *saved = cc ? strdup(cc) : NULL;
+    setenv("CC", "cc -w", 1);
+    CompiledTape *ct = tape_compile(t);
+    if (saved)
+        setenv("CC", saved, 1);
+    else
+        unsetenv("CC");
+    free(saved);
+
+    ASSERT_NOT_NULL(ct);
+    compiled_tape_destroy(ct);
+    (void)L;
+}
+
+/* ================================================================
+ *  Suite runner
+ * ================================================================ */
+
+void run_codegen_tests(void) {
+    TEST_SUITE("Code Generation");
+    RUN_TEST(test_codegen_emits_source);
+    RUN_TEST(test_compiled_matches_interpreter);
+    RUN_TEST(test_compiled_fused_kernel);
+    RUN_TEST(test_compiled_nonfinite_constant);
+}
+
+#endif /* CGRAD_TEST_CODEGEN */
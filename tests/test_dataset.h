@@ -0,0 +1,217 @@
+#ifndef CGRAD_TEST_DATASET
+#define CGRAD_TEST_DATASET
+
+#include "utils.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+/* ================================================================
+ *  Dataset files
+ * ================================================================ */
+
+/* Writes text to a fresh temporary file and stores its name in path */
+static void dataset_temp_file(char *path, size_t size, const char *text) {
+    snprintf(path, size, "/tmp/cgrad_data_XXXXXX");
+    int fd = mkstemp(path);
+    if (fd < 0)
+        return;
+    if (text && write(fd, text, strlen(text)) < 0)
+        path[0] = '\0';
+    close(fd);
+}
+
+void test_dataset_binary_roundtrip(void) {
+    scalar_t rows[12];
+    for (int i = 0; i < 12; i++)
+        rows[i] = (scalar_t)i * 0.5f;
+
+    char path[64];
+    dataset_temp_file(path, sizeof(path), NULL);
+    ASSERT_EQ(dataset_write_binary(path, rows, 4, 3), 0);
+    Dataset *ds = dataset_open(path);
+    unlink(path);
+    ASSERT_NOT_NULL(ds);
+    if (!ds)
+        return;
+
+    ASSERT_EQ(ds->num_rows, 4);
+    ASSERT_EQ(ds->num_cols, 3);
+    ASSERT_NEAR(dataset_row(ds, 2)[1], 3.5f, DEFAULT_TOL);
+
+    scalar_t out[9];
+    ASSERT_EQ(dataset_gather(ds, 2, 3, out), 2); // Clipped at the end
+    ASSERT_NEAR(out[5], 5.5f, DEFAULT_TOL);
+    dataset_close(ds);
+}
+
+void test_dataset_csv(void) {
+    char path[64], bin[64];
+    dataset_temp_file(path, sizeof(path),
+                      "x,y,label\n1, 2.5 ,-3\r\n-0.125,1e3,+4E-2\n\n7,8,9\n");
+    Dataset *ds = dataset_load_csv(path, 1);
+    ASSERT_NOT_NULL(ds);
+    if (!ds)
+        return;
+    ASSERT_EQ(ds->num_rows, 3);
+    ASSERT_EQ(ds->num_cols, 3);
+    ASSERT_NEAR(dataset_row(ds, 0)[1], 2.5f, DEFAULT_TOL);
+    ASSERT_NEAR(dataset_row(ds, 1)[0], -0.125f, DEFAULT_TOL);
+    ASSERT_NEAR(dataset_row(ds, 1)[1], 1000.0f, DEFAULT_TOL);
+    ASSERT_NEAR(dataset_row(ds, 1)[2], 0.04f, DEFAULT_TOL);
+
+    /* Streaming conversion gives the same rows, mapped */
+    dataset_temp_file(bin, sizeof(bin), NULL);
+    ASSERT_EQ(dataset_convert_csv(path, bin, 1), 0);
+    Dataset *mapped = dataset_open(bin);
+    ASSERT_NOT_NULL(mapped);
+    if (mapped) {
+        ASSERT_EQ(mapped->num_rows, 3);
+        for (size_t i = 0; i < 9; i++)
+            ASSERT_NEAR(mapped->data[i], ds->data[i], DEFAULT_TOL);
+        dataset_close(mapped);
+    }
+    dataset_close(ds);
+    unlink(bin);
+    unlink(path);
+
+    /* Ragged rows and garbage are rejected */
+    dataset_temp_file(path, sizeof(path), "1,2\n3\n");
+    ASSERT_TRUE(dataset_load_csv(path, 0) == NULL);
+    unlink(path);
+    dataset_temp_file(path, sizeof(path), "1,abc\n");
+    ASSERT_TRUE(dataset_load_csv(path, 0) == NULL);
+    unlink(path);
+}
+
+void test_dataset_shuffle_is_permutation(void) {
+    enum { N = 100 };
+    scalar_t rows[N];
+    for (int i = 0; i < N; i++)
+        rows[i] = (scalar_t)i;
+
+    char path[64];
+    dataset_temp_file(path, sizeof(path), NULL);
+    dataset_write_binary(path, rows, N, 1);
+    Dataset *a = dataset_open(path);
+    Dataset *b = dataset_open(path);
+    unlink(path);
+    if (!a || !b) {
+        ASSERT_TRUE(0);
+        return;
+    }
+
+    dataset_shuffle(a, 42);
+    dataset_shuffle(b, 42);
+    int seen[N] = {0}, same = 1, moved = 0;
+    for (size_t i = 0; i < N; i++) {
+        seen[a->order[i]]++;
+        same &= a->order[i] == b->order[i];
+        moved += a->order[i] != i;
+    }
+    for (int i = 0; i < N; i++)
+        ASSERT_EQ(seen[i], 1);
+    ASSERT_TRUE(same);
+    ASSERT_TRUE(moved > N / 2);
+    dataset_close(a);
+    dataset_close(b);
+}
+
+/* ================================================================
+ *  Batched loading
+ * ================================================================ */
+
+/* Sum of all values seen in one epoch, checking the batch sizes */
+static scalar_t loader_epoch_sum(DataLoader *dl, size_t batch_size, size_t *batches) {
+    scalar_t sum = 0.0f;
+    const scalar_t *batch;
+    size_t rows;
+    *batches = 0;
+    while ((batch = dataloader_next(dl, &rows)) != NULL) {
+        ASSERT_TRUE(rows > 0 && rows <= batch_size);
+        for (size_t i = 0; i < rows * 2; i++)
+            sum += batch[i];
+        (*batches)++;
+    }
+    return sum;
+}
+
+void test_dataloader_prefetch(void) {
+    enum { N = 1003 };
+    scalar_t *rows = (scalar_t *)malloc(sizeof(scalar_t) * N * 2);
+    for (int i = 0; i < N; i++) {
+        rows[2 * i] = (scalar_t)i;
+        rows[2 * i + 1] = 1.0f;
+    }
+    char path[64];
+    dataset_temp_file(path, sizeof(path), NULL);
+    dataset_write_binary(path, rows, N, 2);
+    free(rows);
+    Dataset *ds = dataset_open(path);
+    unlink(path);
+    if (!ds) {
+        ASSERT_TRUE(0);
+        return;
+    }
+
+    const scalar_t expected = (scalar_t)(N * (N - 1) / 2 + N);
+    size_t batches;
+    for (int prefetch = 0; prefetch <= 1; prefetch++) {
+        DataLoader *dl = dataloader_create(ds, 64, 1, 7, prefetch);
+        ASSERT_NOT_NULL(dl);
+        for (int epoch = 0; epoch < 3; epoch++) {
+            ASSERT_NEAR(loader_epoch_sum(dl, 64, &batches), expected, 1.0f);
+            ASSERT_EQ(batches, (N + 63) / 64);
+            dataloader_reset(dl);
+        }
+        dataloader_destroy(dl);
+    }
+    dataset_close(ds);
+}
+
+void test_dataloader_fills_leaves(void) {
+    scalar_t rows[] = {1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f};
+    char path[64];
+    dataset_temp_file(path, sizeof(path), NULL);
+    dataset_write_binary(path, rows, 3, 2);
+    Dataset *ds = dataset_open(path);
+    unlink(path);
+    if (!ds) {
+        ASSERT_TRUE(0);
+        return;
+    }
+
+    /* Batch of 2 rows x 2 columns feeding y = sum of x * w */
+    ValueData *x[4], *w = value_create(2.0f, "w", 1);
+    ValueData *y = value_create(0.0f, NULL, 0);
+    for (int i = 0; i < 4; i++) {
+        x[i] = value_create(0.0f, "x", 0);
+        y = value_add(y, value_mul(x[i], w));
+    }
+
+    DataLoader *dl = dataloader_create(ds, 2, 0, 0, 1);
+    ASSERT_EQ(dataloader_next_leaves(dl, x), 2);
+    tape_forward(tape_get_instance());
+    ASSERT_NEAR(value_get_data(y), 20.0f, DEFAULT_TOL);
+    ASSERT_EQ(dataloader_next_leaves(dl, x), 1);
+    ASSERT_NEAR(value_get_data(x[1]), 6.0f, DEFAULT_TOL);
+    ASSERT_EQ(dataloader_next_leaves(dl, x), 0);
+
+    dataloader_destroy(dl);
+    dataset_close(ds);
+}
+
+/* ================================================================
+ *  Suite runner
+ * ================================================================ */
+
+void run_dataset_tests(void) {
+    TEST_SUITE("Datasets");
+    RUN_TEST(test_dataset_binary_roundtrip);
+    RUN_TEST(test_dataset_csv);
+    RUN_TEST(test_dataset_shuffle_is_permutation);
+    RUN_TEST(test_dataloader_prefetch);
+    RUN_TEST(test_dataloader_fills_leaves);
+}
+
+#endif /* CGRAD_TEST_DATASET */
@@ -0,0 +1,182 @@
+#ifndef CGRAD_TEST_DISTRIB
+#define CGRAD_TEST_DISTRIB
+
+#include "utils.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+ * Worker processes cannot report through the test counters: they check their
+ * own results and leave with a non-zero status on failure, which rank 0 sees
+ * as dist_finish() returning -1.
+ */
+
+/* ================================================================
+ *  All-reduce
+ * ================================================================ */
+
+void test_allreduce_sums_gradients(void) {
+    const int workers = 4;
+    const size_t n = 1001; // Not a multiple of the number of chunks
+    ParamStore *s = param_store_create(n);
+    for (size_t i = 0; i < n; i++)
+        param_store_add(s, 0.0f);
+
+    DistGroup *g = dist_fork(workers, n);
+    ASSERT_NOT_NULL(g);
+    if (!g) {
+        param_store_destroy(s);
+        return;
+    }
+    int rank = dist_rank(g);
+    int ok = dist_size(g) == workers;
+
+    for (int round = 0; round < 3; round++) {
+        for (size_t i = 0; i < n; i++)
+            s->grad[i] = (scalar_t)(rank + 1) * (scalar_t)(i % 7 + round);
+        ok &= dist_allreduce_grad(g, s, round == 2) == 0;
+
+        /* 1 + 2 + 3 + 4 = 10 */
+        for (size_t i = 0; i < n; i++) {
+            scalar_t expected = 10.0f * (scalar_t)(i % 7 + round);
+            if (round == 2)
+                expected /= (scalar_t)workers;
+            ok &= fabs(s->grad[i] - expected) < 1e-4f;
+        }
+    }
+
+    ASSERT_TRUE(ok);
+    ASSERT_EQ(dist_finish(g, ok ? 0 : 1), 0); // Children exit here
+    param_store_destroy(s);
+}
+
+/* ================================================================
+ *  Data-parallel training
+ * ================================================================ */
+
+/* Shard of a line fit: this worker's samples x = rank, rank + W, ... < 8 */
+static void shard_gradient(ParamStore *s, int rank, int workers) {
+    Tape *t = tape_get_instance();
+    ValueData *loss = value_create(0.0f, NULL, 0);
+    for (int x = rank; x < 8; x += workers) {
+        ValueData *pred = value_add(scalar_mul_value((scalar_t)x, param_bind(s, 0)),
+                                    param_bind(s, 1));
+        ValueData *err = value_sub(pred, value_create(2.0f * (scalar_t)x + 1.0f, NULL, 0));
+        loss = value_add(loss, value_mul(err, err));
+    }
+    value_backward(loss);
+    tape_clear(t);
+}
+
+void test_data_parallel_matches_full_batch(void) {
+    const int workers = 3;
+    ParamStore *s = param_store_create(2);
+    param_store_add(s, 0.0f);
+    param_store_add(s, 0.0f);
+    Optimizer opt = optimizer_sgd(0.005f, 0.0f);
+
+    DistGroup *g = dist_fork(workers, 2);
+    ASSERT_NOT_NULL(g);
+    if (!g) {
+        param_store_destroy(s);
+        return;
+    }
+    int rank = dist_rank(g);
+
+    /* Ranks 1 and 2 start from different values: the broadcast aligns them */
+    if (rank != 0)
+        s->data[0] = 42.0f;
+    int ok = dist_broadcast_params(g, s, 0) == 0;
+    for (int step = 0; step < 50; step++) {
+        param_store_zero_grad(s);
+        shard_gradient(s, rank, workers);
+        ok &= dist_allreduce_grad(g, s, 0) == 0;
+        param_store_step(s, &opt);
+    }
+
+    /* Same steps on the whole batch in one process */
+    ParamStore *ref = param_store_create(2);
+    param_store_add(ref, 0.0f);
+    param_store_add(ref, 0.0f);
+    for (int step = 0; step < 50; step++) {
+        param_store_zero_grad(ref);
+        shard_gradient(ref, 0, 1);
+        param_store_step(ref, &opt);
+    }
+    ok &= fabs(s->data[0] - ref->data[0]) < 1e-4f && fabs(s->data[1] - ref->data[1]) < 1e-4f;
+    param_store_destroy(ref);
+
+    ASSERT_TRUE(ok);
+    ASSERT_EQ(dist_finish(g, ok ? 0 : 1), 0);
+    ASSERT_NEAR(s->data[0], 2.0f, 0.2f);
+    param_store_destroy(s);
+}
+
+void test_dist_create_and_join(void) {
+    /* Named segment, joined by a process that dist_fork did not start */
+    const char *name = "/cgrad-test-join";
+    DistGroup *g = dist_create(name, 2, 16);
+    ASSERT_NOT_NULL(g);
+    if (!g)
+        return;
+    ASSERT_TRUE(dist_create(name, 2, 16) == NULL); // Name already taken
+    ASSERT_TRUE(dist_join(name, 2) == NULL);       // Rank out of range
+
+    /* A segment rank 0 has opened but not sized yet: retry later, no SIGBUS */
+    int fd = shm_open("/cgrad-test-unsized", O_CREAT | O_EXCL | O_RDWR, 0600);
+    ASSERT_TRUE(fd >= 0);
+    ASSERT_TRUE(dist_join("/cgrad-test-unsized", 1) == NULL);
+    close(fd);
+    shm_unlink("/cgrad-test-unsized");
+
+    ParamStore *s = param_store_create(16);
+    for (int i = 0; i < 16; i++)
+        param_store_add(s, 0.0f);
+
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid == 0) {
+        DistGroup *peer = dist_join(name, 1);
+        int ok = peer && dist_rank(peer) == 1 && dist_size(peer) == 2;
+        if (peer) {
+            for (int i = 0; i < 16; i++)
+                s->grad[i] = 2.0f;
+            ok &= dist_allreduce_grad(peer, s, 0) == 0 && s->grad[15] == 3.0f;
+            dist_finish(peer, 0);
+        }
+        _exit(ok ? 0 : 1);
+    }
+
+    for (int i = 0; i < 16; i++)
+        s->grad[i] = 1.0f;
+    ASSERT_EQ(dist_allreduce_grad(g, s, 0), 0);
+    ASSERT_NEAR(s->grad[0], 3.0f, 1e-6f);
+
+    ParamStore *wrong = param_store_create(4);
+    param_store_add(wrong, 1.0f);
+    ASSERT_EQ(dist_allreduce_grad(g, wrong, 0), -1); // Store does not match the group
+    param_store_destroy(wrong);
+
+    ASSERT_EQ(dist_finish(g, 0), 0);
+    int status = 1;
+    waitpid(pid, &status, 0);
+    ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    ASSERT_TRUE(dist_join(name, 1) == NULL); // Removed by rank 0
+    param_store_destroy(s);
+}
+
+/* ================================================================
+ *  Suite runner
+ * ================================================================ */
+
+void run_distrib_tests(void) {
+    TEST_SUITE("Multi-Process");
+    RUN_TEST(test_allreduce_sums_gradients);
+    RUN_TEST(test_data_parallel_matches_full_batch);
+    RUN_TEST(test_dist_create_and_join);
+}
+
+#endif /* CGRAD_TEST_DISTRIB */
@@ -0,0 +1,147 @@
+#ifndef CGRAD_TEST_DUAL
+#define CGRAD_TEST_DUAL
+
+#include "utils.h"
+
+/* ================================================================
+ *  Forward mode: dual numbers
+ * ================================================================ */
+
+void test_dual_ops(void) {
+    Dual a = dual_make(3.0f, 1.0f);
+    Dual b = dual_make(-2.0f, 0.5f);
+
+    Dual s = dual_add(a, b);
+    ASSERT_NEAR(s.val, 1.0f, DEFAULT_TOL);
+    ASSERT_NEAR(s.tan, 1.5f, DEFAULT_TOL);
+
+    Dual d = dual_sub(a, b);
+    ASSERT_NEAR(d.val, 5.0f, DEFAULT_TOL);
+    ASSERT_NEAR(d.tan, 0.5f, DEFAULT_TOL);
+
+    /* (ab)' = a'b + ab' = -2 + 1.5 */
+    Dual m = dual_mul(a, b);
+    ASSERT_NEAR(m.val, -6.0f, DEFAULT_TOL);
+    ASSERT_NEAR(m.tan, -0.5f, DEFAULT_TOL);
+
+    /* (a/b)' = (a'b - ab') / b^2 = (-2 - 1.5) / 4 */
+    Dual q = dual_div(a, b);
+    ASSERT_NEAR(q.val, -1.5f, DEFAULT_TOL);
+    ASSERT_NEAR(q.tan, -0.875f, DEFAULT_TOL);
+}
+
+void test_dual_derivative(void) {
+    /* f(x) = (x * x + 3) / x  =>  f'(x) = 1 - 3 / x^2 */
+    Dual x = dual_make(2.0f, 1.0f);
+    Dual f = dual_div(scalar_add_dual(3.0f, dual_mul(x, x)), x);
+    ASSERT_NEAR(f.val, 3.5f, DEFAULT_TOL);
+    ASSERT_NEAR(f.tan, 0.25f, DEFAULT_TOL);
+
+    Dual g = scalar_sub_dual(1.0f, scalar_mul_dual(4.0f, scalar_div_dual(2.0f, x)));
+    /* g(x) = 1 - 8 / x  =>  g'(x) = 8 / x^2 */
+    ASSERT_NEAR(g.val, -3.0f, DEFAULT_TOL);
+    ASSERT_NEAR(g.tan, 2.0f, DEFAULT_TOL);
+}
+
+/* ================================================================
+ *  Forward mode: tangent sweep over a tape
+ * ================================================================ */
+
+void test_jvp_matches_backward(void) {
+    /* L = (a * b) / c - f, directional derivative along v = (1, 2, -1, 0.5) */
+    Tape *t = tape_get_instance();
+    ValueData *a = value_create(2.0f, "a", 1);
+    ValueData *b = value_create(-3.0f, "b", 1);
+    ValueData *c = value_create(10.0f, "c", 1);
+    ValueData *f = value_create(-2.0f, "f", 1);
+    ValueData *L = value_sub(value_div(value_mul(a, b), c), f);
+
+    ValueData *inputs[] = {a, b, c, f};
+    scalar_t dir[] = {1.0f, 2.0f, -1.0f, 0.5f};
+    scalar_t jvp = 0.0f;
+    ASSERT_EQ(tape_jvp(t, inputs, dir, 4, &L, &jvp, 1), 0);
+
+    value_backward(L);
+    scalar_t expected = 0.0f;
+    for (int i = 0; i < 4; i++)
+        expected += value_get_grad(inputs[i]) * dir[i];
+    ASSERT_NEAR(jvp, expected, DEFAULT_TOL);
+}
+
+void test_jvp_many_outputs(void) {
+    /* y_k = x * k + x * x for k = 0..9, dy_k/dx = k + 2x */
+    Tape *t = tape_get_instance();
+    ValueData *x = value_create(1.5f, "x", 1);
+    ValueData *ys[10];
+    for (int k = 0; k < 10; k++)
+        ys[k] = value_add(scalar_mul_value((scalar_t)k, x), value_mul(x, x));
+    tape_fuse(t, ys, 10);
+
+    scalar_t one = 1.0f;
+    scalar_t dy[10];
+    ASSERT_EQ(tape_jvp(t, &x, &one, 1, ys, dy, 10), 0);
+    for (int k = 0; k < 10; k++)
+        ASSERT_NEAR(dy[k], (scalar_t)k + 3.0f, DEFAULT_TOL);
+}
+
+/* ================================================================
+ *  Hessian-vector products (forward-over-reverse)
+ * ================================================================ */
+
+/* f(x, y) = x * x * y + y / x
+ * H = [[2y + 2y/x^3, 2x - 1/x^2], [2x - 1/x^2, 0]]
+ * At x = 2, y = 3: H = [[6.75, 3.75], [3.75, 0]] */
+static ValueData *hvp_objective(ValueData *x, ValueData *y) {
+    return value_add(value_mul(value_mul(x, x), y), value_div(y, x));
+}
+
+void test_hvp(void) {
+    Tape *t = tape_get_instance();
+    ValueData *x = value_create(2.0f, "x", 1);
+    ValueData *y = value_create(3.0f, "y", 1);
+    ValueData *f = hvp_objective(x, y);
+
+    ValueData *params[] = {x, y};
+    scalar_t v[] = {1.0f, 2.0f};
+    scalar_t hv[2], grad[2];
+    ASSERT_EQ(tape_hvp(t, f, params, v, 2, hv, grad), 0);
+
+    ASSERT_NEAR(hv[0], 6.75f + 2.0f * 3.75f, 1e-4f);
+    ASSERT_NEAR(hv[1], 3.75f, 1e-4f);
+
+    /* df/dx = 2xy - y/x^2, df/dy = x^2 + 1/x */
+    ASSERT_NEAR(grad[0], 12.0f - 0.75f, 1e-4f);
+    ASSERT_NEAR(grad[1], 4.5f, 1e-4f);
+}
+
+void test_hvp_fused(void) {
+    Tape *t = tape_get_instance();
+    ValueData *x = value_create(2.0f, "x", 1);
+    ValueData *y = value_create(3.0f, "y", 1);
+    ValueData *f = hvp_objective(x, y);
+    tape_fuse(t, &f, 1);
+    ASSERT_TRUE(f->opcode == OP_FUSED);
+
+    ValueData *params[] = {x, y};
+    scalar_t v[] = {0.0f, 1.0f};
+    scalar_t hv[2];
+    ASSERT_EQ(tape_hvp(t, f, params, v, 2, hv, NULL), 0);
+    ASSERT_NEAR(hv[0], 3.75f, 1e-4f);
+    ASSERT_NEAR(hv[1], 0.0f, 1e-4f);
+}
+
+/* ================================================================
+ *  Suite runner
+ * ================================================================ */
+
+void run_dual_tests(void) {
+    TEST_SUITE("Forward Mode");
+    RUN_TEST(test_dual_ops);
+    RUN_TEST(test_dual_derivative);
+    RUN_TEST(test_jvp_matches_backward);
+    RUN_TEST(test_jvp_many_outputs);
+    RUN_TEST(test_hvp);
+    RUN_TEST(test_hvp_fused);
+}
+
+#endif /* CGRAD_TEST_DUAL */
@@ -0,0 +1,97 @@
+#ifndef CGRAD_TEST_FUSION
+#define CGRAD_TEST_FUSION
+
+#include "utils.h"
+
+/* ================================================================
+ *  Elementwise op fusion
+ * ================================================================ */
+
+void test_fuse_chain(void) {
+    /* L = ((a * b) + c) * f collapses into a single fused node */
+    Tape *t = tape_get_instance();
+    ValueData *a = value_create(2.0f, "a", 1);
+    ValueData *b = value_create(-3.0f, "b", 1);
+    ValueData *c = value_create(10.0f, "c", 1);
+    ValueData *f = value_create(-2.0f, "f", 1);
+    ValueData *L = value_mul(value_add(value_mul(a, b), c), f);
+
+    size_t removed = tape_fuse(t, &L, 1);
+    ASSERT_EQ(removed, 2);
+    ASSERT_EQ(tape_num_nodes(t), 5);
+    ASSERT_TRUE(L->opcode == OP_FUSED);
+
+    value_backward(L);
+    ASSERT_NEAR(value_get_data(L), -8.0f, DEFAULT_TOL);
+    ASSERT_NEAR(value_get_grad(a), 6.0f, DEFAULT_TOL);
+    ASSERT_NEAR(value_get_grad(b), -4.0f, DEFAULT_TOL);
+    ASSERT_NEAR(value_get_grad(c), -2.0f, DEFAULT_TOL);
+    ASSERT_NEAR(value_get_grad(f), 4.0f, DEFAULT_TOL);
+}
+
+void test_fuse_replay(void) {
+    /* L = (a * b) / c - a, replayed after fusion */
+    Tape *t = tape_get_instance();
+    ValueData *a = value_create(2.0f, "a", 1);
+    ValueData *b = value_create(-3.0f, "b", 1);
+    ValueData *c = value_create(10.0f, "c", 1);
+    ValueData *L = value_sub(value_div(value_mul(a, b), c), a);
+
+    tape_fuse(t, &L, 1);
+    value_set_data(a, 1.0f);
+    value_set_data(b, 4.0f);
+    value_set_data(c, 2.0f);
+    tape_forward(t);
+    tape_zero_grad(t);
+    value_backward(L);
+
+    ASSERT_NEAR(value_get_data(L), 1.0f, DEFAULT_TOL);
+    ASSERT_NEAR(value_get_grad(a), 1.0f, DEFAULT_TOL);
+    ASSERT_NEAR(value_get_grad(b), 0.5f, DEFAULT_TOL);
+    ASSERT_NEAR(value_get_grad(c), -1.0f, DEFAULT_TOL);
+}
+
+void test_fuse_skips_shared_intermediate(void) {
+    /* e has two consumers, so it must stay materialized */
+    Tape *t = tape_get_instance();
+    ValueData *a = value_create(3.0f, "a", 1);
+    ValueData *e = value_add(a, a);
+    ValueData *L = value_mul(e, e);
+
+    ASSERT_EQ(tape_fuse(t, &L, 1), 0);
+    value_backward(L);
+    ASSERT_NEAR(value_get_grad(a), 24.0f, DEFAULT_TOL);
+}
+
+void test_fuse_keeps_outputs(void) {
+    Tape *t = tape_get_instance();
+    ValueData *a = value_create(2.0f, "a", 1);
+    ValueData *b = value_create(5.0f, "b", 1);
+    ValueData *d = value_add(value_mul(a, b), b);
+    ValueData *L = value_mul(d, a);
+    ValueData *outputs[] = {d, L};
+
+    tape_fuse(t, outputs, 2);
+    ASSERT_TRUE(tape_contains(t, d));
+    ASSERT_TRUE(d->opcode == OP_FUSED);
+    ASSERT_TRUE(L->opcode == OP_MUL);
+
+    value_backward(L);
+    /* L = (a*b + b) * a  =>  dL/da = 2ab + b = 25, dL/db = a^2 + a = 6 */
+    ASSERT_NEAR(value_get_grad(a), 25.0f, DEFAULT_TOL);
+    ASSERT_NEAR(value_get_grad(b), 6.0f, DEFAULT_TOL);
+}
+
+/* ================================================================
+ *  Suite runner
+ * ================================================================ */
+
+void run_fusion_tests(void) {
+    TEST_SUITE("Op Fusion");
+    RUN_TEST(test_fuse_chain);
+    RUN_TEST(test_fuse_replay);
+    RUN_TEST(test_fuse_skips_shared_intermediate);
+    RUN_TEST(test_fuse_keeps_outputs);
+}
+
+#endif /* CGRAD_TEST_FUSION */
@@ -0,0 +1,160 @@
+#ifndef CGRAD_TEST_GRAPH
+#define CGRAD_TEST_GRAPH
+
+#include "utils.h"
+
+#define GRAPH_TEST_PATH "/tmp/cgrad_test_graph.dot"
+
+/* Read the exported file back; the caller frees it */
+static char *read_export(void) {
+    FILE *f = fopen(GRAPH_TEST_PATH, "rb");
+    if (!f)
+        return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = (char *)malloc((size_t)size + 1);
+    size_t len = fread(buf, 1, (size_t)size, f);
+    buf[len] = '\0';
+    fclose(f);
+    remove(GRAPH_TEST_PATH);
+    return buf;
+}
+
+static size_t count_lines_with(const char *s, const char *needle) {
+    size_t n = 0;
+    const char *line = s;
+    while (line && *line) {
+        const char *end = strchr(line, '\n');
+        const char *hit = strstr(line, needle);
+        n += hit && (!end || hit < end);
+        line = end ? end + 1 : NULL;
+    }
+    return n;
+}
+
+/* Node statements: every "  n<id> ..." line that is not an edge */
+static size_t count_nodes(const char *dot) {
+    return count_lines_with(dot, "  n") - count_lines_with(dot, "->");
+}
+
+/* y = x; steps times: y = y * w + b */
+static ValueData *graph_chain(int steps) {
+    ValueData *w = value_create(0.5f, "w", 1);
+    ValueData *b = value_create(0.25f, "b", 1);
+    ValueData *y = value_create(1.0f, "x", 1);
+    for (int i = 0; i < steps; i++)
+        y = value_add(value_mul(y, w), b);
+    return y;
+}
+
+/* ================================================================
+ *  DOT export
+ * ================================================================ */
+
+void test_export_whole_tape_stable_ids(void) {
+    Tape *t = tape_get_instance();
+    ValueData *a = value_create(2.0f, "a", 1);
+    ValueData *b = value_create(3.0f, "b", 1);
+    ValueData *c = value_mul(a, b);
+    value_set_name(c, "c\"quoted");
+
+    ASSERT_EQ(tape_export_dot(t, GRAPH_TEST_PATH, NULL), 0);
+    char *dot = read_export();
+    ASSERT_NOT_NULL(dot);
+    /* Node ids are tape positions */
+    ASSERT_NOT_NULL(strstr(dot, "n0 [label=\"a\""));
+    ASSERT_NOT_NULL(strstr(dot, "n0 -> n2;"));
+    ASSERT_NOT_NULL(strstr(dot, "n1 -> n2;"));
+    ASSERT_EQ(count_lines_with(dot, "->"), 2);
+    free(dot);
+
+    /* Values on request; user names never break the DOT string */
+    GraphExportOptions opts = graph_export_defaults();
+    opts.show_values = 1;
+    ASSERT_EQ(tape_export_dot(t, GRAPH_TEST_PATH, &opts), 0);
+    dot = read_export();
+    ASSERT_NOT_NULL(strstr(dot, "\\ndata 6"));
+    ASSERT_EQ(c->id, 2);
+    free(dot);
+}
+
+void test_export_subgraph_depth(void) {
+    Tape *t = tape_get_instance();
+    ValueData *y = graph_chain(50);
+    ValueData *focus = y->children[0]; // Last mul
+
+    GraphExportOptions opts = graph_export_defaults();
+    opts.focus = focus;
+    opts.depth = 1;
+    ASSERT_EQ(tape_export_dot(t, GRAPH_TEST_PATH, &opts), 0);
+    char *dot = read_export();
+    ASSERT_NOT_NULL(dot);
+
+    /* The mul, its two inputs (previous add, w) and its consumer (y) */
+    ASSERT_EQ(count_nodes(dot), 4);
+    ASSERT_EQ(count_lines_with(dot, "->"), 3);
+    ASSERT_EQ(count_lines_with(dot, "lightblue"), 1);
+    ASSERT_EQ(count_lines_with(dot, "dashed"), 2); // The previous add and y lost inputs
+    free(dot);
+
+    /* A node of another tape has no neighbourhood here */
+    Tape *other = tape_create();
+    ValueData *stray = value_create_with_tape(other, 1.0f, "s", 1);
+    opts.focus = stray;
+    ASSERT_EQ(tape_export_dot(t, GRAPH_TEST_PATH, &opts), -1);
+    tape_destroy(other);
+}
+
+void test_export_collapses_repeated_structure(void) {
+    Tape *t = tape_get_instance();
+    graph_chain(1000);
+
+    GraphExportOptions opts = graph_export_defaults();
+    opts.collapse = 1;
+    ASSERT_EQ(tape_export_dot(t, GRAPH_TEST_PATH, &opts), 0);
+    char *dot = read_export();
+    ASSERT_NOT_NULL(dot);
+
+    /* 2003 nodes fold into the first steps plus one class per op for all the rest */
+    ASSERT_EQ(count_nodes(dot), 8);
+    ASSERT_NOT_NULL(strstr(dot, "\"* x998\""));
+    ASSERT_NOT_NULL(strstr(dot, "\"+ x999\""));
+    ASSERT_NOT_NULL(strstr(dot, "label=\"x998\"")); // Aggregated edges
+    free(dot);
+}
+
+/* ================================================================
+ *  Summary
+ * ================================================================ */
+
+void test_graph_summary(void) {
+    Tape *t = tape_get_instance();
+    ValueData *y = graph_chain(10);
+    scalar_mul_value(2.0f, y);
+
+    GraphSummary s;
+    tape_graph_summary(t, &s);
+    ASSERT_EQ(s.num_nodes, 3 + 20 + 2);
+    ASSERT_EQ(s.op_count[OP_MUL], 11);
+    ASSERT_EQ(s.op_count[OP_ADD], 10);
+    ASSERT_EQ(s.num_params, 3);
+    ASSERT_EQ(s.num_constants, 1);
+    ASSERT_EQ(s.num_edges, 42);
+    ASSERT_EQ(s.depth, 21);
+    ASSERT_EQ(s.max_fan_out, 10); // w and b
+}
+
+/* ================================================================
+ *  Suite runner
+ * ================================================================ */
+
+void run_graph_tests(void) {
+    TEST_SUITE("Graph Export");
+    RUN_TEST(test_export_whole_tape_stable_ids);
+    RUN_TEST(test_export_subgraph_depth);
+    RUN_TEST(test_export_collapses_repeated_structure);
+    RUN_TEST(test_graph_summary);
+}
+
+#endif /* CGRAD_TEST_GRAPH */
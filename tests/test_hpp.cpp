@@ -0,0 +1,106 @@
+/* C++ front end tests (make test-cpp) */
+
+#include "utils.h"
+
+#include "../cgrad/cgrad.hpp"
+
+using cgrad::Var;
+
+/* ================================================================
+ *  Fused expressions
+ * ================================================================ */
+
+void test_hpp_expression_is_one_node(void) {
+    Tape *t = tape_get_instance();
+    Var a(2.0f, "a", true), b(3.0f, "b", true), c(1.0f, "c", true), f(0.5f, "f", true);
+    size_t leaves = tape_num_nodes(t);
+
+    Var y = (a * b + c) * f;
+    ASSERT_EQ(tape_num_nodes(t), leaves + 1);
+    ASSERT_EQ(y.node()->opcode, OP_FUSED);
+    ASSERT_NEAR(y.data(), 3.5f, DEFAULT_TOL);
+
+    y.backward();
+    ASSERT_NEAR(a.grad(), 1.5f, DEFAULT_TOL); // b * f
+    ASSERT_NEAR(b.grad(), 1.0f, DEFAULT_TOL); // a * f
+    ASSERT_NEAR(c.grad(), 0.5f, DEFAULT_TOL); // f
+    ASSERT_NEAR(f.grad(), 7.0f, DEFAULT_TOL); // a * b + c
+}
+
+void test_hpp_matches_c_api(void) {
+    Var x(1.5f, "x", true), z(-0.75f, "z", true);
+    Var y = (x - 2.0f) / (z * z + 1) - x * (3 - z) + -z;
+    y.backward();
+    scalar_t gx = x.grad(), gz = z.grad();
+    tape_zero_grad(tape_get_instance());
+
+    ValueData *xc = value_create(1.5f, "x", 1);
+    ValueData *zc = value_create(-0.75f, "z", 1);
+    ValueData *num = scalar_add_value(-2.0f, xc);
+    ValueData *den = scalar_add_value(1.0f, value_mul(zc, zc));
+    ValueData *yc = value_sub(value_div(num, den), value_mul(xc, scalar_sub_value(3.0f, zc)));
+    yc = value_sub(yc, zc);
+    value_backward(yc);
+
+    ASSERT_NEAR(y.data(), value_get_data(yc), DEFAULT_TOL);
+    ASSERT_NEAR(gx, value_get_grad(xc), DEFAULT_TOL);
+    ASSERT_NEAR(gz, value_get_grad(zc), DEFAULT_TOL);
+}
+
+void test_hpp_single_op_and_long_expressions(void) {
+    Tape *t = tape_get_instance();
+    Var a(2.0f, "a", true), b(4.0f, "b", true);
+    Var p = a * b;
+    ASSERT_EQ(p.node()->opcode, OP_MUL);
+
+    /* 23 additions do not fit one kernel: the root's operands are recorded first */
+    Var xs[24];
+    for (int i = 0; i < 24; i++)
+        xs[i] = Var((scalar_t)i, "x", true);
+    size_t before = tape_num_nodes(t);
+    Var s = ((((xs[0] + xs[1]) + (xs[2] + xs[3])) + ((xs[4] + xs[5]) + (xs[6] + xs[7]))) +
+             (((xs[8] + xs[9]) + (xs[10] + xs[11])) + ((xs[12] + xs[13]) + (xs[14] + xs[15])))) +
+            (((xs[16] + xs[17]) + (xs[18] + xs[19])) + ((xs[20] + xs[21]) + (xs[22] + xs[23])));
+    ASSERT_EQ(tape_num_nodes(t), before + 3);
+    ASSERT_NEAR(s.data(), 276.0f, DEFAULT_TOL);
+    s.backward();
+    for (int i = 0; i < 24; i++)
+        ASSERT_NEAR(xs[i].grad(), 1.0f, DEFAULT_TOL);
+}
+
+void test_hpp_replay_and_passes(void) {
+    Tape *t = tape_get_instance();
+    Var x(3.0f, "x", true), w(2.0f, "w", true);
+    Var y = x * w + x / w;
+    Var z = y * w;
+
+    /* Replay runs the recorded program */
+    value_set_data(x.node(), 1.0f);
+    tape_forward(t);
+    ASSERT_NEAR(y.data(), 2.5f, DEFAULT_TOL);
+    ASSERT_NEAR(z.data(), 5.0f, DEFAULT_TOL);
+
+    /* tape_fuse can inline the compiled node into its consumer */
+    ValueData *out = z.node();
+    ASSERT_TRUE(tape_fuse(t, &out, 1) > 0);
+    tape_zero_grad(t);
+    z.backward();
+    ASSERT_EQ(z.node()->opcode, OP_FUSED);
+    ASSERT_NEAR(x.grad(), 5.0f, DEFAULT_TOL); // w (w + 1/w)
+    ASSERT_NEAR(w.grad(), 4.0f, DEFAULT_TOL); // y + w (x - x/w^2)
+}
+
+/* ================================================================
+ *  Suite runner
+ * ================================================================ */
+
+int main(void) {
+    TEST_SUITE("C++ front end");
+    RUN_TEST(test_hpp_expression_is_one_node);
+    RUN_TEST(test_hpp_matches_c_api);
+    RUN_TEST(test_hpp_single_op_and_long_expressions);
+    RUN_TEST(test_hpp_replay_and_passes);
+
+    TEST_REPORT();
+    return g_tests_failed > 0 ? 1 : 0;
+}
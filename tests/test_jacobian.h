@@ -0,0 +1,109 @@
+#ifndef CGRAD_TEST_JACOBIAN
+#define CGRAD_TEST_JACOBIAN
+
+#include "utils.h"
+
+/* ================================================================
+ *  Dense Jacobians
+ * ================================================================ */
+
+void test_jacobian_dense(void) {
+    /* y0 = a * b, y1 = a / c, y2 = b - c */
+    Tape *t = tape_get_instance();
+    ValueData *a = value_create(2.0f, "a", 1);
+    ValueData *b = value_create(-3.0f, "b", 1);
+    ValueData *c = value_create(4.0f, "c", 1);
+    ValueData *ys[] = {value_mul(a, b), value_div(a, c), value_sub(b, c)};
+    ValueData *xs[] = {a, b, c};
+
+    scalar_t jac[9];
+    ASSERT_EQ(tape_jacobian(t, ys, 3, xs, 3, jac, JACOBIAN_DENSE), 3);
+
+    scalar_t expected[9] = {-3.0f, 2.0f, 0.0f, 0.25f, 0.0f, -0.125f, 0.0f, 1.0f, -1.0f};
+    for (int i = 0; i < 9; i++)
+        ASSERT_NEAR(jac[i], expected[i], DEFAULT_TOL);
+}
+
+void test_jacobian_matches_backward(void) {
+    /* More outputs than lanes, through a fused chain: every row must match
+     * the gradient of a single-seed backward pass */
+    Tape *t = tape_get_instance();
+    ValueData *x = value_create(1.5f, "x", 1);
+    ValueData *y = value_create(-0.5f, "y", 1);
+    ValueData *outs[JACOBIAN_LANES * 2 + 3];
+    size_t m = sizeof(outs) / sizeof(outs[0]);
+    for (size_t k = 0; k < m; k++)
+        outs[k] = value_add(scalar_mul_value((scalar_t)k, value_mul(x, y)), value_div(x, y));
+    tape_fuse(t, outs, m);
+
+    ValueData *xs[] = {x, y};
+    scalar_t jac[2 * (JACOBIAN_LANES * 2 + 3)];
+    ASSERT_EQ(tape_jacobian(t, outs, m, xs, 2, jac, JACOBIAN_DENSE), (int)m);
+
+    for (size_t k = 0; k < m; k++) {
+        /* d/dx = k*y + 1/y, d/dy = k*x - x/y^2 */
+        ASSERT_NEAR(jac[k * 2], (scalar_t)k * -0.5f - 2.0f, 1e-4f);
+        ASSERT_NEAR(jac[k * 2 + 1], (scalar_t)k * 1.5f - 6.0f, 1e-4f);
+    }
+}
+
+void test_jacobian_small_adjoints(void) {
+    /* Adjoints whose square underflows must still be propagated */
+    Tape *t = tape_get_instance();
+    ValueData *x = value_create(2.0f, "x", 1);
+    ValueData *y = scalar_mul_value(1e-25f, value_mul(x, x));
+    scalar_t jac[1];
+    ASSERT_EQ(tape_jacobian(t, &y, 1, &x, 1, jac, JACOBIAN_DENSE), 1);
+
+    value_backward(y);
+    ASSERT_TRUE(x->grad != 0.0f);
+    ASSERT_NEAR(jac[0] / x->grad, 1.0f, 1e-5f);
+}
+
+/* ================================================================
+ *  Sparsity-aware seeding
+ * ================================================================ */
+
+void test_jacobian_colored(void) {
+    /* Banded: y_i = x_i * x_{i+1}, so y_i and y_{i+2} share no input */
+    enum { N = 12 };
+    Tape *t = tape_get_instance();
+    ValueData *xs[N + 1], *ys[N];
+    for (int i = 0; i <= N; i++)
+        xs[i] = value_create(0.5f * (scalar_t)(i + 1), NULL, 1);
+    for (int i = 0; i < N; i++)
+        ys[i] = value_mul(xs[i], xs[i + 1]);
+
+    scalar_t dense[N * (N + 1)], colored[N * (N + 1)];
+    ASSERT_EQ(tape_jacobian(t, ys, N, xs, N + 1, dense, JACOBIAN_DENSE), N);
+    ASSERT_EQ(tape_jacobian(t, ys, N, xs, N + 1, colored, JACOBIAN_COLORED), 2);
+
+    for (int i = 0; i < N * (N + 1); i++)
+        ASSERT_NEAR(colored[i], dense[i], DEFAULT_TOL);
+    ASSERT_NEAR(colored[3 * (N + 1) + 3], xs[4]->data, DEFAULT_TOL);
+    ASSERT_NEAR(colored[3 * (N + 1) + 4], xs[3]->data, DEFAULT_TOL);
+}
+
+void test_jacobian_rejects_checkpoint(void) {
+    Tape *t = tape_get_instance();
+    ValueData *x = value_create(2.0f, "x", 1);
+    AffineStep p = {value_create(0.5f, "w", 1), value_create(1.0f, "b", 1)};
+    ValueData *y = value_checkpoint_sequential(x, affine_step, 4, CHECKPOINT_AUTO, &p);
+    scalar_t jac[1];
+    ASSERT_EQ(tape_jacobian(t, &y, 1, &x, 1, jac, JACOBIAN_DENSE), -1);
+}
+
+/* ================================================================
+ *  Suite runner
+ * ================================================================ */
+
+void run_jacobian_tests(void) {
+    TEST_SUITE("Jacobian");
+    RUN_TEST(test_jacobian_dense);
+    RUN_TEST(test_jacobian_matches_backward);
+    RUN_TEST(test_jacobian_small_adjoints);
+    RUN_TEST(test_jacobian_colored);
+    RUN_TEST(test_jacobian_rejects_checkpoint);
+}
+
+#endif /* CGRAD_TEST_JACOBIAN */
@@ -0,0 +1,108 @@
+#ifndef CGRAD_TEST_MEMPLAN
+#define CGRAD_TEST_MEMPLAN
+
+#include "utils.h"
+
+/* ================================================================
+ *  Liveness-based memory planner
+ * ================================================================ */
+
+/* y = x; repeat n times: y = y * w + b */
+static ValueData *build_affine_chain(ValueData *x, ValueData *w, ValueData *b, int n) {
+    ValueData *y = x;
+    for (int i = 0; i < n; i++)
+        y = value_add(value_mul(y, w), b);
+    return y;
+}
+
+void test_memplan_reuses_slots(void) {
+    Tape *t = tape_get_instance();
+    ValueData *x = value_create(1.0f, "x", 0);
+    ValueData *w = value_create(0.5f, "w", 0);
+    ValueData *b = value_create(0.25f, "b", 0);
+    ValueData *y = build_affine_chain(x, w, b, 100);
+
+    MemoryPlan *p = memplan_create(t, &y, 1);
+    ASSERT_NOT_NULL(p);
+    if (!p)
+        return;
+    ASSERT_TRUE(memplan_num_slots(p) <= 5);
+    ASSERT_TRUE(memplan_num_slots(p) < tape_num_nodes(t));
+
+    scalar_t expected = value_get_data(y);
+    scalar_t *buffer = (scalar_t *)malloc(sizeof(scalar_t) * memplan_num_slots(p));
+    value_set_data(y, 0.0f);
+    ASSERT_EQ(memplan_execute(p, t, buffer), 0);
+    ASSERT_NEAR(memplan_output(p, buffer, 0), expected, DEFAULT_TOL);
+    ASSERT_NEAR(value_get_data(y), expected, DEFAULT_TOL);
+
+    free(buffer);
+    memplan_destroy(p);
+}
+
+void test_memplan_matches_replay(void) {
+    Tape *t = tape_get_instance();
+    ValueData *x = value_create(1.0f, "x", 0);
+    ValueData *w = value_create(-0.75f, "w", 0);
+    ValueData *b = value_create(2.0f, "b", 0);
+    ValueData *y1 = build_affine_chain(x, w, b, 10);
+    ValueData *y2 = value_div(y1, value_sub(x, w));
+    ValueData *outputs[] = {y1, y2};
+
+    MemoryPlan *p = memplan_create(t, outputs, 2);
+    ASSERT_NOT_NULL(p);
+    if (!p)
+        return;
+
+    scalar_t buffer[64];
+    ASSERT_TRUE(memplan_num_slots(p) <= 64);
+    value_set_data(x, 3.0f);
+    memplan_execute(p, t, buffer);
+    scalar_t got1 = memplan_output(p, buffer, 0);
+    scalar_t got2 = memplan_output(p, buffer, 1);
+
+    tape_forward(t);
+    ASSERT_NEAR(got1, value_get_data(y1), DEFAULT_TOL);
+    ASSERT_NEAR(got2, value_get_data(y2), DEFAULT_TOL);
+    memplan_destroy(p);
+}
+
+void test_memplan_fused(void) {
+    Tape *t = tape_get_instance();
+    ValueData *x = value_create(2.0f, "x", 0);
+    ValueData *w = value_create(3.0f, "w", 0);
+    ValueData *b = value_create(1.0f, "b", 0);
+    ValueData *y = build_affine_chain(x, w, b, 3);
+    tape_fuse(t, &y, 1);
+
+    MemoryPlan *p = memplan_create(t, &y, 1);
+    ASSERT_NOT_NULL(p);
+    if (!p)
+        return;
+
+    scalar_t buffer[16];
+    memplan_execute(p, t, buffer);
+    /* ((2*3+1)*3+1)*3+1 = 67 */
+    ASSERT_NEAR(memplan_output(p, buffer, 0), 67.0f, DEFAULT_TOL);
+    memplan_destroy(p);
+}
+
+void test_memplan_requires_outputs(void) {
+    Tape *t = tape_get_instance();
+    value_create(1.0f, "x", 0);
+    ASSERT_TRUE(memplan_create(t, NULL, 0) == NULL);
+}
+
+/* ================================================================
+ *  Suite runner
+ * ================================================================ */
+
+void run_memplan_tests(void) {
+    TEST_SUITE("Memory Planner");
+    RUN_TEST(test_memplan_reuses_slots);
+    RUN_TEST(test_memplan_matches_replay);
+    RUN_TEST(test_memplan_fused);
+    RUN_TEST(test_memplan_requires_outputs);
+}
+
+#endif /* CGRAD_TEST_MEMPLAN */
@@ -0,0 +1,181 @@
+#ifndef CGRAD_TEST_PARAMS
+#define CGRAD_TEST_PARAMS
+
+#include "utils.h"
+
+#include <stdlib.h>
+
+/* ================================================================
+ *  Parameter store
+ * ================================================================ */
+
+void test_param_store_grows(void) {
+    ParamStore *s = param_store_create(2);
+    ASSERT_NOT_NULL(s);
+    if (!s)
+        return;
+
+    scalar_t init[100];
+    for (int i = 0; i < 100; i++)
+        init[i] = (scalar_t)i;
+    ASSERT_EQ(param_store_add(s, -1.0f), 0);
+    ASSERT_EQ(param_store_add_array(s, init, 100), 1);
+    ASSERT_EQ(param_store_size(s), 101);
+    ASSERT_NEAR(s->data[0], -1.0f, DEFAULT_TOL);
+    ASSERT_NEAR(s->data[100], 99.0f, DEFAULT_TOL);
+    ASSERT_NEAR(s->grad[100], 0.0f, DEFAULT_TOL);
+
+    /* Growing keeps the arrays on cache lines, for the threaded optimizer slices */
+    ASSERT_EQ((uintptr_t)s->data % 64, 0);
+    ASSERT_EQ((uintptr_t)s->v % 64, 0);
+    param_store_destroy(s);
+}
+
+void test_param_bind_accumulates_grads(void) {
+    /* L = w0 * w1 + w0, recorded on two successive tapes */
+    Tape *t = tape_get_instance();
+    ParamStore *s = param_store_create(0);
+    size_t w0 = param_store_add(s, 2.0f);
+    size_t w1 = param_store_add(s, 5.0f);
+
+    for (int step = 0; step < 2; step++) {
+        ValueData *a = param_bind(s, w0);
+        ValueData *b = param_bind(s, w1);
+        ValueData *L = value_add(value_mul(a, b), a);
+        value_backward(L);
+        tape_clear(t);
+    }
+
+    /* Parameters survive tape_clear; gradients add up across backward passes */
+    ASSERT_NEAR(s->data[w0], 2.0f, DEFAULT_TOL);
+    ASSERT_NEAR(s->grad[w0], 2.0f * 6.0f, DEFAULT_TOL);
+    ASSERT_NEAR(s->grad[w1], 2.0f * 2.0f, DEFAULT_TOL);
+
+    param_store_zero_grad(s);
+    ASSERT_NEAR(s->grad[w0], 0.0f, DEFAULT_TOL);
+    ASSERT_TRUE(param_bind(s, 2) == NULL);
+    param_store_destroy(s);
+}
+
+/* ================================================================
+ *  Optimizers
+ * ================================================================ */
+
+void test_sgd_momentum(void) {
+    ParamStore *s = param_store_create(0);
+    param_store_add(s, 1.0f);
+    Optimizer opt = optimizer_sgd(0.1f, 0.9f);
+
+    s->grad[0] = 2.0f;
+    param_store_step(s, &opt); // v = 2, p = 1 - 0.2
+    ASSERT_NEAR(s->data[0], 0.8f, DEFAULT_TOL);
+    param_store_step(s, &opt); // v = 3.8, p = 0.8 - 0.38
+    ASSERT_NEAR(s->data[0], 0.42f, DEFAULT_TOL);
+    param_store_destroy(s);
+}
+
+void test_adam_first_step(void) {
+    /* After bias correction, the first Adam step moves by lr * sign(g) */
+    ParamStore *s = param_store_create(0);
+    scalar_t init[] = {1.0f, 1.0f, 1.0f};
+    param_store_add_array(s, init, 3);
+    s->grad[0] = 3.0f;
+    s->grad[1] = -0.01f;
+    s->grad[2] = 0.0f;
+
+    Optimizer opt = optimizer_adam(0.01f);
+    ASSERT_EQ(param_store_step(s, &opt), 0);
+    ASSERT_NEAR(s->data[0], 0.99f, 1e-5f);
+    ASSERT_NEAR(s->data[1], 1.01f, 1e-5f);
+    ASSERT_NEAR(s->data[2], 1.0f, 1e-6f);
+    ASSERT_EQ(s->step, 1);
+    param_store_destroy(s);
+}
+
+void test_adamw_decoupled_decay(void) {
+    ParamStore *s = param_store_create(0);
+    param_store_add(s, 2.0f);
+    Optimizer opt = optimizer_adamw(0.1f, 0.5f);
+    param_store_step(s, &opt); // Zero gradient: only the decay applies
+    ASSERT_NEAR(s->data[0], 2.0f * (1.0f - 0.05f), 1e-5f);
+    param_store_destroy(s);
+}
+
+void test_optimizer_threads_match(void) {
+    const size_t n = 4 * 16384 + 123;
+    ParamStore *a = param_store_create(n);
+    ParamStore *b = param_store_create(n);
+    scalar_t *init = (scalar_t *)malloc(sizeof(scalar_t) * n);
+    for (size_t i = 0; i < n; i++)
+        init[i] = (scalar_t)(i % 17) * 0.1f - 0.8f;
+    param_store_add_array(a, init, n);
+    param_store_add_array(b, init, n);
+
+    Optimizer single = optimizer_adamw(1e-2f, 1e-2f);
+    Optimizer multi = single;
+    multi.num_threads = 4;
+    for (int step = 0; step < 3; step++) {
+        for (size_t i = 0; i < n; i++)
+            a->grad[i] = b->grad[i] = init[(i * 7) % n];
+        param_store_step(a, &single);
+        param_store_step(b, &multi);
+    }
+
+    /* Slices may vectorize differently at their edges: compare with a tolerance */
+    scalar_t max_diff = 0.0f;
+    for (size_t i = 0; i < n; i++) {
+        scalar_t d = (scalar_t)fabs(a->data[i] - b->data[i]);
+        max_diff = d > max_diff ? d : max_diff;
+    }
+    ASSERT_NEAR(max_diff, 0.0f, 1e-5f);
+
+    free(init);
+    param_store_destroy(a);
+    param_store_destroy(b);
+}
+
+void test_training_loop(void) {
+    /* Fit y = 3x - 1 with Adam, recording a fresh tape every step */
+    Tape *t = tape_get_instance();
+    ParamStore *s = param_store_create(0);
+    size_t w = param_store_add(s, 0.0f);
+    size_t b = param_store_add(s, 0.0f);
+    Optimizer opt = optimizer_adam(0.05f);
+
+    for (int step = 0; step < 500; step++) {
+        ValueData *wv = param_bind(s, w);
+        ValueData *bv = param_bind(s, b);
+        ValueData *loss = value_create(0.0f, NULL, 0);
+        for (int i = -2; i <= 2; i++) {
+            scalar_t x = (scalar_t)i;
+            ValueData *err = value_sub(value_add(scalar_mul_value(x, wv), bv),
+                                       value_create(3.0f * x - 1.0f, NULL, 0));
+            loss = value_add(loss, value_mul(err, err));
+        }
+        param_store_zero_grad(s);
+        value_backward(loss);
+        param_store_step(s, &opt);
+        tape_clear(t);
+    }
+
+    ASSERT_NEAR(s->data[w], 3.0f, 1e-2f);
+    ASSERT_NEAR(s->data[b], -1.0f, 1e-2f);
+    param_store_destroy(s);
+}
+
+/* ================================================================
+ *  Suite runner
+ * ================================================================ */
+
+void run_params_tests(void) {
+    TEST_SUITE("Parameters & Optimizers");
+    RUN_TEST(test_param_store_grows);
+    RUN_TEST(test_param_bind_accumulates_grads);
+    RUN_TEST(test_sgd_momentum);
+    RUN_TEST(test_adam_first_step);
+    RUN_TEST(test_adamw_decoupled_decay);
+    RUN_TEST(test_optimizer_threads_match);
+    RUN_TEST(test_training_loop);
+}
+
+#endif /* CGRAD_TEST_PARAMS */
@@ -0,0 +1,139 @@
+#ifndef CGRAD_TEST_PASSES
+#define CGRAD_TEST_PASSES
+
+#include "utils.h"
+
+/* ================================================================
+ *  Graph optimization passes
+ * ================================================================ */
+
+void test_cse_merges_duplicates(void) {
+    /* L = (a * b) + (b * a)  =>  dL/da = 2b, dL/db = 2a */
+    Tape *t = tape_get_instance();
+    ValueData *a = value_create(2.0f, "a", 1);
+    ValueData *b = value_create(-3.0f, "b", 1);
+    ValueData *L = value_add(value_mul(a, b), value_mul(b, a));
+
+    size_t removed = tape_optimize(t, &L, 1, PASS_CSE);
+    ASSERT_EQ(removed, 1);
+    ASSERT_EQ(tape_num_nodes(t), 4);
+    ASSERT_TRUE(L->children[0] == L->children[1]);
+
+    value_backward(L);
+    ASSERT_NEAR(value_get_grad(a), -6.0f, DEFAULT_TOL);
+    ASSERT_NEAR(value_get_grad(b), 4.0f, DEFAULT_TOL);
+}
+
+void test_dce_drops_unreachable(void) {
+    Tape *t = tape_get_instance();
+    ValueData *a = value_create(2.0f, "a", 1);
+    ValueData *b = value_create(3.0f, "b", 1);
+    ValueData *unused = value_mul(a, b);
+    ValueData *L = value_add(a, b);
+    (void)unused;
+
+    size_t removed = tape_optimize(t, &L, 1, PASS_DCE);
+    ASSERT_EQ(removed, 1);
+    ASSERT_EQ(tape_num_nodes(t), 3);
+    ASSERT_TRUE(tape_contains(t, L));
+    ASSERT_TRUE(!tape_contains(t, unused));
+}
+
+void test_fold_constants(void) {
+    /* L = a * (2 + 3): the constant subtree becomes a single leaf */
+    Tape *t = tape_get_instance();
+    ValueData *a = value_create(4.0f, "a", 1);
+    ValueData *k = scalar_add_value(2.0f, scalar_add_value(3.0f, value_create(0.0f, "", 0)));
+    ValueData *L = value_mul(a, k);
+
+    tape_optimize(t, &L, 1, PASS_FOLD | PASS_DCE);
+    ASSERT_TRUE(k->opcode == OP_NONE);
+    ASSERT_EQ(k->num_children, 0);
+    ASSERT_EQ(tape_num_nodes(t), 3);
+
+    value_backward(L);
+    ASSERT_NEAR(value_get_data(L), 20.0f, DEFAULT_TOL);
+    ASSERT_NEAR(value_get_grad(a), 5.0f, DEFAULT_TOL);
+}
+
+void test_fold_keeps_named_inputs(void) {
+    /* x is a named input, so x * 2 must stay replayable */
+    Tape *t = tape_get_instance();
+    ValueData *x = value_create(1.0f, "x", 0);
+    ValueData *y = scalar_add_value(2.0f, x);
+
+    tape_optimize(t, &y, 1, PASS_ALL);
+    value_set_data(x, 5.0f);
+    tape_forward(t);
+    ASSERT_NEAR(value_get_data(y), 7.0f, DEFAULT_TOL);
+}
+
+void test_simplify_identities(void) {
+    /* L = ((a * 1) + 0) * b  =>  L = a * b */
+    Tape *t = tape_get_instance();
+    ValueData *a = value_create(2.0f, "a", 1);
+    ValueData *b = value_create(5.0f, "b", 1);
+    ValueData *one = value_create(1.0f, "", 0);
+    ValueData *zero = value_create(0.0f, "", 0);
+    ValueData *L = value_mul(value_add(value_mul(a, one), zero), b);
+
+    tape_optimize(t, &L, 1, PASS_SIMPLIFY | PASS_DCE);
+    ASSERT_EQ(tape_num_nodes(t), 3);
+    ASSERT_TRUE(L->children[0] == a);
+
+    value_backward(L);
+    ASSERT_NEAR(value_get_grad(a), 5.0f, DEFAULT_TOL);
+    ASSERT_NEAR(value_get_grad(b), 2.0f, DEFAULT_TOL);
+}
+
+void test_optimized_replay(void) {
+    /* L = (a * b + a * b) / c, replayed with new inputs */
+    Tape *t = tape_get_instance();
+    ValueData *a = value_create(1.0f, "a", 1);
+    ValueData *b = value_create(2.0f, "b", 1);
+    ValueData *c = value_create(4.0f, "c", 1);
+    ValueData *L = value_div(value_add(value_mul(a, b), value_mul(a, b)), c);
+
+    tape_optimize(t, &L, 1, PASS_ALL);
+
+    value_set_data(a, 3.0f);
+    value_set_data(b, -1.0f);
+    value_set_data(c, 2.0f);
+    tape_forward(t);
+    tape_zero_grad(t);
+    value_backward(L);
+
+    ASSERT_NEAR(value_get_data(L), -3.0f, DEFAULT_TOL);
+    ASSERT_NEAR(value_get_grad(a), -1.0f, DEFAULT_TOL);
+    ASSERT_NEAR(value_get_grad(b), 3.0f, DEFAULT_TOL);
+    ASSERT_NEAR(value_get_grad(c), 1.5f, DEFAULT_TOL);
+}
+
+void test_outputs_are_preserved(void) {
+    Tape *t = tape_get_instance();
+    ValueData *a = value_create(2.0f, "a", 1);
+    ValueData *one = value_create(1.0f, "", 0);
+    ValueData *y = value_mul(a, one);
+
+    tape_optimize(t, &y, 1, PASS_ALL);
+    ASSERT_TRUE(tape_contains(t, y));
+    value_backward(y);
+    ASSERT_NEAR(value_get_grad(a), 1.0f, DEFAULT_TOL);
+}
+
+/* ================================================================
+ *  Suite runner
+ * ================================================================ */
+
+void run_passes_tests(void) {
+    TEST_SUITE("Graph Passes");
+    RUN_TEST(test_cse_merges_duplicates);
+    RUN_TEST(test_dce_drops_unreachable);
+    RUN_TEST(test_fold_constants);
+    RUN_TEST(test_fold_keeps_named_inputs);
+    RUN_TEST(test_simplify_identities);
+    RUN_TEST(test_optimized_replay);
+    RUN_TEST(test_outputs_are_preserved);
+}
+
+#endif /* CGRAD_TEST_PASSES */
@@ -0,0 +1,136 @@
+#ifndef CGRAD_TEST_PIPELINE
+#define CGRAD_TEST_PIPELINE
+
+#include "utils.h"
+
+/* Batch i of a line fit: x = 1 + i % 4, target y = 3x - 1 */
+static scalar_t pipeline_x(size_t batch) {
+    return (scalar_t)(1 + batch % 4);
+}
+
+/* loss = (w * x + b - y)^2 with w = params[0], b = params[1] */
+static ValueData *line_loss(ParamStore *s, size_t batch, void *user) {
+    (void)user;
+    scalar_t x = pipeline_x(batch);
+    ValueData *pred = value_add(scalar_mul_value(x, param_bind(s, 0)), param_bind(s, 1));
+    ValueData *err = value_sub(pred, value_create(3.0f * x - 1.0f, NULL, 0));
+    return value_mul(err, err);
+}
+
+/* Gradient of line_loss at (w, b) */
+static void line_grad(scalar_t w, scalar_t b, size_t batch, scalar_t *gw, scalar_t *gb) {
+    scalar_t x = pipeline_x(batch);
+    scalar_t err = w * x + b - (3.0f * x - 1.0f);
+    *gw = 2.0f * err * x;
+    *gb = 2.0f * err;
+}
+
+static ParamStore *line_params(void) {
+    ParamStore *s = param_store_create(2);
+    param_store_add(s, 0.5f);
+    param_store_add(s, 0.0f);
+    return s;
+}
+
+/* ================================================================
+ *  Sequential steps
+ * ================================================================ */
+
+void test_pipeline_sequential_matches_loop(void) {
+    ParamStore *s = line_params();
+    Optimizer opt = optimizer_sgd(0.01f, 0.0f);
+    PipelineConfig config = {0, 1};
+    Pipeline *p = pipeline_create(s, &opt, line_loss, NULL, config);
+    ASSERT_NOT_NULL(p);
+
+    scalar_t losses[20];
+    ASSERT_EQ(pipeline_run(p, 20, losses), 0);
+
+    /* Plain SGD, one batch per step */
+    scalar_t w = 0.5f, b = 0.0f;
+    for (size_t i = 0; i < 20; i++) {
+        scalar_t gw, gb;
+        line_grad(w, b, i, &gw, &gb);
+        w -= 0.01f * gw;
+        b -= 0.01f * gb;
+    }
+    ASSERT_NEAR(s->data[0], w, 1e-4f);
+    ASSERT_NEAR(s->data[1], b, 1e-4f);
+    ASSERT_TRUE(losses[19] < losses[0]);
+
+    pipeline_destroy(p);
+    param_store_destroy(s);
+}
+
+/* ================================================================
+ *  Staleness 1: overlapped forward, one-update-old gradients
+ * ================================================================ */
+
+void test_pipeline_staleness_one(void) {
+    Tape *t = tape_get_instance();
+    value_create(1.0f, "mine", 0);
+
+    ParamStore *s = line_params();
+    Optimizer opt = optimizer_sgd(0.01f, 0.0f);
+    PipelineConfig config = {1, 1};
+    Pipeline *p = pipeline_create(s, &opt, line_loss, NULL, config);
+    ASSERT_NOT_NULL(p);
+    scalar_t losses[200];
+    ASSERT_EQ(pipeline_run(p, 200, losses), 0);
+
+    /* Gradient of batch i taken at the parameters before update i - 1 */
+    scalar_t w[201], b[201];
+    w[0] = 0.5f, b[0] = 0.0f;
+    for (size_t i = 0; i < 200; i++) {
+        size_t at = i == 0 ? 0 : i - 1;
+        scalar_t gw, gb;
+        line_grad(w[at], b[at], i, &gw, &gb);
+        w[i + 1] = w[i] - 0.01f * gw;
+        b[i + 1] = b[i] - 0.01f * gb;
+    }
+    ASSERT_NEAR(s->data[0], w[200], 1e-3f);
+    ASSERT_NEAR(s->data[1], b[200], 1e-3f);
+    /* Still converges: the last four batches fit far better than the first four */
+    scalar_t first = losses[0] + losses[1] + losses[2] + losses[3];
+    scalar_t last = losses[196] + losses[197] + losses[198] + losses[199];
+    ASSERT_TRUE(last < 0.1f * first);
+
+    /* The caller's tape is untouched */
+    ASSERT_EQ(tape_num_nodes(t), 1);
+    ASSERT_TRUE(tape_get_instance() == t);
+
+    pipeline_destroy(p);
+    param_store_destroy(s);
+}
+
+void test_pipeline_accumulates(void) {
+    /* Two batches per step: batches 0 and 1 see the initial parameters */
+    ParamStore *s = line_params();
+    Optimizer opt = optimizer_sgd(0.01f, 0.0f);
+    PipelineConfig config = {1, 2};
+    Pipeline *p = pipeline_create(s, &opt, line_loss, NULL, config);
+    ASSERT_EQ(pipeline_run(p, 2, NULL), 0);
+
+    scalar_t gw0, gb0, gw1, gb1;
+    line_grad(0.5f, 0.0f, 0, &gw0, &gb0);
+    line_grad(0.5f, 0.0f, 1, &gw1, &gb1);
+    ASSERT_NEAR(s->data[0], 0.5f - 0.01f * (gw0 + gw1), 1e-5f);
+    ASSERT_NEAR(s->data[1], 0.0f - 0.01f * (gb0 + gb1), 1e-5f);
+    ASSERT_NEAR(s->grad[0], 0.0f, 1e-9f);
+
+    pipeline_destroy(p);
+    param_store_destroy(s);
+}
+
+/* ================================================================
+ *  Suite runner
+ * ================================================================ */
+
+void run_pipeline_tests(void) {
+    TEST_SUITE("Pipeline");
+    RUN_TEST(test_pipeline_sequential_matches_loop);
+    RUN_TEST(test_pipeline_staleness_one);
+    RUN_TEST(test_pipeline_accumulates);
+}
+
+#endif /* CGRAD_TEST_PIPELINE */
@@ -0,0 +1,189 @@
+#ifndef CGRAD_TEST_PLANCACHE
+#define CGRAD_TEST_PLANCACHE
+
+#include "utils.h"
+
+/* L = (w x + b - y)^2 + 0.5, recorded on the current tape */
+static ValueData *plancache_loss(ValueData *w, ValueData *b, scalar_t x, scalar_t y) {
+    ValueData *pred = value_add(value_mul(w, value_create(x, "x", 0)), b);
+    ValueData *err = value_sub(pred, value_create(y, "y", 0));
+    return scalar_add_value(0.5f, value_mul(err, err));
+}
+
+/* (a, b) -> (a * b), a subgraph body */
+static void plancache_body(ValueData **in, ValueData **out, void *ctx) {
+    (void)ctx;
+    out[0] = value_mul(in[0], in[1]);
+}
+
+/* ================================================================
+ *  Structural hash
+ * ================================================================ */
+
+void test_structure_hash_ignores_values(void) {
+    Tape *t = tape_get_instance();
+    uint64_t h1[2], h2[2];
+
+    plancache_loss(value_create(1.0f, "w", 1), value_create(2.0f, "b", 1), 3.0f, 4.0f);
+    tape_structure_hash(t, h1);
+    tape_clear(t);
+    plancache_loss(value_create(-5.0f, "w", 1), value_create(0.5f, "b", 1), 7.0f, 1.0f);
+    tape_structure_hash(t, h2);
+
+    ASSERT_TRUE(h1[0] == h2[0] && h1[1] == h2[1]);
+}
+
+void test_structure_hash_sees_structure(void) {
+    Tape *t = tape_get_instance();
+    uint64_t base[2], other[2];
+
+    ValueData *a = value_create(1.0f, "a", 1), *b = value_create(2.0f, "b", 1);
+    value_mul(a, value_add(a, b));
+    tape_structure_hash(t, base);
+
+    /* Different op */
+    tape_clear(t);
+    a = value_create(1.0f, "a", 1), b = value_create(2.0f, "b", 1);
+    value_mul(a, value_sub(a, b));
+    tape_structure_hash(t, other);
+    ASSERT_TRUE(base[0] != other[0] || base[1] != other[1]);
+
+    /* Different wiring */
+    tape_clear(t);
+    a = value_create(1.0f, "a", 1), b = value_create(2.0f, "b", 1);
+    value_mul(b, value_add(a, b));
+    tape_structure_hash(t, other);
+    ASSERT_TRUE(base[0] != other[0] || base[1] != other[1]);
+
+    /* Constants are compiled in, so their values count */
+    uint64_t c1[2], c2[2];
+    tape_clear(t);
+    scalar_mul_value(2.0f, value_create(1.0f, "a", 1));
+    tape_structure_hash(t, c1);
+    tape_clear(t);
+    scalar_mul_value(3.0f, value_create(1.0f, "a", 1));
+    tape_structure_hash(t, c2);
+    ASSERT_TRUE(c1[0] != c2[0] || c1[1] != c2[1]);
+}
+
+void test_structure_hash_after_rewrite(void) {
+    /* Optimizing the tape must not leave a stale hash of the old node index */
+    Tape *t = tape_get_instance();
+    uint64_t before[2], after[2], fresh[2];
+
+    ValueData *a = value_create(1.0f, "a", 1);
+    ValueData *L = value_mul(a, scalar_add_value(0.0f, a));
+    tape_structure_hash(t, before);
+    tape_optimize(t, &L, 1, PASS_ALL);
+    tape_structure_hash(t, after);
+    ASSERT_TRUE(before[0] != after[0] || before[1] != after[1]);
+
+    tape_hash_invalidate(t);
+    tape_structure_hash(t, fresh);
+    ASSERT_TRUE(after[0] == fresh[0] && after[1] == fresh[1]);
+}
+
+/* ================================================================
+ *  Cache
+ * ================================================================ */
+
+void test_plan_cache_compiles_and_hits(void) {
+    PlanCacheConfig cfg = {0, 2};
+    PlanCache *c = plan_cache_create(cfg);
+    ASSERT_NOT_NULL(c);
+    Tape *t = tape_get_instance();
+
+    static const int expected[] = {0, 1, 1, 1};
+    for (int step = 0; step < 4; step++) {
+        tape_clear(t);
+        scalar_t x = 0.5f * (scalar_t)step, y = 1.0f - x;
+        ValueData *w = value_create(1.5f, "w", 1), *b = value_create(-0.5f, "b", 1);
+        ValueData *L = plancache_loss(w, b, x, y);
+        ASSERT_EQ(plan_cache_backward(c, t, L), expected[step]);
+
+        scalar_t err = 1.5f * x - 0.5f - y;
+        ASSERT_NEAR(w->grad, 2.0f * err * x, 1e-5f);
+        ASSERT_NEAR(b->grad, 2.0f * err, 1e-5f);
+    }
+
+    PlanCacheStats st = plan_cache_stats(c);
+    ASSERT_EQ(st.compiles, 1);
+    ASSERT_EQ(st.hits, 2);
+    ASSERT_EQ(st.misses, 2);
+    ASSERT_EQ(plan_cache_size(c), 1);
+    ASSERT_NOT_NULL(plan_cache_lookup(c, t));
+    plan_cache_destroy(c);
+}
+
+void test_plan_cache_bound_params(void) {
+    /* Gradients reach the parameter store through the leaf hooks */
+    PlanCacheConfig cfg = {0, 0};
+    PlanCache *c = plan_cache_create(cfg);
+    ParamStore *s = param_store_create(0);
+    size_t w = param_store_add(s, 2.0f), b = param_store_add(s, 1.0f);
+    Tape *t = tape_get_instance();
+
+    for (int step = 0; step < 3; step++) {
+        tape_clear(t);
+        ValueData *L = plancache_loss(param_bind(s, w), param_bind(s, b), 1.0f, 0.0f);
+        ASSERT_EQ(plan_cache_backward(c, t, L), 1);
+    }
+    /* Three steps of dL/dw = dL/db = 2 (2 + 1) */
+    ASSERT_NEAR(s->grad[w], 18.0f, 1e-4f);
+    ASSERT_NEAR(s->grad[b], 18.0f, 1e-4f);
+
+    param_store_destroy(s);
+    plan_cache_destroy(c);
+}
+
+void test_plan_cache_evicts_and_remembers_failures(void) {
+    PlanCacheConfig cfg = {1, 1};
+    PlanCache *c = plan_cache_create(cfg);
+    Tape *t = tape_get_instance();
+
+    /* Two shapes alternating through a single slot */
+    for (int step = 0; step < 4; step++) {
+        tape_clear(t);
+        ValueData *a = value_create(2.0f, "a", 1);
+        ValueData *L = (step % 2) ? value_mul(a, a) : value_add(a, a);
+        ASSERT_EQ(plan_cache_backward(c, t, L), 1);
+        ASSERT_NEAR(a->grad, (step % 2) ? 4.0f : 2.0f, 1e-5f);
+    }
+    PlanCacheStats st = plan_cache_stats(c);
+    ASSERT_EQ(st.compiles, 4);
+    ASSERT_EQ(st.evictions, 3);
+    ASSERT_EQ(st.hits, 0);
+
+    /* A shape codegen rejects is interpreted, and not compiled again */
+    SubgraphTemplate *tmpl = subgraph_template_create(plancache_body, 2, 1, NULL);
+    for (int step = 0; step < 2; step++) {
+        tape_clear(t);
+        ValueData *in[2] = {value_create(3.0f, "a", 1), value_create(4.0f, "b", 1)}, *out[1];
+        subgraph_apply(tmpl, in, out);
+        ASSERT_EQ(plan_cache_backward(c, t, out[0]), 0);
+        ASSERT_NEAR(in[0]->grad, 4.0f, 1e-5f);
+    }
+    st = plan_cache_stats(c);
+    ASSERT_EQ(st.failures, 1);
+    ASSERT_EQ(st.compiles, 4);
+
+    tape_clear(t);
+    subgraph_template_destroy(tmpl);
+    plan_cache_destroy(c);
+}
+
+/* ================================================================
+ *  Suite runner
+ * ================================================================ */
+
+void run_plancache_tests(void) {
+    TEST_SUITE("Plan cache");
+    RUN_TEST(test_structure_hash_ignores_values);
+    RUN_TEST(test_structure_hash_sees_structure);
+    RUN_TEST(test_structure_hash_after_rewrite);
+    RUN_TEST(test_plan_cache_compiles_and_hits);
+    RUN_TEST(test_plan_cache_bound_params);
+    RUN_TEST(test_plan_cache_evicts_and_remembers_failures);
+}
+
+#endif /* CGRAD_TEST_PLANCACHE */
@@ -0,0 +1,119 @@
+#ifndef CGRAD_TEST_PRECISION
+#define CGRAD_TEST_PRECISION
+
+#include "utils.h"
+
+/* ================================================================
+ *  Scalar precision
+ * ================================================================ */
+
+void test_scalar_size_matches_library(void) {
+    ASSERT_EQ(value_scalar_size(), sizeof(scalar_t));
+}
+
+/* ================================================================
+ *  16-bit storage formats
+ * ================================================================ */
+
+void test_bf16_conversion(void) {
+    ASSERT_EQ(bf16_from_float(1.0f), 0x3F80);
+    ASSERT_EQ(bf16_from_float(-2.0f), 0xC000);
+    ASSERT_EQ(bf16_to_float(bf16_from_float(3.0f)), 3.0f);
+
+    /* 1 + 2^-8 sits halfway between two bf16 values: ties go to even */
+    ASSERT_EQ(bf16_from_float(1.00390625f), 0x3F80);
+    ASSERT_EQ(bf16_from_float(1.01171875f), 0x3F82);
+
+    /* Keeps the float32 range */
+    ASSERT_NEAR(bf16_to_float(bf16_from_float(1e30f)) / 1e30f, 1.0f, 1e-2f);
+}
+
+void test_fp16_conversion(void) {
+    ASSERT_EQ(fp16_from_float(1.0f), 0x3C00);
+    ASSERT_EQ(fp16_from_float(-2.0f), 0xC000);
+    ASSERT_EQ(fp16_from_float(65504.0f), 0x7BFF);
+    ASSERT_EQ(fp16_from_float(1e6f), 0x7C00);     // Overflow to inf
+    ASSERT_EQ(fp16_from_float(5.9604645e-8f), 1); // Smallest subnormal
+    ASSERT_EQ(fp16_from_float(0.0f), 0);
+
+    scalar_t samples[] = {0.1f, -3.14159f, 1000.5f, 6.1e-5f, 1.5e-6f};
+    for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+        scalar_t x = samples[i];
+        scalar_t back = half_to_scalar(half_from_scalar(x, HALF_FP16), HALF_FP16);
+        ASSERT_NEAR(back, x, fabs(x) * 1e-3f + 6e-8f);
+    }
+}
+
+void test_half_pack_roundtrip(void) {
+    scalar_t src[16], dst[16];
+    half_t packed[16];
+    for (int i = 0; i < 16; i++)
+        src[i] = 0.37f * (scalar_t)(i - 8);
+
+    half_pack(packed, src, 16, HALF_BF16);
+    half_unpack(dst, packed, 16, HALF_BF16);
+    for (int i = 0; i < 16; i++)
+        ASSERT_NEAR(dst[i], src[i], fabs(src[i]) * 4e-3f + 1e-12f);
+}
+
+/* ================================================================
+ *  Mixed precision: half storage, full-precision arithmetic
+ * ================================================================ */
+
+void test_memplan_half_storage(void) {
+    /* y = x; 20 times: y = y * w + b, with a fused tail */
+    Tape *t = tape_get_instance();
+    ValueData *x = value_create(0.5f, "x", 0);
+    ValueData *w = value_create(0.9f, "w", 0);
+    ValueData *b = value_create(0.25f, "b", 0);
+    ValueData *y = x;
+    for (int i = 0; i < 20; i++)
+        y = value_add(value_mul(y, w), b);
+    y = value_div(value_mul(y, y), w);
+    tape_fuse(t, &y, 1);
+    scalar_t expected = value_get_data(y);
+
+    MemoryPlan *p = memplan_create(t, &y, 1);
+    ASSERT_NOT_NULL(p);
+    if (!p)
+        return;
+
+    half_t buffer[64];
+    ASSERT_TRUE(memplan_num_slots(p) <= 64);
+    ASSERT_EQ(memplan_execute_half(p, t, buffer, HALF_FP16), 0);
+    ASSERT_NEAR(value_get_data(y), expected, 1e-2f);
+    ASSERT_EQ(memplan_execute_half(p, t, buffer, HALF_BF16), 0);
+    ASSERT_NEAR(value_get_data(y), expected, expected * 3e-2f); // ~3 significant digits
+    memplan_destroy(p);
+}
+
+void test_round_to_half_keeps_full_grads(void) {
+    /* Weights rounded to bf16; the backward pass still runs in scalar_t */
+    Tape *t = tape_get_instance();
+    ValueData *a = value_create(1.2345678f, "a", 1);
+    ValueData *b = value_create(3.3333333f, "b", 1);
+    ValueData *c = value_mul(a, b);
+
+    tape_round_to_half(t, HALF_BF16);
+    ASSERT_EQ(bf16_from_float((float)value_get_data(a)), bf16_from_float(1.2345678f));
+    tape_forward(t);
+    value_backward(c);
+    ASSERT_NEAR(value_get_grad(a), value_get_data(b), DEFAULT_TOL);
+    ASSERT_NEAR(value_get_grad(b), value_get_data(a), DEFAULT_TOL);
+}
+
+/* ================================================================
+ *  Suite runner
+ * ================================================================ */
+
+void run_precision_tests(void) {
+    TEST_SUITE("Precision");
+    RUN_TEST(test_scalar_size_matches_library);
+    RUN_TEST(test_bf16_conversion);
+    RUN_TEST(test_fp16_conversion);
+    RUN_TEST(test_half_pack_roundtrip);
+    RUN_TEST(test_memplan_half_storage);
+    RUN_TEST(test_round_to_half_keeps_full_grads);
+}
+
+#endif /* CGRAD_TEST_PRECISION */
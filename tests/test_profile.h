@@ -0,0 +1,90 @@
+#ifndef CGRAD_TEST_PROFILE
+#define CGRAD_TEST_PROFILE
+
+#include "utils.h"
+
+/* ================================================================
+ *  Per-op counts (zero unless the library is built with PROFILE=1)
+ * ================================================================ */
+
+void test_profile_counts_ops(void) {
+    Tape *t = tape_get_instance();
+    profile_reset();
+
+    ValueData *a = value_create(2.0f, "a", 1);
+    ValueData *b = value_create(3.0f, "b", 1);
+    ValueData *c = value_mul(a, b);
+    ValueData *d = value_add(c, a);
+    tape_forward(t);
+    value_backward(d);
+
+    const ProfileStats *s = profile_get();
+    uint64_t n = profile_enabled() ? 1 : 0;
+    ASSERT_EQ(s->count[PROFILE_RECORD][OP_NONE], 2 * n);
+    ASSERT_EQ(s->count[PROFILE_RECORD][OP_MUL], n);
+    ASSERT_EQ(s->count[PROFILE_FORWARD][OP_ADD], n);
+    ASSERT_EQ(s->count[PROFILE_BACKWARD][OP_MUL], n);
+    ASSERT_EQ(s->count[PROFILE_BACKWARD][OP_NONE], 0); // Leaves have no backward function
+    ASSERT_EQ(s->allocs, 4 * n);
+    ASSERT_EQ(s->alloc_bytes, tape_mem_used(t) * n);
+
+    /* Instrumentation never changes the results */
+    ASSERT_NEAR(value_get_grad(a), 4.0f, DEFAULT_TOL);
+    ASSERT_NEAR(value_get_grad(b), 2.0f, DEFAULT_TOL);
+
+    profile_reset();
+    ASSERT_EQ(profile_get()->count[PROFILE_RECORD][OP_MUL], 0);
+}
+
+void test_profile_folded_export(void) {
+    profile_reset();
+    ValueData *a = value_create(1.5f, "a", 1);
+    value_backward(value_div(a, value_create(4.0f, "b", 1)));
+
+    const char *path = "/tmp/cgrad_test_profile.folded";
+    ASSERT_EQ(profile_write_folded(path), 0);
+
+    char buf[512] = {0};
+    FILE *f = fopen(path, "r");
+    ASSERT_NOT_NULL(f);
+    size_t len = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    remove(path);
+
+    if (profile_enabled()) {
+        /* "frame;frame;frame count" lines */
+        ASSERT_NOT_NULL(strstr(buf, "cgrad;record;div "));
+        ASSERT_NOT_NULL(strstr(buf, "cgrad;backward;div "));
+    } else {
+        ASSERT_EQ(len, 0);
+    }
+    profile_reset();
+}
+
+void test_profile_hw_counters_optional(void) {
+    /* Hardware counters may be unavailable (containers, perf_event_paranoid) */
+    profile_reset();
+    if (profile_hw_begin() == 0) {
+        ValueData *a = value_create(1.0f, "a", 1);
+        for (int i = 0; i < 100; i++)
+            a = value_add(a, a);
+        ASSERT_EQ(profile_hw_end(), 0);
+        ASSERT_TRUE(profile_get()->hw[PROFILE_HW_INSTRUCTIONS] > 0);
+    } else {
+        ASSERT_EQ(profile_hw_end(), -1);
+    }
+    profile_reset();
+}
+
+/* ================================================================
+ *  Suite runner
+ * ================================================================ */
+
+void run_profile_tests(void) {
+    TEST_SUITE("Profile");
+    RUN_TEST(test_profile_counts_ops);
+    RUN_TEST(test_profile_folded_export);
+    RUN_TEST(test_profile_hw_counters_optional);
+}
+
+#endif /* CGRAD_TEST_PROFILE */
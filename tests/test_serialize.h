@@ -0,0 +1,135 @@
+#ifndef CGRAD_TEST_SERIALIZE
+#define CGRAD_TEST_SERIALIZE
+
+#include "utils.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+/* ================================================================
+ *  Binary serialization
+ * ================================================================ */
+
+/* Fills path with a fresh temporary file name */
+static void serialize_temp_path(char *path, size_t size) {
+    snprintf(path, size, "/tmp/cgrad_test_XXXXXX");
+    int fd = mkstemp(path);
+    if (fd >= 0)
+        close(fd);
+}
+
+void test_serialize_roundtrip_in_place(void) {
+    /* y = (x * w + 2) / (x - w), with a fused chain */
+    Tape *t = tape_get_instance();
+    ValueData *x = value_create(3.0f, "x", 0);
+    ValueData *w = value_create(0.5f, "w", 0);
+    ValueData *y = value_div(scalar_add_value(2.0f, value_mul(x, w)), value_sub(x, w));
+    tape_fuse(t, &y, 1);
+
+    char path[64];
+    serialize_temp_path(path, sizeof(path));
+    ASSERT_EQ(tape_save(t, NULL, path), 0);
+
+    TapeImage *img = tape_image_open(path);
+    unlink(path);
+    ASSERT_NOT_NULL(img);
+    if (!img)
+        return;
+    ASSERT_EQ(tape_image_num_nodes(img), tape_num_nodes(t));
+    ASSERT_TRUE(strcmp(img->names[x->id], "x") == 0);
+
+    scalar_t values[16];
+    tape_image_reset(img, values);
+    ASSERT_NEAR(values[y->id], value_get_data(y), DEFAULT_TOL);
+
+    /* New input, evaluated straight from the mapping */
+    values[x->id] = 5.0f;
+    tape_image_forward(img, values);
+    value_set_data(x, 5.0f);
+    tape_forward(t);
+    ASSERT_NEAR(values[y->id], value_get_data(y), DEFAULT_TOL);
+
+    tape_image_close(img);
+}
+
+void test_serialize_params(void) {
+    /* L = (w0 * x + w1)^2, parameters stored alongside the graph */
+    Tape *t = tape_get_instance();
+    ParamStore *s = param_store_create(0);
+    scalar_t init[] = {1.5f, -0.5f};
+    param_store_add_array(s, init, 2);
+
+    ValueData *x = value_create(2.0f, "x", 0);
+    ValueData *r = value_add(value_mul(param_bind(s, 0), x), param_bind(s, 1));
+    ValueData *L = value_mul(r, r);
+    value_backward(L);
+    scalar_t g0 = s->grad[0], g1 = s->grad[1];
+
+    char path[64];
+    serialize_temp_path(path, sizeof(path));
+    ASSERT_EQ(tape_save(t, s, path), 0);
+    size_t out_id = L->id;
+    TapeImage *img = tape_image_open(path);
+    unlink(path);
+    ASSERT_NOT_NULL(img);
+    if (!img) {
+        param_store_destroy(s);
+        return;
+    }
+    ASSERT_EQ(img->header->num_params, 2);
+    ASSERT_NEAR(img->params[0], 1.5f, DEFAULT_TOL);
+
+    /* Rebuild on a fresh tape with a store loaded from the image */
+    tape_clear(t);
+    ParamStore *loaded = param_store_create(0);
+    param_store_add_array(loaded, img->params, img->header->num_params);
+    ValueData *nodes[16];
+    ASSERT_EQ(tape_image_load(img, t, loaded, nodes), 0);
+    ASSERT_NEAR(value_get_data(nodes[out_id]), 6.25f, DEFAULT_TOL);
+    value_backward(nodes[out_id]);
+    ASSERT_NEAR(loaded->grad[0], g0, DEFAULT_TOL);
+    ASSERT_NEAR(loaded->grad[1], g1, DEFAULT_TOL);
+
+    tape_image_close(img);
+    param_store_destroy(s);
+    param_store_destroy(loaded);
+}
+
+void test_serialize_rejects_bad_files(void) {
+    Tape *t = tape_get_instance();
+    ValueData *a = value_create(1.0f, "a", 1);
+    value_mul(a, a);
+
+    char path[64];
+    serialize_temp_path(path, sizeof(path));
+    ASSERT_EQ(tape_save(t, NULL, path), 0);
+
+    /* Corrupt the version field */
+    FILE *f = fopen(path, "r+b");
+    uint32_t bad_version = SERIAL_VERSION + 1;
+    fseek(f, 8, SEEK_SET);
+    fwrite(&bad_version, sizeof(bad_version), 1, f);
+    fclose(f);
+    ASSERT_TRUE(tape_image_open(path) == NULL);
+
+    /* Truncated file */
+    ASSERT_EQ(tape_save(t, NULL, path), 0);
+    ASSERT_EQ(truncate(path, 100), 0);
+    ASSERT_TRUE(tape_image_open(path) == NULL);
+    unlink(path);
+
+    ASSERT_TRUE(tape_image_open("/nonexistent/cgrad.tape") == NULL);
+}
+
+/* ================================================================
+ *  Suite runner
+ * ================================================================ */
+
+void run_serialize_tests(void) {
+    TEST_SUITE("Serialization");
+    RUN_TEST(test_serialize_roundtrip_in_place);
+    RUN_TEST(test_serialize_params);
+    RUN_TEST(test_serialize_rejects_bad_files);
+}
+
+#endif /* CGRAD_TEST_SERIALIZE */
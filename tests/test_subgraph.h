@@ -0,0 +1,181 @@
+#ifndef CGRAD_TEST_SUBGRAPH
+#define CGRAD_TEST_SUBGRAPH
+
+#include "utils.h"
+
+/* RNN step: h' = (w h + u x + b) / (1 + h h), inputs {h, x, w, u, b} */
+static ValueData *rnn_step(ValueData *h, ValueData *x, ValueData *w, ValueData *u, ValueData *b) {
+    ValueData *pre = value_add(value_add(value_mul(w, h), value_mul(u, x)), b);
+    return value_div(pre, scalar_add_value(1.0f, value_mul(h, h)));
+}
+
+static void rnn_body(ValueData **in, ValueData **out, void *ctx) {
+    (void)ctx;
+    out[0] = rnn_step(in[0], in[1], in[2], in[3], in[4]);
+}
+
+/* (a, b) -> (a * b, a + 2 b) */
+static void pair_body(ValueData **in, ValueData **out, void *ctx) {
+    (void)ctx;
+    out[0] = value_mul(in[0], in[1]);
+    out[1] = value_add(in[0], scalar_mul_value(2.0f, in[1]));
+}
+
+/* ================================================================
+ *  Instantiation
+ * ================================================================ */
+
+void test_subgraph_rnn_matches_unrolled(void) {
+    enum { T = 40 };
+    scalar_t xs[T];
+    for (int i = 0; i < T; i++)
+        xs[i] = 0.1f * (scalar_t)(i % 7) - 0.3f;
+
+    /* Plain unrolling */
+    Tape *plain = tape_get_instance();
+    ValueData *w = value_create(0.8f, "w", 1), *u = value_create(0.5f, "u", 1);
+    ValueData *b = value_create(0.1f, "b", 1), *h = value_create(0.0f, "h0", 0);
+    for (int i = 0; i < T; i++)
+        h = rnn_step(h, value_create(xs[i], "x", 0), w, u, b);
+    value_backward(h);
+    size_t plain_mem = tape_mem_used(plain);
+
+    /* Same model through a template */
+    SubgraphTemplate *tmpl = subgraph_template_create(rnn_body, 5, 1, NULL);
+    ASSERT_NOT_NULL(tmpl);
+    ASSERT_EQ(tmpl->num_steps, 7);
+    Tape *t = tape_create();
+    Tape *prev = tape_set_instance(t);
+    ValueData *tw = value_create(0.8f, "w", 1), *tu = value_create(0.5f, "u", 1);
+    ValueData *tb = value_create(0.1f, "b", 1), *th = value_create(0.0f, "h0", 0);
+    for (int i = 0; i < T; i++) {
+        ValueData *in[5] = {th, value_create(xs[i], "x", 0), tw, tu, tb};
+        ASSERT_EQ(subgraph_apply(tmpl, in, &th), 0);
+    }
+    value_backward(th);
+
+    ASSERT_NEAR(th->data, h->data, 1e-5f);
+    ASSERT_NEAR(tw->grad, w->grad, 1e-4f);
+    ASSERT_NEAR(tu->grad, u->grad, 1e-4f);
+    ASSERT_NEAR(tb->grad, b->grad, 1e-4f);
+    ASSERT_EQ(tape_num_nodes(t), 4 + 2 * T); // Leaves, x_t and one output per step
+    ASSERT_TRUE(tape_mem_used(t) * 2 < plain_mem);
+
+    tape_set_instance(prev);
+    tape_destroy(t);
+    subgraph_template_destroy(tmpl);
+}
+
+void test_subgraph_outputs_and_replay(void) {
+    SubgraphTemplate *tmpl = subgraph_template_create(pair_body, 2, 2, NULL);
+    ASSERT_NOT_NULL(tmpl);
+    ASSERT_EQ(tmpl->num_consts, 1);
+
+    ValueData *a = value_create(3.0f, "a", 1), *b = value_create(4.0f, "b", 1);
+    ValueData *in[2] = {a, b}, *out[2];
+    ASSERT_EQ(subgraph_apply(tmpl, in, out), 0);
+    ASSERT_NEAR(out[0]->data, 12.0f, DEFAULT_TOL);
+    ASSERT_NEAR(out[1]->data, 11.0f, DEFAULT_TOL);
+
+    /* z = (a b)(a + 2b): dz/da = b (a + 2b) + a b, dz/db = a (a + 2b) + 2 a b */
+    ValueData *z = value_mul(out[0], out[1]);
+    value_backward(z);
+    ASSERT_NEAR(a->grad, 4.0f * 11.0f + 12.0f, 1e-4f);
+    ASSERT_NEAR(b->grad, 3.0f * 11.0f + 24.0f, 1e-4f);
+
+    /* Replay recomputes every output of the instance */
+    value_set_data(a, 1.0f);
+    tape_forward(tape_get_instance());
+    ASSERT_NEAR(out[0]->data, 4.0f, DEFAULT_TOL);
+    ASSERT_NEAR(out[1]->data, 9.0f, DEFAULT_TOL);
+    ASSERT_NEAR(z->data, 36.0f, DEFAULT_TOL);
+
+    subgraph_template_destroy(tmpl);
+}
+
+void test_subgraph_dce_keeps_instance(void) {
+    SubgraphTemplate *tmpl = subgraph_template_create(pair_body, 2, 2, NULL);
+    ValueData *a = value_create(3.0f, "a", 1), *b = value_create(4.0f, "b", 1);
+    ValueData *in[2] = {a, b}, *out[2];
+    ASSERT_EQ(subgraph_apply(tmpl, in, out), 0);
+
+    /* Only the second output is used: the first one carries the sweep and must stay */
+    Tape *t = tape_get_instance();
+    ValueData *y = scalar_mul_value(5.0f, out[1]);
+    tape_optimize(t, &y, 1, PASS_ALL);
+    ASSERT_TRUE(tape_contains(t, out[0]));
+    value_backward(y);
+    ASSERT_NEAR(a->grad, 5.0f, 1e-5f);
+    ASSERT_NEAR(b->grad, 10.0f, 1e-5f);
+
+    subgraph_template_destroy(tmpl);
+}
+
+/* A body that reads a node from outside its scratch tape */
+static ValueData *g_outside;
+static void outside_body(ValueData **in, ValueData **out, void *ctx) {
+    (void)ctx;
+    out[0] = value_mul(in[0], g_outside);
+}
+
+void test_subgraph_rejects_outside_nodes(void) {
+    g_outside = value_create(2.0f, "w", 1);
+    ASSERT_TRUE(subgraph_template_create(outside_body, 1, 1, NULL) == NULL);
+}
+
+/* Sum of 40 inputs: wider than any fused kernel */
+#define WIDE_INPUTS 40
+static void wide_body(ValueData **in, ValueData **out, void *ctx) {
+    (void)ctx;
+    ValueData *acc = in[0];
+    for (int i = 1; i < WIDE_INPUTS; i++)
+        acc = value_add(acc, in[i]);
+    out[0] = acc;
+}
+
+void test_subgraph_wide_graph_export(void) {
+    SubgraphTemplate *tmpl = subgraph_template_create(wide_body, WIDE_INPUTS, 1, NULL);
+    ASSERT_NOT_NULL(tmpl);
+    Tape *t = tape_get_instance();
+    ValueData *in[WIDE_INPUTS], *out[1];
+    for (int i = 0; i < WIDE_INPUTS; i++)
+        in[i] = value_create((scalar_t)i, "x", 1);
+    ASSERT_EQ(subgraph_apply(tmpl, in, out), 0);
+
+    GraphSummary s;
+    tape_graph_summary(t, &s);
+    ASSERT_EQ(s.num_nodes, WIDE_INPUTS + 1);
+    ASSERT_EQ(s.num_edges, WIDE_INPUTS);
+    ASSERT_EQ(s.depth, 1);
+
+    GraphExportOptions opts = graph_export_defaults();
+    opts.focus = out[0];
+    opts.depth = 1;
+    ASSERT_EQ(tape_export_dot(t, GRAPH_TEST_PATH, &opts), 0);
+    char *dot = read_export();
+    ASSERT_NOT_NULL(dot);
+    ASSERT_EQ(count_lines_with(dot, "->"), WIDE_INPUTS);
+    free(dot);
+
+    opts.collapse = 1;
+    ASSERT_EQ(tape_export_dot(t, GRAPH_TEST_PATH, &opts), 0);
+    free(read_export());
+
+    tape_clear(t);
+    subgraph_template_destroy(tmpl);
+}
+
+/* ================================================================
+ *  Suite runner
+ * ================================================================ */
+
+void run_subgraph_tests(void) {
+    TEST_SUITE("Subgraph templates");
+    RUN_TEST(test_subgraph_rnn_matches_unrolled);
+    RUN_TEST(test_subgraph_outputs_and_replay);
+    RUN_TEST(test_subgraph_dce_keeps_instance);
+    RUN_TEST(test_subgraph_rejects_outside_nodes);
+    RUN_TEST(test_subgraph_wide_graph_export);
+}
+
+#endif /* CGRAD_TEST_SUBGRAPH */
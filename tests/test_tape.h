@@ -0,0 +1,228 @@
+#ifndef CGRAD_TEST_TAPE
+#define CGRAD_TEST_TAPE
+
+#include "utils.h"
+
+/* acc = x, then acc = acc * 0.999 + x, n times: every step reads x from the first window */
+static ValueData *tape_long_chain(ValueData *x, size_t n) {
+    ValueData *acc = x;
+    for (size_t i = 0; i < n; i++)
+        acc = value_add(scalar_mul_value(0.999f, acc), x);
+    return acc;
+}
+
+/* ================================================================
+ *  Out-of-core tapes
+ * ================================================================ */
+
+void test_tape_mapped_matches_memory(void) {
+    const size_t n = 40000; // A few MB of nodes: several windows are spilled
+    Tape *prev = tape_get_instance();
+
+    Tape *mem = tape_create();
+    tape_set_instance(mem);
+    ValueData *x_mem = value_create(0.5f, "x", 1);
+    ValueData *y_mem = tape_long_chain(x_mem, n);
+    y_mem->grad = 1.0f;
+    tape_backward(mem);
+
+    Tape *map = tape_create_mapped(NULL, 64u << 20);
+    ASSERT_NOT_NULL(map);
+    tape_set_instance(map);
+    ValueData *x = value_create(0.5f, "x", 1);
+    ValueData *y = tape_long_chain(x, n);
+    ASSERT_NOT_NULL(y);
+    ASSERT_TRUE(tape_num_blocks(map) * sizeof(TapeBlock) > 4 * TAPE_MAP_WINDOW);
+    y->grad = 1.0f;
+    tape_backward(map);
+
+    ASSERT_NEAR(y->data, y_mem->data, 1e-6f * fabs(y_mem->data));
+    ASSERT_NEAR(x->grad, x_mem->grad, 1e-6f * fabs(x_mem->grad));
+
+    /* Replay and a second sweep read the spilled windows back */
+    x->data = 0.25f;
+    tape_forward(map);
+    ASSERT_NEAR(y->data, 0.5f * y_mem->data, 1e-5f * fabs(y_mem->data));
+    tape_zero_grad(map);
+    y->grad = 1.0f;
+    tape_backward(map);
+    ASSERT_NEAR(x->grad, x_mem->grad, 1e-6f * fabs(x_mem->grad));
+
+    tape_set_instance(prev);
+    tape_destroy(map);
+    tape_destroy(mem);
+}
+
+void test_tape_mapped_capacity(void) {
+    Tape *prev = tape_get_instance();
+    Tape *map = tape_create_mapped(NULL, 2 * sizeof(TapeBlock));
+    ASSERT_NOT_NULL(map);
+    tape_set_instance(map);
+
+    /* Allocation fails once the file is full instead of growing */
+    ValueData *x = value_create(1.0f, "x", 1);
+    ValueData *y = tape_long_chain(x, 1000);
+    ASSERT_TRUE(y == NULL);
+    ASSERT_TRUE(tape_num_blocks(map) <= 2 + 1);
+
+    /* Clearing gives the whole file back */
+    tape_clear(map);
+    ASSERT_EQ(tape_num_blocks(map), 0);
+    x = value_create(2.0f, "x", 1);
+    y = value_mul(x, x);
+    ASSERT_NOT_NULL(y);
+    y->grad = 1.0f;
+    tape_backward(map);
+    ASSERT_NEAR(x->grad, 4.0f, 1e-6f);
+
+    tape_set_instance(prev);
+    tape_destroy(map);
+}
+
+/* ================================================================
+ *  Fixed tapes
+ * ================================================================ */
+
+void test_tape_fixed_matches_heap(void) {
+    static unsigned char buf[512 << 10]; // 3000 nodes and their index
+    const size_t n = 1000;
+    Tape *prev = tape_get_instance();
+
+    Tape *heap = tape_create();
+    tape_set_instance(heap);
+    ValueData *x_heap = value_create(0.5f, "x", 1);
+    ValueData *y_heap = tape_long_chain(x_heap, n);
+    y_heap->grad = 1.0f;
+    tape_backward(heap);
+
+    Tape *t = tape_create_in(buf, sizeof(buf));
+    ASSERT_NOT_NULL(t);
+    tape_set_instance(t);
+    ValueData *x = value_create(0.5f, "x", 1);
+    ValueData *y = tape_long_chain(x, n);
+    ASSERT_NOT_NULL(y);
+    y->grad = 1.0f;
+    tape_backward(t);
+    ASSERT_NEAR(y->data, y_heap->data, 1e-6f * fabs(y_heap->data));
+    ASSERT_NEAR(x->grad, x_heap->grad, 1e-6f * fabs(x_heap->grad));
+    ASSERT_EQ(tape_error(t), TAPE_OK);
+
+    /* Tape, index and nodes all live in the buffer */
+    unsigned char *lo = buf, *hi = buf + sizeof(buf);
+    ASSERT_TRUE((unsigned char *)t >= lo && (unsigned char *)t < hi);
+    ASSERT_TRUE((unsigned char *)t->nodes >= lo && (unsigned char *)t->nodes < hi);
+    ASSERT_TRUE((unsigned char *)y >= lo && (unsigned char *)y < hi);
+
+    tape_set_instance(prev);
+    tape_destroy(t);
+    tape_destroy(heap);
+}
+
+static int g_tape_errors;
+static void count_tape_error(Tape *t, TapeError err, void *ctx) {
+    (void)t;
+    (void)ctx;
+    if (err == TAPE_ERR_ARENA)
+        g_tape_errors++;
+}
+
+void test_tape_fixed_out_of_memory(void) {
+    /* Room for exactly two blocks */
+    size_t size = tape_region_size(2 * TAPE_BLOCK_SIZE);
+    unsigned char *buf = (unsigned char *)malloc(size);
+    Tape *t = tape_create_in(buf, size);
+    ASSERT_NOT_NULL(t);
+    ASSERT_EQ(t->blocks_capacity, 2);
+    ASSERT_TRUE(tape_create_in(buf, 64) == NULL);
+
+    Tape *prev = tape_set_instance(t);
+    g_tape_errors = 0;
+    tape_set_error_handler(t, count_tape_error, NULL);
+
+    ValueData *x = value_create(1.0f, "x", 1);
+    ValueData *y = tape_long_chain(x, 1000);
+    ASSERT_TRUE(y == NULL);
+    ASSERT_EQ(tape_error(t), TAPE_ERR_ARENA);
+    ASSERT_EQ(g_tape_errors, 1); // NULL operands stop the chain at the first failure
+    ASSERT_EQ(tape_num_blocks(t), 2);
+    ASSERT_TRUE(strcmp(tape_error_string(TAPE_ERR_ARENA), "tape arena exhausted") == 0);
+
+    /* Clearing resets the error and gives both blocks back */
+    tape_clear(t);
+    ASSERT_EQ(tape_error(t), TAPE_OK);
+    x = value_create(2.0f, "x", 1);
+    y = value_mul(x, x);
+    ASSERT_NOT_NULL(y);
+    y->grad = 1.0f;
+    tape_backward(t);
+    ASSERT_NEAR(x->grad, 4.0f, 1e-6f);
+
+    tape_set_instance(prev);
+    tape_destroy(t);
+    free(buf);
+}
+
+void test_tape_region(void) {
+    Tape *t = tape_create_region(1 << 20, 0);
+    ASSERT_NOT_NULL(t);
+    ASSERT_TRUE(t->blocks_capacity * TAPE_BLOCK_SIZE > (1 << 20) * 9 / 10);
+
+    Tape *prev = tape_set_instance(t);
+    ValueData *x = value_create(3.0f, "x", 1);
+    ValueData *y = value_mul(x, scalar_add_value(1.0f, x));
+    y->grad = 1.0f;
+    tape_backward(t);
+    ASSERT_NEAR(x->grad, 7.0f, 1e-6f);
+
+    /* Oversized requests are reported rather than silently refused */
+    ASSERT_TRUE(tape_allocate(t, TAPE_BLOCK_SIZE + 1) == NULL);
+    ASSERT_EQ(tape_error(t), TAPE_ERR_SIZE);
+
+    tape_set_instance(prev);
+    tape_destroy(t);
+}
+
+void test_tape_retain_reuses_blocks(void) {
+    Tape *t = tape_create();
+    tape_set_retain(t, 1);
+    Tape *prev = tape_set_instance(t);
+
+    tape_long_chain(value_create(1.0f, "x", 1), 500);
+    size_t blocks = tape_num_blocks(t);
+    TapeBlock *first = t->blocks[0], *last = t->blocks[blocks - 1];
+    ASSERT_TRUE(blocks > 2);
+
+    /* The same recording lands in the same blocks */
+    tape_clear(t);
+    ValueData *x = value_create(2.0f, "x", 1);
+    ValueData *y = tape_long_chain(x, 500);
+    ASSERT_EQ(tape_num_blocks(t), blocks);
+    ASSERT_TRUE(t->blocks[0] == first && t->blocks[blocks - 1] == last);
+    ASSERT_EQ(t->blocks_owned, blocks);
+    value_backward(y);
+    ASSERT_TRUE(x->grad > 1.0f);
+
+    /* Without retain, clearing hands them back */
+    tape_set_retain(t, 0);
+    tape_clear(t);
+    ASSERT_EQ(t->blocks_owned, 0);
+
+    tape_set_instance(prev);
+    tape_destroy(t);
+}
+
+/* ================================================================
+ *  Suite runner
+ * ================================================================ */
+
+void run_tape_tests(void) {
+    TEST_SUITE("Tape");
+    RUN_TEST(test_tape_mapped_matches_memory);
+    RUN_TEST(test_tape_mapped_capacity);
+    RUN_TEST(test_tape_fixed_matches_heap);
+    RUN_TEST(test_tape_fixed_out_of_memory);
+    RUN_TEST(test_tape_region);
+    RUN_TEST(test_tape_retain_reuses_blocks);
+}
+
+#endif /* CGRAD_TEST_TAPE */
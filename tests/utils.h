@@ -25,11 +25,11 @@ static int g_current_test_failed = 0;
     do {                                                                                    \
         scalar_t _a = (actual);                                                             \
         scalar_t _e = (expected);                                                           \
-        if (fabsf(_a - _e) >= (tol)) {                                                     \
-            printf("    " CLR_RED "FAIL" CLR_RESET " %s:%d: ASSERT_NEAR(%s, %s, %s)\n"     \
+        if (fabs(_a - _e) >= (tol)) {                                                       \
+            printf("    " CLR_RED "FAIL" CLR_RESET " %s:%d: ASSERT_NEAR(%s, %s, %s)\n"      \
                    "         got %.8f, expected %.8f (diff %.8e)\n",                        \
                    __FILE__, __LINE__, #actual, #expected, #tol, (double)_a, (double)_e,    \
-                   (double)fabsf(_a - _e));                                                 \
+                   (double)fabs(_a - _e));                                                  \
             g_current_test_failed = 1;                                                      \
         }                                                                                   \
     } while (0)